@@ -12,6 +12,11 @@
   #define ATOMIC_ADD32(mem, val) atomic_add_32_nv(&mem, val)
   #define ATOMIC_ADD64(mem, val) atomic_add_64_nv(&mem, val)
   #define ATOMIC_ADD32_PTR(mem, val) atomic_add_32_nv(mem, val)
+  #define CAS16(mem, oldv, newv) (atomic_cas_16((uint16_t *)&mem, oldv, newv) == oldv)
+  #define ATOMIC_LOAD16(mem) atomic_add_16_nv(&mem, 0)
+  #define ATOMIC_ADD16(mem, val) atomic_add_16_nv(&mem, val)
+  #define ATOMIC_FENCE() membar_enter()
+  #define ATOMIC_ACQUIRE_FENCE() membar_consumer()
 #elif defined(_LINUX_SOURCE)
   #define CAS32(mem, oldv, newv) __atomic_compare_exchange_n(&mem, &oldv, newv, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
   #define CAS64(mem, oldv, newv) __atomic_compare_exchange_n(&mem, &oldv, newv, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
@@ -22,6 +27,11 @@
   #define ATOMIC_ADD32(mem, val) __atomic_add_fetch(&mem, val, __ATOMIC_SEQ_CST)
   #define ATOMIC_ADD64(mem, val) __atomic_add_fetch(&mem, val, __ATOMIC_SEQ_CST)
   #define ATOMIC_ADD32_PTR(mem, val) __atomic_add_fetch(mem, val, __ATOMIC_SEQ_CST)
+  #define CAS16(mem, oldv, newv) __atomic_compare_exchange_n(&mem, &oldv, newv, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+  #define ATOMIC_LOAD16(mem) __atomic_load_n(&mem, __ATOMIC_SEQ_CST)
+  #define ATOMIC_ADD16(mem, val) __atomic_add_fetch(&mem, val, __ATOMIC_SEQ_CST)
+  #define ATOMIC_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+  #define ATOMIC_ACQUIRE_FENCE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
 #else
   #error "Missing atomic primitives"
 #endif
@@ -240,6 +240,10 @@ DEF_ATTR(TEMPTABLE_MEM_THRESHOLD, temptable_mem_threshold, QUANTITY, 512,
 DEF_ATTR(TEMPTABLE_CACHESZ, temptable_cachesz, BYTES, 262144,
          "Cache size for temporary tables. Temp tables do not share the "
          "database's main buffer pool.")
+DEF_ATTR(TEMPTABLE_MEM_BUDGET, temptable_mem_budget, BYTES, 0,
+         "Spill an in-memory temp array to disk once its arena holds more "
+         "than this many bytes of keys and data, including copies left "
+         "behind by updates and deletes. 0 means the temp table cache size.")
 DEF_ATTR(PARTICIPANTID_BITS, participantid_bits, QUANTITY, 0,
          "Number of bits allocated for the participant stripe ID (remaining "
          "bits are used for the update ID).")
@@ -516,6 +520,9 @@ DEF_ATTR(RCACHE_COUNT, rcache_count, QUANTITY, 257,
          "Number of entries in root page cache.")
 DEF_ATTR(RCACHE_PGSZ, rcache_pgsz, BYTES, 4096,
          "Size of pages in root page cache.")
+DEF_ATTR(RCACHE_LEVELS, rcache_levels, QUANTITY, 2,
+         "Number of B-tree levels, counting the root, kept in the root page "
+         "cache.")
 DEF_ATTR(DEADLK_PRIORITY_BUMP_ON_FSTBLK, deadlk_priority_bump_on_fstblk,
          QUANTITY, 5, NULL)
 DEF_ATTR(FSTBLK_MINQ, fstblk_minq, QUANTITY, 262144, NULL)
@@ -534,6 +541,9 @@ DEF_ATTR_2(PRIVATE_BLKSEQ_STRIPES, private_blkseq_stripes, QUANTITY, 8,
            "Number of stripes for the blkseq table.", 0, dtastripe_verify, 0)
 DEF_ATTR(PRIVATE_BLKSEQ_ENABLED, private_blkseq_enabled, BOOLEAN, 1,
          "Sets whether dupe detection is enabled.")
+DEF_ATTR(PRIVATE_BLKSEQ_BLOOM_BITS, private_blkseq_bloom_bits, QUANTITY,
+         4194304, "Size in bits of the bloom filter in front of each blkseq "
+                  "table, applied when the table rolls. 0 disables it.")
 DEF_ATTR(PRIVATE_BLKSEQ_CLOSE_WARN_TIME, private_blkseq_close_warn_time,
          BOOLEAN, 100,
          "Warn when it takes longer than this many MS to roll a blkseq table.")
@@ -654,6 +664,9 @@ DEF_ATTR(CRON_LOGICAL_IDLE_SECS, cron_logical_idle_secs, SECS, 1,
          " the queue for events")
 DEF_ATTR(NET_SEND_GBLCONTEXT, net_send_gblcontext, BOOLEAN, 0,
          "Enable net_send for USER_TYPE_GBLCONTEXT.")
+DEF_ATTR(NET_SEND_OWNED_MINSZ, net_send_owned_minsz, BYTES, 1024,
+         "Replication messages of at least this many bytes are queued to "
+         "peers by reference instead of being copied. 0 disables.")
 
 DEF_ATTR(
     VIEWS_DFT_PREEMPT_ROLL_SECS, views_dft_preempt_roll_secs, SECS, 1800,
@@ -837,6 +837,14 @@ uint32_t bdb_readonly_lock_id(bdb_state_type *bdb_state)
     return lid;
 }
 
+uint32_t bdb_lowpri_lock_id(bdb_state_type *bdb_state)
+{
+    uint32_t lid = 0;
+    DB_ENV *dbenv = bdb_state->dbenv;
+    dbenv->lock_id_flags(dbenv, &lid, DB_LOCK_ID_LOWPRI);
+    return lid;
+}
+
 void bdb_free_lock_id(bdb_state_type *bdb_state, uint32_t lid)
 {
     DB_ENV *dbenv = bdb_state->dbenv;
@@ -1970,6 +1970,7 @@ void bdb_set_recovery(bdb_state_type *);
 tran_type *bdb_tran_begin_set_prop(bdb_state_type *, tran_type *parent,
                                    struct txn_properties *prop, int *bdberr);
 uint32_t bdb_readonly_lock_id(bdb_state_type *bdb_state);
+uint32_t bdb_lowpri_lock_id(bdb_state_type *bdb_state);
 void bdb_free_lock_id(bdb_state_type *bdb_state, uint32_t lid);
 void bdb_lockspeed(bdb_state_type *bdb_state);
 int bdb_lock_table_write(bdb_state_type *bdb_state, tran_type *tran);
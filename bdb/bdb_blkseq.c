@@ -39,6 +39,7 @@
 #include "sys_wrap.h"
 #include "tohex.h"
 #include "locks.h"
+#include "crc32c.h"
 
 extern int blkseq_get_rcode(void *data, int datalen);
 extern int dist_txn_abort_write_blkseq(void *bdb_state, void *bskey, int bskeylen);
@@ -47,6 +48,69 @@ static int bdb_blkseq_update_lsn_locked(bdb_state_type *bdb_state,
 
 extern int gbl_is_physical_replicant;
 
+/* Most blkseqs have never been seen before, so each blkseq table has a bloom
+ * filter in front of it that lets find and insert skip the btree probe.  Bits
+ * are only ever set, so a filter always covers its table; keys backed out by
+ * recovery just become false positives until the table is rolled.  Filters
+ * live and roll with their tables under blkseq_lk, and are rebuilt by
+ * bdb_recover_blkseq along with them. */
+struct blkseq_bloom {
+    uint32_t mask;
+    uint64_t bits[];
+};
+
+#define BLKSEQ_BLOOM_NHASH 4
+
+static struct blkseq_bloom *blkseq_bloom_create(bdb_state_type *bdb_state)
+{
+    struct blkseq_bloom *bloom;
+    uint32_t nbits = 64;
+    int want = bdb_state->attr->private_blkseq_bloom_bits;
+
+    if (want <= 0)
+        return NULL;
+    while (nbits < want && nbits < (1U << 31))
+        nbits <<= 1;
+
+    bloom = calloc(1, sizeof(struct blkseq_bloom) + nbits / 8);
+    if (bloom == NULL) {
+        /* not fatal, the table is probed every time */
+        logmsg(LOGMSG_ERROR, "%s: can't allocate %u bits\n", __func__, nbits);
+        return NULL;
+    }
+    bloom->mask = nbits - 1;
+    return bloom;
+}
+
+static inline uint32_t blkseq_bloom_hash(void *key, int klen)
+{
+    return crc32c((const uint8_t *)key, klen);
+}
+
+static void blkseq_bloom_add(struct blkseq_bloom *bloom, uint32_t hash)
+{
+    uint32_t step = ((hash >> 16) | (hash << 16)) | 1;
+
+    if (bloom == NULL)
+        return;
+    for (int i = 0; i < BLKSEQ_BLOOM_NHASH; i++, hash += step)
+        bloom->bits[(hash & bloom->mask) >> 6] |= 1ULL << (hash & 63);
+}
+
+/* Returns 0 only if the key was never added.  Without a filter we can't
+ * tell. */
+static int blkseq_bloom_maybe(struct blkseq_bloom *bloom, uint32_t hash)
+{
+    uint32_t step = ((hash >> 16) | (hash << 16)) | 1;
+
+    if (bloom == NULL)
+        return 1;
+    for (int i = 0; i < BLKSEQ_BLOOM_NHASH; i++, hash += step)
+        if (!(bloom->bits[(hash & bloom->mask) >> 6] & (1ULL << (hash & 63))))
+            return 0;
+    return 1;
+}
+
 static DB *create_blkseq(bdb_state_type *bdb_state, int stripe, int num)
 {
     char fname[1024];
@@ -98,6 +162,7 @@ void bdb_cleanup_private_blkseq(bdb_state_type *bdb_state)
             for (int i = 0; i < 2; i++) {
                 DB *to_be_deleted = bdb_state->blkseq[i][stripe];
                 to_be_deleted->close(to_be_deleted, DB_NOSYNC);
+                free(bdb_state->blkseq_bloom[i][stripe]);
             }
 
             env->close(env, 0);
@@ -122,6 +187,12 @@ void bdb_cleanup_private_blkseq(bdb_state_type *bdb_state)
         free(bdb_state->blkseq[1]);
         bdb_state->blkseq[1] = NULL;
     }
+    for (int i = 0; i < 2; i++) {
+        if (bdb_state->blkseq_bloom[i]) {
+            free(bdb_state->blkseq_bloom[i]);
+            bdb_state->blkseq_bloom[i] = NULL;
+        }
+    }
     if (bdb_state->blkseq_last_lsn[0]) {
         free(bdb_state->blkseq_last_lsn[0]);
         bdb_state->blkseq_last_lsn[0] = NULL;
@@ -149,6 +220,8 @@ int bdb_create_private_blkseq(bdb_state_type *bdb_state)
     bdb_state->blkseq_lk = malloc(nstripes * sizeof(pthread_mutex_t));
     bdb_state->blkseq[0] = malloc(nstripes * sizeof(DB *));
     bdb_state->blkseq[1] = malloc(nstripes * sizeof(DB *));
+    bdb_state->blkseq_bloom[0] = calloc(nstripes, sizeof(struct blkseq_bloom *));
+    bdb_state->blkseq_bloom[1] = calloc(nstripes, sizeof(struct blkseq_bloom *));
     bdb_state->blkseq_last_lsn[0] = malloc(nstripes * sizeof(DB_LSN));
     bdb_state->blkseq_last_lsn[1] = malloc(nstripes * sizeof(DB_LSN));
     bdb_state->blkseq_last_roll_time = malloc(nstripes * sizeof(time_t));
@@ -184,6 +257,7 @@ int bdb_create_private_blkseq(bdb_state_type *bdb_state)
             bdb_state->blkseq[i][stripe] = create_blkseq(bdb_state, stripe, i);
             if (bdb_state->blkseq[i][stripe] == NULL)
                 return -1;
+            bdb_state->blkseq_bloom[i][stripe] = blkseq_bloom_create(bdb_state);
             bzero(&bdb_state->blkseq_last_lsn[i][stripe], sizeof(DB_LSN));
         }
         listc_init(&bdb_state->blkseq_log_list[stripe],
@@ -251,6 +325,8 @@ int bdb_blkseq_recover(DB_ENV *dbenv, u_int32_t rectype, llog_blkseq_args *args,
                 NULL, &args->key,
                 &args->data, DB_NOOVERWRITE);
         if (rc == 0) {
+            blkseq_bloom_add(bdb_state->blkseq_bloom[0][stripe],
+                             blkseq_bloom_hash(args->key.data, args->key.size));
             bdb_state->blkseq_last_lsn[0][stripe] = *lsn;
             rc = bdb_blkseq_update_lsn_locked(bdb_state, args->time, *lsn,
                     stripe);
@@ -326,14 +402,18 @@ int bdb_blkseq_find(bdb_state_type *bdb_state, tran_type *tran, void *key,
     DBT dkey = {0}, ddata = {0};
     int rc;
     uint8_t stripe;
+    uint32_t hash;
     ddata.flags = DB_DBT_REALLOC;
     if (!bdb_state->attr->private_blkseq_enabled)
         return IX_EMPTY;
     stripe = get_stripe(bdb_state, (uint8_t *)key, klen);
+    hash = blkseq_bloom_hash(key, klen);
     Pthread_mutex_lock(&bdb_state->blkseq_lk[stripe]);
     dkey.data = key;
     dkey.size = klen;
     for (int i = 0; i < 2; i++) {
+        if (!blkseq_bloom_maybe(bdb_state->blkseq_bloom[i][stripe], hash))
+            continue;
         rc = bdb_state->blkseq[i][stripe]->get(bdb_state->blkseq[i][stripe],
                                                NULL, &dkey, &ddata, 0);
         if (rc == 0) {
@@ -365,6 +445,7 @@ int bdb_blkseq_insert(bdb_state_type *bdb_state, tran_type *tran, void *key, int
     // int *k;
     int rc;
     uint8_t stripe;
+    uint32_t hash;
     int write_ix = 0;
 
     if (!bdb_state->attr->private_blkseq_enabled)
@@ -375,6 +456,7 @@ int bdb_blkseq_insert(bdb_state_type *bdb_state, tran_type *tran, void *key, int
     // k = (int*) key;
     // printf("inserting %x %x %x\n", k[0], k[1], k[2]);
     stripe = get_stripe(bdb_state, (uint8_t *)key, klen);
+    hash = blkseq_bloom_hash(key, klen);
 
     Pthread_mutex_lock(&bdb_state->blkseq_lk[stripe]);
     dkey.data = key;
@@ -383,6 +465,8 @@ int bdb_blkseq_insert(bdb_state_type *bdb_state, tran_type *tran, void *key, int
     now = comdb2_time_epoch();
 
     for (int i = 0; i < 2; i++) {
+        if (!blkseq_bloom_maybe(bdb_state->blkseq_bloom[i][stripe], hash))
+            continue;
         rc = bdb_state->blkseq[i][stripe]->get(bdb_state->blkseq[i][stripe],
                                                NULL, &dkey, &ddata, 0);
         if (rc == 0) {
@@ -418,6 +502,7 @@ int bdb_blkseq_insert(bdb_state_type *bdb_state, tran_type *tran, void *key, int
         Pthread_mutex_unlock(&bdb_state->blkseq_lk[stripe]);
         return BDBERR_MISC;
     }
+    blkseq_bloom_add(bdb_state->blkseq_bloom[write_ix][stripe], hash);
 
     /* succeded in updating local table, log the update if transactional
      * (recovery isn't) */
@@ -517,6 +602,10 @@ static int bdb_blkseq_clean_int(bdb_state_type *bdb_state, uint8_t stripe)
     bdb_state->blkseq[0][stripe] = newdb;
     bdb_state->blkseq_last_lsn[1][stripe] = bdb_state->blkseq_last_lsn[0][stripe];
 
+    free(bdb_state->blkseq_bloom[1][stripe]);
+    bdb_state->blkseq_bloom[1][stripe] = bdb_state->blkseq_bloom[0][stripe];
+    bdb_state->blkseq_bloom[0][stripe] = blkseq_bloom_create(bdb_state);
+
     bdb_state->blkseq_last_roll_time[stripe] = now;
 
     /* Clean up the old blkseq file. Get its name, close it, delete it. */
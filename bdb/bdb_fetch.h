@@ -72,6 +72,8 @@ typedef struct {
     uint8_t for_write;
     void *(*fn_malloc)(size_t); /* user-specified malloc function */
     void (*fn_free)(void *); /* user-specified free function */
+    uint32_t lockerid; /* prefault: caller's locker, already holding the
+                          table read lock (0 to use a private one) */
 } bdb_fetch_args_t;
 
 int bdb_fetch(bdb_state_type *bdb_handle, void *ix, int ixnum, int ixlen,
@@ -657,6 +657,9 @@ struct seen_blkseq {
     LINKC_T(struct seen_blkseq) lnk;
 };
 
+/* Bloom filter over the keys of one blkseq table (bdb_blkseq.c) */
+struct blkseq_bloom;
+
 struct temp_table;
 
 struct sc_redo_lsn {
@@ -896,6 +899,7 @@ struct bdb_state_tag {
     pthread_mutex_t *blkseq_lk;
     DB_ENV **blkseq_env;
     DB **blkseq[2];
+    struct blkseq_bloom **blkseq_bloom[2];
     time_t *blkseq_last_roll_time;
     DB_LSN *blkseq_last_lsn[2];
     listc_t *blkseq_log_list;
@@ -1705,8 +1705,11 @@ static int bdb_berkdb_handle_optimized(bdb_berkdb_t *pberkdb, int *bdberr)
         if (rc < 0)
             return rc;
 
-        key = bdb_temp_table_key(bt->cur);
+        /* the update may spill an in-memory array and free the arena that
+           holds the current key, so refind with a copy */
         keylen = bdb_temp_table_keysize(bt->cur);
+        key = alloca(keylen);
+        memcpy(key, bdb_temp_table_key(bt->cur), keylen);
 
         /* update the temp table */
         rc = bdb_temp_table_update(berkdb->cur->state, bt->cur, key, keylen,
@@ -2141,6 +2141,16 @@ static int bdb_fetch_prefault_int(
     int rc;
     int llrc;
 
+    /* the caller holds the table read lock on its own locker: reuse it, so
+       the lookup does not queue a second table lock behind a waiting writer */
+    if (args && args->lockerid)
+        return bdb_fetch_int_ll(return_dta, direction, lookahead, bdb_state,
+                                ix, ixnum, ixlen, lastix, lastrrn, lastgenid,
+                                dta, dtalen, reqdtalen, ixfound, rrn, recnum,
+                                genid, numblobs, dtafilenums, blobsizes,
+                                bloboffs, blobptrs, 1, NULL, NULL, args,
+                                args->lockerid, bdberr);
+
     rc = bdb_state->dbenv->lock_id_flags(bdb_state->dbenv, &lockerid,
                                          DB_LOCK_ID_LOWPRI);
     if (rc != 0) {
@@ -190,6 +190,8 @@ static void log_stats(FILE *out, bdb_state_type *bdb_state)
         prn_stat(st_total_wakeups);
         prn_stat(st_false_wakeups);
         prn_stat(st_inline_writes);
+        prn_stat(st_deferred_copies);
+        prn_stat(st_copy_waits);
     }
 
     free(stats);
@@ -326,7 +328,14 @@ static void lock_stats(FILE *out, bdb_state_type *bdb_state)
     prn_lstat(st_nrequests);
     prn_lstat(st_nreleases);
     prn_lstat(st_nnowaits);
+    prn_lstat(st_nfastpath);
     prn_lstat(st_ndeadlocks);
+    prn_lstat(st_ndetects);
+    prn_lstat(st_ndetect_walks);
+    prn_lstat(st_ndetect_skipped);
+    prn_lstat(st_detect_usecs);
+    prn_lstat(st_detect_max_usecs);
+    prn_lstat(st_detect_max_lockers);
     prn_stat(st_locktimeout);
     prn_lstat(st_nlocktimeouts);
     prn_stat(st_txntimeout);
@@ -556,6 +565,11 @@ static void cache_stats(FILE *out, bdb_state_type *bdb_state, int extra)
     prn_lstat(st_pf_evict);
     prn_lstat(st_rw_evict_skip);
     prn_lstat(st_page_trickle);
+    prn_lstat(st_trickle_passes);
+    prn_lstat(st_trickle_paced);
+    prn_lstat(st_trickle_logbytes);
+    prn_lstat(st_trickle_dirty);
+    prn_lstat(st_trickle_max_dirty);
     prn_lstat(st_pages);
     prn_lstat(st_page_clean);
     logmsgf(LOGMSG_USER, out, "st_page_dirty: %d\n", stats->st_page_dirty);
@@ -566,6 +580,9 @@ static void cache_stats(FILE *out, bdb_state_type *bdb_state, int extra)
     prn_lstat(st_hash_nowait);
     prn_lstat(st_hash_wait);
     prn_lstat(st_hash_max_wait);
+    prn_lstat(st_hash_max_wait_bucket);
+    prn_lstat(st_hash_optimistic);
+    prn_lstat(st_hash_optimistic_fail);
     prn_lstat(st_region_wait);
     prn_lstat(st_region_nowait);
     prn_lstat(st_alloc);
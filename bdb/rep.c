@@ -781,6 +781,7 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
     int *seqnum;
     int nodelay;
     int useheap = 0;
+    int owned = 0;
     int is_logput = 0;
     tran_type *tran = NULL;
 
@@ -847,10 +848,19 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
             sizeof(int) +   /* controlcrc */
             control->size;  /* controlbuf */
 
-    if (bufsz > 1024 * 65)
-        useheap = 1;
+    /* pack large messages straight into a net buffer which is then queued
+       to every peer by reference */
+    char *buf = NULL;
+    if (bdb_state->attr->net_send_owned_minsz > 0 &&
+        bufsz >= bdb_state->attr->net_send_owned_minsz &&
+        (buf = net_msg_alloc(USER_TYPE_BERKDB_REP, bufsz)) != NULL)
+        owned = 1;
 
-    char *buf = useheap ? malloc(bufsz) : alloca(bufsz);
+    if (buf == NULL) {
+        if (bufsz > 1024 * 65)
+            useheap = 1;
+        buf = useheap ? malloc(bufsz) : alloca(bufsz);
+    }
 
     bytecount += bufsz;
 
@@ -979,7 +989,8 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
                     ((flags & DB_REP_NODROP) ? NET_SEND_NODROP : 0) |
                     (bdb_state->attr->net_inorder_logputs ? NET_SEND_INORDER : 0) |
                     (nodelay ? NET_SEND_NODELAY : 0) |
-                    (flags & DB_REP_TRACE ? NET_SEND_TRACE : 0);
+                    (flags & DB_REP_TRACE ? NET_SEND_TRACE : 0) |
+                    (owned ? NET_SEND_OWNED : 0);
         ++num;
         rc = net_send_all(bdb_state->repinfo->netinfo, num, data, sz, type, flag);
     } else {
@@ -1016,6 +1027,9 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
         if (nodelay)
             sendflags |= NET_SEND_NODELAY;
 
+        if (owned)
+            sendflags |= NET_SEND_OWNED;
+
         if (flags & DB_REP_TRACE) {
             logmsg(LOGMSG_USER, "%s line %d calling net_send_flags\n", __func__,
                    __LINE__);
@@ -1030,7 +1044,9 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
         outrc = 1;
     }
 
-    if (useheap)
+    if (owned)
+        net_msg_free(buf);
+    else if (useheap)
         free(buf);
 
     return outrc;
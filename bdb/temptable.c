@@ -152,6 +152,18 @@ typedef struct arr_elem {
     uint8_t *dta;
 } arr_elem_t;
 
+/* Key and data copies of a temparray are carved out of a chain of chunks
+   instead of being malloc'd one by one. The chunks are released all at once
+   when the array is truncated, spilled or destroyed. */
+typedef struct arr_chunk {
+    struct arr_chunk *next;
+    size_t used;
+    size_t size;
+    uint8_t buf[];
+} arr_chunk_t;
+
+#define TEMPARRAY_CHUNK_SIZE (64 * 1024)
+
 #define COPY_KV_TO_CUR(c)                                                      \
     do {                                                                       \
         arr_elem_t *elem = &(c)->tbl->elements[(c)->ind];                      \
@@ -214,6 +226,12 @@ struct temp_table {
     unsigned long long inmemsz;
     unsigned long long cachesz;
     arr_elem_t *elements;
+
+    arr_chunk_t *chunks;     /* arena backing the temparray elements */
+    unsigned long long arenasz; /* bytes handed out by the arena, including
+                                   copies left behind by update and delete */
+    unsigned long long membudget; /* spill the temparray beyond this many
+                                     arena bytes */
 };
 
 enum { TMPTBL_PRIORITY, TMPTBL_WAIT };
@@ -239,6 +257,58 @@ static int bdb_temp_table_insert_put(bdb_state_type *, struct temp_table *,
 
 void *bdb_temp_table_get_cur(struct temp_cursor *skippy) { return skippy->cur; }
 
+static uint8_t *temp_array_alloc(struct temp_table *tbl, size_t len)
+{
+    arr_chunk_t *chunk = tbl->chunks;
+    uint8_t *ptr;
+    size_t sz;
+
+    len = (len + 7) & ~(size_t)7;
+
+    if (chunk == NULL || chunk->size - chunk->used < len) {
+        sz = (len > TEMPARRAY_CHUNK_SIZE / 4) ? len : TEMPARRAY_CHUNK_SIZE;
+        chunk = malloc(sizeof(arr_chunk_t) + sz);
+        if (chunk == NULL)
+            return NULL;
+        chunk->used = 0;
+        chunk->size = sz;
+        if (sz != TEMPARRAY_CHUNK_SIZE && tbl->chunks != NULL) {
+            /* oversized element: keep carving from the current chunk */
+            chunk->next = tbl->chunks->next;
+            tbl->chunks->next = chunk;
+        } else {
+            chunk->next = tbl->chunks;
+            tbl->chunks = chunk;
+        }
+    }
+
+    ptr = chunk->buf + chunk->used;
+    chunk->used += len;
+    tbl->arenasz += len;
+    return ptr;
+}
+
+/* Release the arena, keeping one regular chunk around for the next user of
+   this (possibly pooled) table. */
+static void temp_array_reset_arena(struct temp_table *tbl, int keep)
+{
+    arr_chunk_t *chunk, *next, *kept = NULL;
+
+    for (chunk = tbl->chunks; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        if (keep && kept == NULL && chunk->size == TEMPARRAY_CHUNK_SIZE) {
+            kept = chunk;
+            kept->used = 0;
+            kept->next = NULL;
+        } else {
+            free(chunk);
+        }
+    }
+    tbl->chunks = kept;
+    tbl->arenasz = 0;
+    tbl->inmemsz = 0;
+}
+
 static int histcmpfunc(const void *key1, const void *key2, int len)
 {
     return !pthread_equal(*(pthread_t *)key1, *(pthread_t *)key2);
@@ -358,11 +428,7 @@ static int bdb_array_copy_to_temp_db(bdb_state_type *bdb_state,
         }
     }
 
-    for (ii = 0; ii != nents; ++ii) {
-        elem = &tbl->elements[ii];
-        free(elem->key);
-    }
-    tbl->inmemsz = 0;
+    temp_array_reset_arena(tbl, 1);
     tbl->num_mem_entries = nents;
 
     /* its now a btree! */
@@ -606,6 +672,10 @@ static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
 
     tbl->max_mem_entries = bdb_state->attr->temptable_mem_threshold;
 
+    tbl->membudget = bdb_state->attr->temptable_mem_budget;
+    if (tbl->membudget == 0)
+        tbl->membudget = tbl->cachesz;
+
 #ifdef _LINUX_SOURCE
     if (gbl_debug_temptables) {
         char *zBacktrace = get_stack_backtrace();
@@ -925,13 +995,11 @@ int bdb_temp_table_update(bdb_state_type *bdb_state, struct temp_cursor *cur,
         if (!cur->valid)
             return -1;
 
-        /* Free the existing elements and update the memory footprint. */
+        /* The old copy stays in the arena until the array is reset. */
         elem = &cur->tbl->elements[cur->ind];
-        free(elem->key);
         cur->tbl->inmemsz -= (elem->keylen + elem->dtalen);
 
-        /* malloc and copy */
-        keycopy = malloc(keylen + dtalen);
+        keycopy = temp_array_alloc(cur->tbl, keylen + dtalen);
         if (keycopy == NULL)
             return -1;
         dtacopy = keycopy + keylen;
@@ -944,6 +1012,14 @@ int bdb_temp_table_update(bdb_state_type *bdb_state, struct temp_cursor *cur,
         elem->dtalen = dtalen;
         elem->dta = dtacopy;
         cur->tbl->inmemsz += (elem->keylen + elem->dtalen);
+
+        if (cur->tbl->arenasz > cur->tbl->membudget) {
+            gbl_temptable_spills++;
+            rc = bdb_array_copy_to_temp_db(bdb_state, cur->tbl, bdberr);
+            if (unlikely(rc))
+                return -1;
+        }
+        return 0;
     }
 
     REOPEN_CURSOR(cur);
@@ -1400,8 +1476,6 @@ int bdb_temp_table_truncate(bdb_state_type *bdb_state, struct temp_table *tbl,
         return 0;
     int rc = 0;
     off_t sz;
-    unsigned long long int ii = 0;
-    arr_elem_t *elem;
 
     switch (tbl->temp_table_type) {
     case TEMP_TABLE_TYPE_HASH:
@@ -1422,11 +1496,7 @@ int bdb_temp_table_truncate(bdb_state_type *bdb_state, struct temp_table *tbl,
         break;
 
     case TEMP_TABLE_TYPE_ARRAY:
-        for (; ii != tbl->num_mem_entries; ++ii) {
-            elem = &tbl->elements[ii];
-            free(elem->key);
-        }
-        tbl->inmemsz = 0;
+        temp_array_reset_arena(tbl, 1);
         tbl->num_mem_entries = 0;
         break;
 
@@ -1568,8 +1638,6 @@ int bdb_temp_table_destroy_lru(struct temp_table *tbl,
 {
     DB_MPOOL_STAT *tmp;
     int rc;
-    unsigned long long ii;
-    arr_elem_t *elem;
 
     rc = 0;
 
@@ -1657,16 +1725,12 @@ int bdb_temp_table_destroy_lru(struct temp_table *tbl,
     } break;
 
     case TEMP_TABLE_TYPE_ARRAY:
-        for (ii = 0; ii != tbl->num_mem_entries; ++ii) {
-            elem = &tbl->elements[ii];
-            free(elem->key);
-        }
-        break;
-
     case TEMP_TABLE_TYPE_BTREE:
         break;
     }
 
+    temp_array_reset_arena(tbl, 0);
+
     if (tbl->temp_hash_tbl != NULL)
         hash_free(tbl->temp_hash_tbl);
     free(tbl->elements);
@@ -1724,7 +1788,6 @@ int bdb_temp_table_delete(bdb_state_type *bdb_state, struct temp_cursor *cur,
 
     if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_ARRAY) {
         elem = &cur->tbl->elements[cur->ind];
-        free(elem->key);
         --cur->tbl->num_mem_entries;
         cur->tbl->inmemsz -= (elem->keylen + elem->dtalen);
         memmove(elem, elem + 1,
@@ -2324,7 +2387,7 @@ static int bdb_temp_table_insert_put(bdb_state_type *bdb_state,
            If 1 or more elements of the same key already exist,
            insert it after the last one of those elements. */
 
-        keycopy = malloc(keylen + dtalen);
+        keycopy = temp_array_alloc(tbl, keylen + dtalen);
         if (keycopy == NULL)
             return -1;
         dtacopy = keycopy + keylen;
@@ -2364,7 +2427,7 @@ static int bdb_temp_table_insert_put(bdb_state_type *bdb_state,
         tbl->inmemsz += (keylen + dtalen);
 
         if (tbl->num_mem_entries == tbl->max_mem_entries ||
-            tbl->inmemsz > tbl->cachesz) {
+            tbl->arenasz > tbl->membudget) {
             gbl_temptable_spills++;
             rc = bdb_array_copy_to_temp_db(bdb_state, tbl, bdberr);
             if (unlikely(rc)) {
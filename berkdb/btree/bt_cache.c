@@ -15,8 +15,15 @@ uint32_t rcache_savd;
 uint32_t rcache_invalid;
 uint32_t rcache_collide;
 
+/*
+ * Per-thread lookaside copies of btree internal pages, for the top few
+ * levels of every tree.  A copy is only trusted by __bam_search after it has
+ * pinned the first page below the cached levels and checked that every page
+ * it walked through still has the generation and LSN it had when copied.
+ */
 typedef struct {
 	uint8_t fileid[DB_FILE_ID_LEN];
+	db_pgno_t pgno;
 	uint16_t gen;
 	uint32_t hitmiss;
 	void *bfpool_pg;
@@ -26,13 +33,14 @@ typedef struct {
 typedef struct {
 	size_t pgsz;
 	size_t count;
+	int levels;		/* Tree depths cached; the root is 0. */
 	CacheSlot slots[];
 } CacheHndl;
 
 static __thread CacheHndl *hndl = NULL;
 
 void
-rcache_init(size_t count, size_t pgsz)
+rcache_init(size_t count, size_t pgsz, int levels)
 {
 #ifdef __x86_64
 	if (pgsz % (4 * 1024) != 0) {
@@ -48,6 +56,7 @@ rcache_init(size_t count, size_t pgsz)
 	}
 	hndl->count = count;
 	hndl->pgsz = pgsz;
+	hndl->levels = levels > 0 ? levels : 1;
 	uint8_t *pages = (uint8_t *)&hndl->slots[count];
 	CacheSlot *slot = &hndl->slots[0];
 	CacheSlot *end = &hndl->slots[count];
@@ -62,10 +71,10 @@ rcache_init(size_t count, size_t pgsz)
 }
 
 static inline void
-hash_fileid(void *fileid, uint32_t * crc, uint32_t * hash)
+hash_fileid(void *fileid, db_pgno_t pgno, uint32_t * crc, uint32_t * hash)
 {
 	*crc = crc32c(fileid, DB_FILE_ID_LEN);
-	*hash = *crc % hndl->count;
+	*hash = (*crc ^ (pgno * 2654435761U)) % hndl->count;
 }
 
 void
@@ -78,19 +87,19 @@ rcache_destroy(void)
 }
 
 int
-rcache_find(DB *dbp, void **cached_pg, void **bfpool_pg,
-    uint16_t * gen, uint32_t * slot_ptr)
+rcache_find(DB *dbp, db_pgno_t pgno, int depth, void **cached_pg,
+    void **bfpool_pg, uint16_t * gen, uint32_t * slot_ptr)
 {
-	if (hndl == NULL || dbp->pgsize > hndl->pgsz)
+	if (hndl == NULL || dbp->pgsize > hndl->pgsz || depth >= hndl->levels)
 		return -1;
 	uint32_t crc, slot;
 
-	hash_fileid(dbp->fileid, &crc, &slot);
+	hash_fileid(dbp->fileid, pgno, &crc, &slot);
 	if (crc == 0)
 		return -1;
 	CacheSlot *cache = &hndl->slots[slot];
 
-	if (cache->bfpool_pg
+	if (cache->bfpool_pg && cache->pgno == pgno
 	    && memcmp(cache->fileid, dbp->fileid, DB_FILE_ID_LEN) == 0) {
 		*cached_pg = cache->cached_pg;
 		*bfpool_pg = cache->bfpool_pg;
@@ -106,18 +115,19 @@ rcache_find(DB *dbp, void **cached_pg, void **bfpool_pg,
 }
 
 int
-rcache_save(DB *dbp, void *page, uint16_t gen)
+rcache_save(DB *dbp, db_pgno_t pgno, int depth, void *page, uint16_t gen)
 {
-	if (hndl == NULL || dbp->pgsize > hndl->pgsz)
+	if (hndl == NULL || dbp->pgsize > hndl->pgsz || depth >= hndl->levels)
 		return -1;
 	uint32_t crc, slot;
 
-	hash_fileid(dbp->fileid, &crc, &slot);
+	hash_fileid(dbp->fileid, pgno, &crc, &slot);
 	if (crc == 0)
 		return -1;
 	CacheSlot *cache = &hndl->slots[slot];
 
-	if (cache->bfpool_pg) {
+	if (cache->bfpool_pg && (cache->pgno != pgno ||
+	    memcmp(cache->fileid, dbp->fileid, DB_FILE_ID_LEN) != 0)) {
 		++rcache_collide;
 		--cache->hitmiss;
 		if (cache->hitmiss) {	// slot in active use
@@ -125,6 +135,7 @@ rcache_save(DB *dbp, void *page, uint16_t gen)
 		}
 	}
 	cache->hitmiss = 1;
+	cache->pgno = pgno;
 	cache->bfpool_pg = page;
 	cache->gen = gen;
 	memcpy(cache->cached_pg, page, dbp->pgsize);
@@ -0,0 +1,76 @@
+#ifndef INCLUDE_BT_KEYCMP_H
+#define INCLUDE_BT_KEYCMP_H
+
+/*
+ * Inline byte-string compare for trees using __bam_defcmp.  Comdb2 keys are
+ * short memcmp-ordered ondisk strings, so most compares finish within the
+ * first 16 bytes; doing them here avoids a libc call per probed key.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+/*
+ * __bam_memcmp --
+ *	memcmp(), returning only the sign: 16 bytes at a time with SSE2, then
+ *	8 bytes at a time as big-endian words.
+ */
+static inline int
+__bam_memcmp(const void *a, const void *b, uint32_t len)
+{
+#if defined(__GNUC__)
+	const uint8_t *p = a, *q = b;
+	uint64_t x, y;
+
+#ifdef __x86_64__
+	for (; len >= 16; p += 16, q += 16, len -= 16) {
+		__m128i u = _mm_loadu_si128((const __m128i *)p);
+		__m128i v = _mm_loadu_si128((const __m128i *)q);
+		uint32_t m = _mm_movemask_epi8(_mm_cmpeq_epi8(u, v)) ^ 0xffff;
+		if (m) {
+			m = __builtin_ctz(m);
+			return p[m] < q[m] ? -1 : 1;
+		}
+	}
+#endif
+	for (; len >= 8; p += 8, q += 8, len -= 8) {
+		memcpy(&x, p, 8);
+		memcpy(&y, q, 8);
+		if (x != y) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			x = __builtin_bswap64(x);
+			y = __builtin_bswap64(y);
+#endif
+			return x < y ? -1 : 1;
+		}
+	}
+	for (; len; ++p, ++q, --len)
+		if (*p != *q)
+			return *p < *q ? -1 : 1;
+	return 0;
+#else
+	int cmp = memcmp(a, b, len);
+	return cmp < 0 ? -1 : cmp > 0;
+#endif
+}
+
+/*
+ * __bam_keycmp --
+ *	Compare two keys the way __bam_defcmp does: bytewise, then shorter
+ *	sorts first.
+ */
+static inline int
+__bam_keycmp(const void *a, uint32_t alen, const void *b, uint32_t blen)
+{
+	int cmp;
+
+	if ((cmp = __bam_memcmp(a, b, alen < blen ? alen : blen)) != 0)
+		return (cmp);
+	return (alen < blen ? -1 : alen > blen);
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include <dbinc/btree.h>
 #include <btree/bt_prefix.h>
 #include <btree/bt_cache.h>
+#include <btree/bt_keycmp.h>
 
 #include <stdlib.h>
 #include <stdarg.h>
@@ -400,6 +401,64 @@ bk_decompress_int(pfx_t * pfx, BKEYDATA *bk, void *buf)
 	return tmp;
 }
 
+/*
+ * Compare key against the prefix of a page's compressed keys, in
+ * __bam_defcmp order.  A non-zero result is also the result of comparing key
+ * against every key on the page which has B_PFX set.
+ */
+int
+pfx_keycmp(const pfx_t * pfx, const DBT *key)
+{
+	int cmp;
+
+	cmp = __bam_memcmp(key->data, pfx->pfx,
+	    key->size < pfx->npfx ? key->size : pfx->npfx);
+	if (cmp == 0 && key->size < pfx->npfx)
+		cmp = -1;
+	return cmp;
+}
+
+/*
+ * Compare key against compressed bk in __bam_defcmp order.  pfx is the page
+ * prefix and pfxcmp is pfx_keycmp(pfx, key), both worked out once per page.
+ * Prefix/suffix compressed keys are compared in place; only rle keys are
+ * rebuilt into buf.
+ */
+int
+bk_pfx_cmp(pfx_t * pfx, int pfxcmp, BKEYDATA *bk, const DBT *key, void *buf,
+    int *cmpp)
+{
+	const uint8_t *k;
+	uint32_t klen;
+	db_indx_t bklen;
+	int cmp;
+
+	if (B_PISSET(bk) && pfxcmp != 0) {
+		*cmpp = pfxcmp;
+		return 0;
+	}
+	if (B_RISSET(bk)) {
+		if ((bk = bk_decompress_int(pfx, bk, buf)) == NULL)
+			return 1;
+		ASSIGN_ALIGN(db_indx_t, bklen, bk->len);
+		*cmpp = __bam_keycmp(key->data, key->size, bk->data, bklen);
+		return 0;
+	}
+
+	/* key starts with the prefix: compare the rest to data + suffix */
+	k = (uint8_t *)key->data + pfx->npfx;
+	klen = key->size - pfx->npfx;
+	ASSIGN_ALIGN(db_indx_t, bklen, bk->len);
+	cmp = __bam_memcmp(k, bk->data, klen < bklen ? klen : bklen);
+	if (cmp == 0 && klen > bklen)
+		cmp = __bam_memcmp(k + bklen, pfx->sfx,
+		    klen - bklen < pfx->nsfx ? klen - bklen : pfx->nsfx);
+	if (cmp == 0)
+		cmp = klen < bklen + pfx->nsfx ? -1 : klen > bklen + pfx->nsfx;
+	*cmpp = cmp;
+	return 0;
+}
+
 static int
 find_pfx(DB *dbp, PAGE *h, pfx_t * pfx)
 {
@@ -20,6 +20,11 @@ typedef struct pfx_type_t pfx_t;
 pfx_t *pgpfx(struct __db *, struct _db_page *, void *buf, int sz);
 struct _bkeydata *bk_decompress_int(pfx_t *, struct _bkeydata *, void *buf);
 
+//for bt_search: compare against compressed keys without rebuilding them
+int pfx_keycmp(const pfx_t *, const DBT *key);
+int bk_pfx_cmp(pfx_t *, int pfxcmp, struct _bkeydata *, const DBT *key,
+    void *buf, int *cmpp);
+
 void prefix_tocpu(struct __db *, struct _db_page *);
 void prefix_fromcpu(struct __db *, struct _db_page *);
 
@@ -63,6 +63,7 @@ static const char revid[] = "$Id: bt_search.c,v 11.47 2003/06/30 17:19:35 bostic
 #include <thread_util.h>
 #include <btree/bt_prefix.h>
 #include <btree/bt_cache.h>
+#include <btree/bt_keycmp.h>
 
 #include <btree/bt_pf.h>
 
@@ -80,9 +81,12 @@ static const char revid[] = "$Id: bt_search.c,v 11.47 2003/06/30 17:19:35 bostic
  *
  * PUBLIC: int __bam_cmp __P((DB *, const DBT *, PAGE *,
  * PUBLIC:    u_int32_t, int (*)(DB *, const DBT *, const DBT *), int *));
+ *
+ * pfx is the decoded prefix of a compressed leaf page searched with
+ * __bam_defcmp, and pfxcmp the key compared against it; NULL otherwise.
  */
 static inline int
-__bam_cmp_inline(dbp, dbt, h, indx, func, cmpp, buf)
+__bam_cmp_inline(dbp, dbt, h, indx, func, cmpp, buf, pfx, pfxcmp)
 	DB *dbp;
 	const DBT *dbt;
 	PAGE *h;
@@ -90,6 +94,8 @@ __bam_cmp_inline(dbp, dbt, h, indx, func, cmpp, buf)
 	int (*func)__P((DB *, const DBT *, const DBT *));
 	int *cmpp;
 	uint8_t *buf;
+	pfx_t *pfx;
+	int pfxcmp;
 {
 	BINTERNAL *bi;
 	BKEYDATA *bk;
@@ -116,21 +122,19 @@ __bam_cmp_inline(dbp, dbt, h, indx, func, cmpp, buf)
 		bk = GET_BKEYDATA(dbp, h, indx);
 		if (B_TYPE(bk) == B_OVERFLOW)
 			bo = (BOVERFLOW *)bk;
-		else {
+		else if (pfx != NULL && (B_PISSET(bk) || B_RISSET(bk))) {
+			if (bk_pfx_cmp(pfx, pfxcmp, bk, dbt, buf, cmpp) != 0)
+				return (__db_pgfmt(dbp->dbenv, PGNO(h)));
+			return (0);
+		} else {
 			bk_decompress(dbp, h, &bk, buf, KEYBUF);
 			pg_dbt.app_data = NULL;
 			pg_dbt.data = bk->data;
 			ASSIGN_ALIGN_DIFF(u_int32_t, pg_dbt.size, db_indx_t,
 			    bk->len);
 			if (likely(func == __bam_defcmp)) {
-				int len;
-				len = dbt->size > pg_dbt.size ? pg_dbt.size
-				    : dbt->size;
-				*cmpp = memcmp(dbt->data, pg_dbt.data, len);
-				if (unlikely(*cmpp == 0))
-					*cmpp =
-					    ((long)dbt->size -
-					    (long)pg_dbt.size);
+				*cmpp = __bam_keycmp(dbt->data, dbt->size,
+				    pg_dbt.data, pg_dbt.size);
 			} else {
 				*cmpp = func(dbp, dbt, &pg_dbt);
 			}
@@ -169,14 +173,8 @@ __bam_cmp_inline(dbp, dbt, h, indx, func, cmpp, buf)
 			pg_dbt.data = bi->data;
 			pg_dbt.size = bi->len;
 			if (likely(func == __bam_defcmp)) {
-				int len;
-
-				len = dbt->size > pg_dbt.size ? pg_dbt.size
-				    : dbt->size;
-				*cmpp = memcmp(dbt->data, pg_dbt.data, len);
-				if (unlikely((*cmpp == 0)))
-					*cmpp = ((long)dbt->size -
-					    (long)pg_dbt.size);
+				*cmpp = __bam_keycmp(dbt->data, dbt->size,
+				    pg_dbt.data, pg_dbt.size);
 			} else {
 				*cmpp = func(dbp, dbt, &pg_dbt);
 			}
@@ -307,6 +305,91 @@ genidsetzero(void *g)
 	memset(g, 0, HASH_GENID_SIZE);
 }
 
+/*
+ * The pages __bam_search walked through as rcache copies: the mpool buffer
+ * each copy was taken from, and the generation and LSN the copy had.
+ */
+#define	RCACHE_MAXPATH	8
+struct rcache_ref {
+	void *bfpool_pg;
+	DB_LSN lsn;
+	db_pgno_t pgno;
+	uint32_t slot;
+	uint16_t gen;
+};
+
+static inline int
+__bam_rcache_get(dbp, pgno, depth, ref, hp)
+	DB *dbp;
+	db_pgno_t pgno;
+	int depth;
+	struct rcache_ref *ref;
+	PAGE **hp;
+{
+	void *cached_pg;
+
+	if (depth >= RCACHE_MAXPATH || rcache_find(dbp, pgno, depth,
+	    &cached_pg, &ref->bfpool_pg, &ref->gen, &ref->slot) != 0)
+		return (-1);
+	ref->lsn = LSN(cached_pg);
+	ref->pgno = pgno;
+	*hp = cached_pg;
+	return (0);
+}
+
+static inline void
+__bam_rcache_drop(path, n)
+	struct rcache_ref *path;
+	int n;
+{
+	int i;
+
+	for (i = 0; i < n; ++i)
+		rcache_invalidate(path[i].slot);
+}
+
+/*
+ * __bam_rcache_valid --
+ *	A walk through rcache copies is only good if none of the buffers they
+ *	were taken from has changed since, or been reused for another page.
+ *	Called once the first real page below them is pinned and locked;
+ *	invalidates any stale slots.
+ */
+static int
+__bam_rcache_valid(dbp, path, n)
+	DB *dbp;
+	struct rcache_ref *path;
+	int n;
+{
+	BH *bhp;
+	int i, valid;
+
+	for (valid = 1, i = 0; i < n; ++i) {
+		bhp = GET_BH(path[i].bfpool_pg);
+		if (path[i].gen != GET_BH_GEN(path[i].bfpool_pg) ||
+		    bhp->pgno != path[i].pgno || bhp->mpf != dbp->mpf->mfp ||
+		    PGNO(path[i].bfpool_pg) != path[i].pgno ||
+		    log_compare(&path[i].lsn, &LSN(path[i].bfpool_pg)) != 0 ||
+		    path[i].gen != GET_BH_GEN(path[i].bfpool_pg)) {
+			rcache_invalidate(path[i].slot);
+			valid = 0;
+		}
+	}
+	return (valid);
+}
+
+static inline void
+__bam_rcache_save(dbp, h, depth)
+	DB *dbp;
+	PAGE *h;
+	int depth;
+{
+	uint16_t gen = LSN(h).file + LSN(h).offset;
+
+	GET_BH_GEN(h) = gen;
+	rcache_save(dbp, PGNO(h), depth, h, gen);
+}
+
 /*
  * __bam_search --
  *	Search a btree for a key.
@@ -335,11 +418,11 @@ __bam_search(dbc, root_pgno, key, flags, stop, recnop, exactp)
 	db_recno_t recno;
 	int adjust, cmp, deloffset, ret, stack;
 	int (*func) __P((DB *, const DBT *, const DBT *));
-	void *cached_pg = NULL;
-	void *bfpool_pg = NULL;
-	int save = 0;
-	uint16_t gen;
-	uint32_t slot;
+	struct rcache_ref rc_path[RCACHE_MAXPATH];
+	int save = 0, rc_off = 0, rc_walk = 0, rc_n = 0, depth = 0;
+	uint8_t pfxbuf[KEYBUF];
+	pfx_t *pfx;
+	int pfxcmp = 0;
 	unsigned int hh = 0;
 	genid_hash *hash = NULL;
 	__genid_pgno *hashtbl = NULL;
@@ -390,12 +473,13 @@ try_again:
 
 	extern int gbl_rcache;
 
-	if (gbl_rcache && pg == 1 && bfpool_pg == NULL &&
-	    lock_mode == DB_LOCK_READ && LF_ISSET(S_FIND)) {
+	depth = rc_n = rc_walk = 0;
+	if (gbl_rcache && pg == 1 && lock_mode == DB_LOCK_READ &&
+	    LF_ISSET(S_FIND) && !LF_ISSET(S_WRITE | S_PARENT | S_STK_ONLY)) {
 		save = 1;
-		if (rcache_find(
-		    dbp, &cached_pg, &bfpool_pg, &gen, &slot) == 0) {
-			h = cached_pg;
+		if (!rc_off &&
+		    __bam_rcache_get(dbp, pg, 0, &rc_path[0], &h) == 0) {
+			rc_n = rc_walk = 1;
 			goto got_pg;
 		}
 	}
@@ -519,12 +603,8 @@ hash_backup:
 		}
 	}
 
-	if (save && TYPE(h) == P_IBTREE) {	// WORKS ONLY WHEN ROOT IS INTERNAL
-		uint16_t gen = LSN(h).file + LSN(h).offset;
-
-		GET_BH_GEN(h) = gen;
-		rcache_save(dbp, h, gen);
-	}
+	if (save && TYPE(h) == P_IBTREE)
+		__bam_rcache_save(dbp, h, 0);
 
 	INTERNAL_PTR_CHECK(cp == dbc->internal);
 
@@ -581,6 +661,16 @@ got_pg:func = t->bt_compare;
 		adjust = TYPE(h) == P_LBTREE ? P_INDX : O_INDX;
 		uint8_t buf[KEYBUF];
 
+		/*
+		 * Decode a compressed leaf page's prefix once, rather than
+		 * once per probed key in bk_decompress.
+		 */
+		pfx = NULL;
+		if (IS_PREFIX(h) && func == __bam_defcmp &&
+		    (TYPE(h) == P_LBTREE || TYPE(h) == P_LDUP) &&
+		    (pfx = pgpfx(dbp, h, pfxbuf, KEYBUF)) != NULL)
+			pfxcmp = pfx_keycmp(pfx, key);
+
 		for (base = 0,
 		    lim = NUM_ENT(h) / (db_indx_t) adjust; lim != 0;
 		    lim >>= 1) {
@@ -588,7 +678,7 @@ got_pg:func = t->bt_compare;
 
 			if ((ret =
 				__bam_cmp_inline(dbp, key, h, indx, func, &cmp,
-				    buf)) != 0)
+				    buf, pfx, pfxcmp)) != 0)
 				goto err;
 			if (cmp == 0) {
 				if (TYPE(h) == P_LBTREE || TYPE(h) == P_LDUP)
@@ -727,7 +817,17 @@ next:		if (recnop != NULL)
 			lock_mode = stack &&
 			    LF_ISSET(S_WRITE) ? DB_LOCK_WRITE : DB_LOCK_READ;
 
-			if (cached_pg) {
+			if (rc_walk && !stack && __bam_rcache_get(dbp, pg,
+			    depth + 1, &rc_path[rc_n], &h) == 0) {
+				/*
+				 * The child is an internal page we also have
+				 * a copy of; keep walking the copies.
+				 */
+				++rc_n;
+				++depth;
+				continue;
+			}
+			if (rc_walk) {
 				/* Used rcache to get here. Don't lck couple. */
 				if ((ret = __db_lget(dbc, 0, pg, lock_mode, 0,
 					    &lock)) != 0)
@@ -755,37 +855,36 @@ next:		if (recnop != NULL)
 #endif
 		ret = PAGEGET(dbc, mpf, &pg, 0, &h);
 		if (ret != 0) {
-			if (cached_pg) {
+			if (rc_walk) {
 				/*
 				 * Used rcache and failed getting child
 				 * page. Let's retry w/o rcache.
 				 */
-				cached_pg = NULL;
-
-				rcache_invalidate(slot);
+				__bam_rcache_drop(rc_path, rc_n);
 				__LPUT(dbc, lock);
+				rc_off = 1;
 				goto try_again;
 			}
 			goto err;
 		}
 
-		if (cached_pg) {
-			/* Used rcache and got child page. Validate rcache. */
-			DB_LSN *l1 = &LSN(cached_pg);
-			DB_LSN *l2 = &LSN(bfpool_pg);
-			cached_pg = NULL;
-
-			if (gen == GET_BH_GEN(bfpool_pg)
-			    && memcmp(l1, l2, sizeof(DB_LSN)) == 0 && gen == GET_BH_GEN(bfpool_pg)	//re-check. warm&fuzzy
-			    ) {
-				;
-			} else {
+		if (rc_walk) {
+			/*
+			 * Used rcache and got child page.  Validate every
+			 * copy we walked through, and search from the root
+			 * without the cache if any of them went stale.
+			 */
+			rc_walk = 0;
+			if (!__bam_rcache_valid(dbp, rc_path, rc_n)) {
 				PAGEPUT(dbc, mpf, h, 0);
 				__LPUT(dbc, lock);
-				rcache_invalidate(slot);
+				rc_off = 1;
 				goto try_again;
 			}
 		}
+		++depth;
+		if (save && TYPE(h) == P_IBTREE)
+			__bam_rcache_save(dbp, h, depth);
 
 		/* we are cracking a btree; check here the format of the
 		 * new page instead of using a potential corrupted page
@@ -173,6 +173,8 @@ struct __modsnap_txn; typedef struct __modsnap_txn MODSNAP_TXN;
 
 struct __mempv; typedef struct __mempv DB_MEMPV;
 struct __mempv_cache; typedef struct __mempv_cache MEMPV_CACHE;
+struct __mempv_cache_shard; typedef struct __mempv_cache_shard MEMPV_CACHE_SHARD;
+struct __db_mempv_stat; typedef struct __db_mempv_stat DB_MEMPV_STAT;
 struct __mempv_cache_page_header; typedef struct __mempv_cache_page_header MEMPV_CACHE_PAGE_HEADER;
 struct __mempv_cache_page_key; typedef struct __mempv_cache_page_key MEMPV_CACHE_PAGE_KEY;
 struct __mempv_cache_page_versions; typedef struct __mempv_cache_page_versions MEMPV_CACHE_PAGE_VERSIONS;
@@ -521,8 +523,16 @@ struct __db_lock_stat {
 	u_int64_t st_nreleases;		/* Number of lock puts. */
 	u_int64_t st_nnowaits;		/* Number of requests that would have
 					   waited, but NOWAIT was set. */
+	u_int64_t st_nfastpath;		/* Read locks granted without
+					   walking the holders. */
 	u_int64_t st_ndeadlocks;	/* Number of lock deadlocks. */
 	u_int64_t st_locks_aborted;	/* Number of locks released on deadlocks.*/
+	u_int64_t st_ndetects;		/* Number of deadlock detector runs. */
+	u_int64_t st_ndetect_walks;	/* Waits-for walks on lock waits. */
+	u_int64_t st_ndetect_skipped;	/* Detector runs a walk avoided. */
+	u_int64_t st_detect_usecs;	/* Time spent in the detector. */
+	u_int64_t st_detect_max_usecs;	/* Longest detector run. */
+	u_int64_t st_detect_max_lockers;/* Most waiting lockers in a run. */
 	db_timeout_t st_locktimeout;	/* Lock timeout. */
 	u_int64_t st_nlocktimeouts;	/* Number of lock timeouts. */
 	db_timeout_t st_txntimeout;	/* Transaction timeout. */
@@ -735,6 +745,8 @@ struct __db_log_stat {
 	u_int32_t st_ondisk_get;	/* On-disk log_get. */
 	u_int32_t st_inmem_trav;	/* Mem-log steps for partial reads. */
 	u_int32_t st_wrap_copy;		/* Count of wrapped copies. */
+	u_int32_t st_deferred_copies;	/* Pieces copied outside region lock. */
+	u_int32_t st_copy_waits;	/* Waits for deferred copies. */
 };
 
 /*******************************************************
@@ -924,6 +936,11 @@ struct __db_mpool_stat {
 	u_int64_t st_pf_evict;		/* Prefault pages forced from  cache. */
 	u_int64_t st_rw_evict_skip;	/* Dirty pages skipped during evict. */
 	u_int64_t st_page_trickle;	/* Pages written by memp_trickle. */
+	u_int64_t st_trickle_passes;	/* Passes made by memp_trickle. */
+	u_int64_t st_trickle_paced;	/* Pages added by log pacing. */
+	u_int64_t st_trickle_logbytes;	/* Log bytes seen by memp_trickle. */
+	u_int64_t st_trickle_dirty;	/* Dirty pages at the last pass. */
+	u_int64_t st_trickle_max_dirty;	/* Max dirty pages seen by a pass. */
 	u_int64_t st_pages;		/* Total number of pages. */
 	u_int64_t st_page_clean;	/* Clean pages. */
 	uint32_t  st_page_dirty;	/* Dirty pages. */
@@ -934,6 +951,9 @@ struct __db_mpool_stat {
 	u_int64_t st_hash_nowait;	/* Hash lock granted with nowait. */
 	u_int64_t st_hash_wait;		/* Hash lock granted after wait. */
 	u_int64_t st_hash_max_wait;	/* Max hash lock granted after wait. */
+	u_int64_t st_hash_max_wait_bucket;/* Bucket with the most waits. */
+	u_int64_t st_hash_optimistic;	/* Pinned without the hash lock. */
+	u_int64_t st_hash_optimistic_fail; /* Lock-free lookups retried. */
 	u_int64_t st_region_nowait;	/* Region lock granted with nowait. */
 	u_int64_t st_region_wait;	/* Region lock granted after wait. */
 	u_int64_t st_alloc;		/* Number of page allocations. */
@@ -2610,6 +2630,7 @@ struct __db_env {
 	int  (*memp_load) __P((DB_ENV *, COMDB2BUF *));
 	int  (*memp_dump_default) __P((DB_ENV *, u_int32_t));
 	int  (*memp_load_default) __P((DB_ENV *));
+	int  (*mempv_stat) __P((DB_ENV *, DB_MEMPV_STAT *));
 	int  (*memp_trickle) __P((DB_ENV *, int, int *, int));
 
 	void *rep_handle;		/* Replication handle and methods. */
@@ -2927,13 +2948,42 @@ struct __mempv_cache_page_key
 	u_int8_t ufid[DB_FILE_ID_LEN];
 }; 
 
-struct __mempv_cache
+#define	MEMPV_CACHE_SHARDS	16
+
+struct __mempv_cache_shard
 {
 	int num_cached_pages;
+	size_t bytes;
 	hash_t *pages;
-	mspace *msp;
 	pthread_mutex_t lock;
 	LISTC_T(struct __mempv_cache_page_header) evict_list;
+
+	/* Statistics, protected by lock. */
+	u_int64_t hits;
+	u_int64_t misses;
+	u_int64_t evictions;
+	u_int64_t rebuilds;
+	u_int64_t undo_records;
+	u_int64_t max_undo_chain;
+};
+
+struct __mempv_cache
+{
+	struct __mempv_cache_shard shards[MEMPV_CACHE_SHARDS];
+	int num_cached_pages;	/* All shards, atomic: the entry limit is global. */
+};
+
+/* Versioned memory pool cache statistics. */
+struct __db_mempv_stat {
+	u_int64_t st_entries;		/* Page versions cached. */
+	u_int64_t st_bytes;		/* Bytes held by cached versions. */
+	u_int64_t st_max_bytes;		/* Byte budget of the cache. */
+	u_int64_t st_hits;		/* Versions found in the cache. */
+	u_int64_t st_misses;		/* Versions not found in the cache. */
+	u_int64_t st_evictions;		/* Versions evicted from the cache. */
+	u_int64_t st_rebuilds;		/* Versions rebuilt from the log. */
+	u_int64_t st_undo_records;	/* Log records undone by rebuilds. */
+	u_int64_t st_max_undo_chain;	/* Most records undone for a version. */
 };
 
 struct __mempv {
@@ -2950,6 +3000,7 @@ struct __mempv_cache_page_header
 {
 	DB_LSN snapshot_lsn;
 	u_int8_t checksum[20];
+	size_t size;
 	struct __mempv_cache_page_versions *cache;
 	LINKC_T(struct __mempv_cache_page_header) evict_link;
 	u_int8_t page[1];
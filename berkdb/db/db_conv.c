@@ -376,9 +376,11 @@ __db_pgout(dbenv, pg, pp, cookie)
 			SET_CRC32C(pp);
 		else
 			CLR_CRC32C(pp);
-		__db_chksum(pp, sum_len, key, chksum);
-		if (F_ISSET(dbp, DB_AM_SWAP))
+		if (F_ISSET(dbp, DB_AM_SWAP)) {
+			__db_chksum(pp, sum_len, key, chksum);
 			P_32_SWAP(chksum);
+		} else
+			__db_chksum_defer(pp, sum_len, key, chksum);
 	}
 	return (0);
 }
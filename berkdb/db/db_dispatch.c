@@ -451,6 +451,76 @@ ufid_for_recovery_record(DB_ENV *env, DB_LSN *lsn, int rectype,
 	return is_fuid;
 }
 
+/*
+ * __db_forward_op --
+ *	Decide whether the forward pass of recovery redoes a record, and with
+ *	which op.  Returns non-zero if the recovery function should be called.
+ *	This may reorder the transaction list, so it must not run concurrently
+ *	with anything else using it.
+ *
+ * PUBLIC: int __db_forward_op __P((DB_ENV *,
+ * PUBLIC:     u_int32_t, u_int32_t, void *, db_recops *));
+ */
+int
+__db_forward_op(dbenv, rectype, txnid, info, opp)
+	DB_ENV *dbenv;
+	u_int32_t rectype, txnid;
+	void *info;
+	db_recops *opp;
+{
+	int make_call, ret;
+
+	make_call = ret = 0;
+	*opp = DB_TXN_FORWARD_ROLL;
+
+	/*
+	 * In the forward pass, if we haven't seen the transaction,
+	 * do nothing, else recover it.
+	 *
+	 * We need to always redo DB___db_noop records, so that we
+	 * properly handle any commits after the file was closed.
+	 */
+	switch (rectype) {
+	case DB___txn_recycle:
+	case DB___txn_ckp:
+	case DB___txn_ckp_recovery:
+	case DB___db_noop:
+		make_call = 1;
+		break;
+
+	default:
+		if (txnid != 0 && (ret = __db_txnlist_find(dbenv,
+		    info, txnid)) == TXN_COMMIT)
+			make_call = 1;
+		else if (ret != TXN_IGNORE &&
+		    (rectype == DB___ham_metagroup ||
+		    rectype == DB___ham_groupalloc ||
+		    rectype == DB___db_pg_alloc)) {
+			/*
+			 * Because we cannot undo file extensions
+			 * all allocation records must be reprocessed
+			 * during rollforward in case the file was
+			 * just created.  It may not have been
+			 * present during the backward pass.
+			 */
+			make_call = 1;
+			*opp = DB_TXN_BACKWARD_ALLOC;
+		} else if (rectype == DB___dbreg_register) {
+			/*
+			 * This may be a transaction dbreg_register.
+			 * If it is, we only make the call on a COMMIT,
+			 * which we checked above. If it's not, then we
+			 * should always make the call, because we need
+			 * the file open information.
+			 */
+			if (txnid == 0)
+				make_call = 1;
+		}
+	}
+
+	return (make_call);
+}
+
 /*
  * __db_dispatch --
  *
@@ -659,50 +729,8 @@ __db_dispatch(dbenv, dtab, dtabsize, db, lsnp, redo, info)
 		}
 		break;
 	case DB_TXN_FORWARD_ROLL:
-		/*
-		 * In the forward pass, if we haven't seen the transaction,
-		 * do nothing, else recover it.
-		 *
-		 * We need to always redo DB___db_noop records, so that we
-		 * properly handle any commits after the file was closed.
-		 */
-		switch (rectype) {
-		case DB___txn_recycle:
-		case DB___txn_ckp:
-		case DB___txn_ckp_recovery:
-		case DB___db_noop:
-			make_call = 1;
-			break;
-
-		default:
-			if (txnid != 0 && (ret = __db_txnlist_find(dbenv,
-			    info, txnid)) == TXN_COMMIT)
-				make_call = 1;
-			else if (ret != TXN_IGNORE &&
-			    (rectype == DB___ham_metagroup ||
-			    rectype == DB___ham_groupalloc ||
-			    rectype == DB___db_pg_alloc)) {
-				/*
-				 * Because we cannot undo file extensions
-				 * all allocation records must be reprocessed
-				 * during rollforward in case the file was
-				 * just created.  It may not have been
-				 * present during the backward pass.
-				 */
-				make_call = 1;
-				redo = DB_TXN_BACKWARD_ALLOC;
-			} else if (rectype == DB___dbreg_register) {
-				/*
-				 * This may be a transaction dbreg_register.
-				 * If it is, we only make the call on a COMMIT,
-				 * which we checked above. If it's not, then we
-				 * should always make the call, because we need
-				 * the file open information.
-				 */
-				if (txnid == 0)
-					make_call = 1;
-			}
-		}
+		make_call =
+		    __db_forward_op(dbenv, rectype, txnid, info, &redo);
 		break;
 	case DB_TXN_GETPGNOS:
 		/*
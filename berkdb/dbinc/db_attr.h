@@ -57,11 +57,19 @@ BERK_DEF_ATTR(latch_max_poll, "Poll latch this many times before returning deadl
 BERK_DEF_ATTR(latch_timed_mutex, "Use a timed mutex", BERK_ATTR_TYPE_BOOLEAN, 1)
 BERK_DEF_ATTR(log_cursor_cache, "Cache log cursors", BERK_ATTR_TYPE_BOOLEAN, 0)
 BERK_DEF_ATTR(recovery_processor_poll_interval_us, "Recovery processor wakes this often to check workers", BERK_ATTR_TYPE_INTEGER, 1000)
+BERK_DEF_ATTR(recovery_redo_threads, "Threads used to redo the forward pass of local recovery (0 or 1 to redo serially)", BERK_ATTR_TYPE_INTEGER, 0)
+BERK_DEF_ATTR(recovery_redo_batch, "Page records queued to the recovery redo threads before waiting for them", BERK_ATTR_TYPE_INTEGER, 10000)
 BERK_DEF_ATTR(lsnerr_logflush, "Flush log on lsn error", BERK_ATTR_TYPE_BOOLEAN, 1)
 BERK_DEF_ATTR(tracked_locklist_init, "Initial allocation count for tracked locks", BERK_ATTR_TYPE_INTEGER, 10)
 /* This is a placeholder for now */
 BERK_DEF_ATTR(transient_page_reallocation, "Orphaned pages are maintained locally", BERK_ATTR_TYPE_BOOLEAN, 0)
 BERK_DEF_ATTR(elect_highest_committed_gen, "Bias election by the highest generation in the logfile", BERK_ATTR_TYPE_BOOLEAN, 1)
 BERK_DEF_ATTR(sync_standalone, "Force a log-sync at commit for standalone instances", BERK_ATTR_TYPE_BOOLEAN, 0)
+BERK_DEF_ATTR(mpool_optimistic_fget, "Pin cached pages without taking the mpool hash bucket mutex", BERK_ATTR_TYPE_BOOLEAN, 1)
+BERK_DEF_ATTR(lock_read_fastpath, "Grant uncontended read locks without checking the lock object's holders for conflicts", BERK_ATTR_TYPE_BOOLEAN, 0)
+BERK_DEF_ATTR(lock_detect_incremental, "Only run the deadlock detector on a lock wait that can close a waits-for cycle", BERK_ATTR_TYPE_BOOLEAN, 1)
+BERK_DEF_ATTR(memp_trickle_pace_mb, "Have the cache flusher write the dirty pages once for every this many MB of log generated (0 to disable)", BERK_ATTR_TYPE_INTEGER, 0)
+BERK_DEF_ATTR(log_put_deferred_copy, "Copy log records into the segmented log buffer after dropping the log region lock", BERK_ATTR_TYPE_BOOLEAN, 0)
 BERK_DEF_ATTR(mempv_max_cache_entries, "Maximum number of cache entries in versioned memory pool", BERK_ATTR_TYPE_INTEGER, 50)
+BERK_DEF_ATTR(mempv_cache_bytes, "Memory budget in bytes of the page version cache in versioned memory pool", BERK_ATTR_TYPE_INTEGER, 64 * MEGABYTE)
 BERK_DEF_ATTR(mempv_debug, "Produce debug output in versioned memory pool", BERK_ATTR_TYPE_BOOLEAN, 0)
@@ -191,6 +191,7 @@ typedef struct __db_lockobj {
 	SH_TAILQ_ENTRY(__db_lockobj) dd_links;	/* Links for dd list. */
 	SH_TAILQ_HEAD(__waitl, __db_lock) waiters;	/* List of waiting locks. */
 	SH_TAILQ_HEAD(__holdl, __db_lock) holders;	/* List of held locks. */
+	u_int32_t nexcl;		/* Holders that conflict with a read. */
 					/* Declare room in the object to hold
 					 * typical DB lock structures so that
 					 * we do not have to allocate them from
@@ -318,6 +319,21 @@ typedef struct __db_locktab {
 
 #define	OBJ_LINKS_VALID(O, L) ((O)->L.tqe_prev != (void *)-1)
 
+/*
+ * Keep an object's count of holders whose mode conflicts with a read lock,
+ * which lets __lock_get_internal grant uncontended read locks without
+ * walking the holders list.  Called with the object partition locked
+ * whenever a lock joins or leaves the holders list or changes mode there.
+ */
+#define	OBJ_HOLDER_ADD(T, R, O, M) do {					\
+	if (CONFLICTS(T, R, M, DB_LOCK_READ))				\
+		(O)->nexcl++;						\
+} while (0)
+#define	OBJ_HOLDER_DEL(T, R, O, M) do {					\
+	if (CONFLICTS(T, R, M, DB_LOCK_READ))				\
+		(O)->nexcl--;						\
+} while (0)
+
 struct __db_lockobj_lsn {
 	__DB_DBT_INTERNAL
 
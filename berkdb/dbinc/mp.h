@@ -179,8 +179,28 @@ struct __db_mpool_hash {
 	HashTab 	hash_bucket;	/* Head of bucket. */
 	uint32_t 	hash_page_dirty;/* Count of dirty pages. */
 	u_int32_t	hash_priority;	/* Minimum priority of bucket buffer. */
+	u_int32_t	hash_gen;	/* Chain generation, odd mid-update. */
+	u_int32_t	hash_optimistic_fail; /* Lock-free lookups retried. */
 };
 
+/*
+ * The hash chain may be walked without the bucket mutex (see the optimistic
+ * path in __memp_fget).  Anything that links or unlinks a buffer header must
+ * hold the bucket mutex and bracket the change with MP_HASH_WRITE_BEGIN and
+ * MP_HASH_WRITE_END, so a lock-free reader can tell its walk was disturbed.
+ */
+#define	MP_HASH_WRITE_BEGIN(hp)	(void)ATOMIC_ADD32((hp)->hash_gen, 1)
+#define	MP_HASH_WRITE_END(hp)	(void)ATOMIC_ADD32((hp)->hash_gen, 1)
+
+/*
+ * Buffer reference counts can be taken without the bucket mutex by the
+ * optimistic lookup, so every change to BH->ref must be atomic, even when
+ * the bucket mutex is held.
+ */
+#define	BH_REF(bhp)		ATOMIC_LOAD16((bhp)->ref)
+#define	BH_REF_INC(bhp)		ATOMIC_ADD16((bhp)->ref, 1)
+#define	BH_REF_DEC(bhp)		ATOMIC_ADD16((bhp)->ref, -1)
+
 /*
  * The base mpool priority is 1/4th of the name space, or just under 2^30.
  * When the LRU counter wraps, we shift everybody down to a base-relative
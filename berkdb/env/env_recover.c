@@ -51,6 +51,7 @@ static const char revid[] =
 #include <printformats.h>
 
 #include "dbinc/btree.h"
+#include "dbinc/hash.h"
 #include "dbinc/lock.h"
 
 #include "list.h"
@@ -939,6 +940,322 @@ void log_recovery_progress(int stage, int progress)
 
 
 
+/*
+ * Parallel redo for the forward pass of recovery.
+ *
+ * This follows the replicant's concurrent apply (processor_thd/worker_thd
+ * in rep_record.c): records are bucketed by the file they touch, and each
+ * bucket is applied in log order by a worker thread.  Records for different
+ * files don't depend on each other during redo, so the buckets can run in
+ * parallel.  The reading thread decides which records need redo (that reads
+ * and reorders the transaction list) and applies everything that isn't a
+ * page record itself, after waiting for the workers to go idle.  Transaction
+ * commits only update the transaction list, so they don't have to wait.
+ */
+struct __redo_record {
+	DBT logdbt;
+	DB_LSN lsn;
+	u_int32_t rectype;	/* dispatch table index */
+	db_recops op;
+	LINKC_T(struct __redo_record) lnk;
+};
+
+struct __redo_queue {
+	struct __redo *redo;
+	LISTC_T(struct __redo_record) records;
+};
+
+struct __redo {
+	DB_ENV *dbenv;
+	void *txninfo;
+	pthread_mutex_t lk;
+	pthread_cond_t wait;
+	pthread_mutex_t info_lk;	/* every use of txninfo */
+	int num_busy_workers;
+	int nqueues;
+	int nrecs;
+	int maxrecs;
+	int ret;
+	DB_LSN err_lsn;
+	u_int64_t applied;
+	u_int64_t batches;
+	struct __redo_queue *queues;
+};
+
+static pthread_once_t redo_pool_once = PTHREAD_ONCE_INIT;
+static struct thdpool *redo_pool;
+
+static void
+__db_redo_pool_init(void)
+{
+	redo_pool = thdpool_create("recovery_redo", 0);
+	if (redo_pool == NULL)
+		return;
+	thdpool_set_linger(redo_pool, 10);
+	thdpool_set_maxqueue(redo_pool, 8000);
+}
+
+static inline int
+__db_redo_uses_info(u_int32_t rectype)
+{
+	switch (rectype) {
+	case DB___db_pg_alloc:
+	case DB___db_pg_new:
+	case DB___db_pg_prepare:
+	case DB___db_cksum:
+	case DB___ham_groupalloc:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static void
+__db_redo_worker(struct thdpool *pool, void *work, void *thddata, int thd_op)
+{
+	struct __redo_queue *rq;
+	struct __redo_record *rr;
+	struct __redo *redo;
+	DB_ENV *dbenv;
+	DB_LSN err_lsn;
+	int locked, ret;
+
+	rq = (struct __redo_queue *)work;
+	redo = rq->redo;
+	dbenv = redo->dbenv;
+	ret = 0;
+	ZERO_LSN(err_lsn);
+
+	while ((rr = listc_rtl(&rq->records)) != NULL) {
+		if (ret == 0) {
+			if ((locked = __db_redo_uses_info(rr->rectype)) != 0)
+				Pthread_mutex_lock(&redo->info_lk);
+			ret = dbenv->recover_dtab[rr->rectype](dbenv,
+			    &rr->logdbt, &rr->lsn, rr->op, redo->txninfo);
+			if (locked)
+				Pthread_mutex_unlock(&redo->info_lk);
+			if (ret != 0)
+				err_lsn = rr->lsn;
+		}
+		__os_free(dbenv, rr);
+	}
+
+	Pthread_mutex_lock(&redo->lk);
+	if (ret != 0 && (redo->ret == 0 ||
+	    log_compare(&err_lsn, &redo->err_lsn) < 0)) {
+		redo->ret = ret;
+		redo->err_lsn = err_lsn;
+	}
+	redo->num_busy_workers--;
+	if (pool)
+		Pthread_cond_signal(&redo->wait);
+	Pthread_mutex_unlock(&redo->lk);
+}
+
+/*
+ * __db_redo_flush --
+ *	Apply everything queued so far and wait for it.  On failure, *lsnp is
+ *	set to the record that failed.
+ */
+static int
+__db_redo_flush(redo, lsnp)
+	struct __redo *redo;
+	DB_LSN *lsnp;
+{
+	struct __redo_queue *rq;
+	int i, nbusy;
+
+	if (redo->nrecs == 0)
+		return (0);
+
+	for (i = nbusy = 0; i < redo->nqueues; i++)
+		if (listc_size(&redo->queues[i].records) > 0)
+			nbusy++;
+
+	Pthread_mutex_lock(&redo->lk);
+	redo->num_busy_workers = nbusy;
+	Pthread_mutex_unlock(&redo->lk);
+
+	for (i = 0; i < redo->nqueues; i++) {
+		rq = &redo->queues[i];
+		if (listc_size(&rq->records) == 0)
+			continue;
+		/* Not worth a handoff if this is the only busy file. */
+		if (nbusy == 1 || thdpool_enqueue(redo_pool,
+		    __db_redo_worker, rq, 0, NULL, 0) != 0)
+			__db_redo_worker(NULL, rq, NULL, THD_RUN);
+	}
+
+	Pthread_mutex_lock(&redo->lk);
+	while (redo->num_busy_workers > 0)
+		Pthread_cond_wait(&redo->wait, &redo->lk);
+	Pthread_mutex_unlock(&redo->lk);
+
+	redo->applied += redo->nrecs;
+	redo->batches++;
+	redo->nrecs = 0;
+	if (redo->ret != 0)
+		*lsnp = redo->err_lsn;
+	return (redo->ret);
+}
+
+/*
+ * __db_redo_dispatch --
+ *	Forward pass replacement for __db_dispatch.
+ */
+static int
+__db_redo_dispatch(redo, dbt, lsnp)
+	struct __redo *redo;
+	DBT *dbt;
+	DB_LSN *lsnp;
+{
+	struct __redo_record *rr;
+	struct __redo_queue *rq;
+	DB_ENV *dbenv;
+	db_recops op;
+	u_int32_t hash, rectype, txnid;
+	u_int8_t fuid[DB_FILE_ID_LEN];
+	int i, ret, utxnid_logged;
+
+	dbenv = redo->dbenv;
+	LOGCOPY_32(&rectype, dbt->data);
+	LOGCOPY_32(&txnid, (u_int8_t *)dbt->data + sizeof(rectype));
+	utxnid_logged = normalize_rectype(&rectype);
+
+	/*
+	 * Only records that carry their file's uid go to a worker.  Older
+	 * records would need a dbreg lookup, which isn't safe to do before
+	 * the file is known to be open.
+	 */
+	if (rectype > 1000 && rectype < 2000 && ufid_for_recovery_record(dbenv,
+	    NULL, rectype, fuid, dbt, utxnid_logged)) {
+		Pthread_mutex_lock(&redo->info_lk);
+		i = __db_forward_op(dbenv, rectype, txnid, redo->txninfo, &op);
+		Pthread_mutex_unlock(&redo->info_lk);
+		if (!i)
+			return (0);
+		if (rectype - 1000 >= dbenv->recover_dtab_size ||
+		    dbenv->recover_dtab[rectype - 1000] == NULL) {
+			__db_err(dbenv, "Illegal record type %lu in log",
+			    (u_long)rectype);
+			return (EINVAL);
+		}
+		if ((ret = __os_malloc(dbenv,
+		    sizeof(*rr) + dbt->size, &rr)) != 0)
+			return (ret);
+		memset(&rr->logdbt, 0, sizeof(rr->logdbt));
+		rr->logdbt.data = rr + 1;
+		rr->logdbt.size = dbt->size;
+		memcpy(rr->logdbt.data, dbt->data, dbt->size);
+		rr->lsn = *lsnp;
+		rr->rectype = rectype - 1000;
+		rr->op = op;
+
+		for (i = 0, hash = 2166136261u; i < DB_FILE_ID_LEN; i++)
+			hash = (hash ^ fuid[i]) * 16777619u;
+		rq = &redo->queues[hash % redo->nqueues];
+		listc_abl(&rq->records, rr);
+
+		if (++redo->nrecs >= redo->maxrecs)
+			return (__db_redo_flush(redo, lsnp));
+		return (0);
+	}
+
+	if (rectype != DB___txn_regop && rectype != DB___txn_regop_gen &&
+	    (ret = __db_redo_flush(redo, lsnp)) != 0)
+		return (ret);
+
+	/* Commits are applied without draining the workers. */
+	Pthread_mutex_lock(&redo->info_lk);
+	ret = __db_dispatch(dbenv, dbenv->recover_dtab,
+	    dbenv->recover_dtab_size, dbt, lsnp, DB_TXN_FORWARD_ROLL,
+	    redo->txninfo);
+	Pthread_mutex_unlock(&redo->info_lk);
+	return (ret);
+}
+
+static int
+__db_redo_threads(dbenv)
+	DB_ENV *dbenv;
+{
+	int nthreads;
+
+	if ((nthreads = dbenv->attr.recovery_redo_threads) < 1)
+		nthreads = 1;
+	return (nthreads > 64 ? 64 : nthreads);
+}
+
+/*
+ * The pool is set up for every recovery, used or not, so that its tunables
+ * are always registered.
+ */
+static void
+__db_redo_pool_setup(dbenv)
+	DB_ENV *dbenv;
+{
+	pthread_once(&redo_pool_once, __db_redo_pool_init);
+	if (redo_pool != NULL)
+		thdpool_set_maxthds(redo_pool, __db_redo_threads(dbenv));
+}
+
+static int
+__db_redo_create(dbenv, txninfo, redop)
+	DB_ENV *dbenv;
+	void *txninfo;
+	struct __redo **redop;
+{
+	struct __redo *redo;
+	int i, nthreads, ret;
+
+	*redop = NULL;
+	if ((nthreads = __db_redo_threads(dbenv)) <= 1 || redo_pool == NULL)
+		return (0);
+
+	if ((ret = __os_calloc(dbenv, 1, sizeof(*redo), &redo)) != 0)
+		return (ret);
+	redo->nqueues = nthreads * 4;
+	if ((ret = __os_calloc(dbenv, redo->nqueues,
+	    sizeof(struct __redo_queue), &redo->queues)) != 0) {
+		__os_free(dbenv, redo);
+		return (ret);
+	}
+	for (i = 0; i < redo->nqueues; i++) {
+		redo->queues[i].redo = redo;
+		listc_init(&redo->queues[i].records,
+		    offsetof(struct __redo_record, lnk));
+	}
+	redo->dbenv = dbenv;
+	redo->txninfo = txninfo;
+	redo->maxrecs = dbenv->attr.recovery_redo_batch;
+	if (redo->maxrecs <= 0)
+		redo->maxrecs = 1;
+	Pthread_mutex_init(&redo->lk, NULL);
+	Pthread_cond_init(&redo->wait, NULL);
+	Pthread_mutex_init(&redo->info_lk, NULL);
+
+	logmsg(LOGMSG_WARN, "forward pass using %d redo threads\n", nthreads);
+	*redop = redo;
+	return (0);
+}
+
+/* Frees anything still queued; only left over after an error. */
+static void
+__db_redo_destroy(redo)
+	struct __redo *redo;
+{
+	struct __redo_record *rr;
+	int i;
+
+	for (i = 0; i < redo->nqueues; i++)
+		while ((rr = listc_rtl(&redo->queues[i].records)) != NULL)
+			__os_free(redo->dbenv, rr);
+	Pthread_mutex_destroy(&redo->lk);
+	Pthread_cond_destroy(&redo->wait);
+	Pthread_mutex_destroy(&redo->info_lk);
+	__os_free(redo->dbenv, redo->queues);
+	__os_free(redo->dbenv, redo);
+}
+
 /*
  * __db_apprec --
  *	Perform recovery.  If max_lsn is non-NULL, then we are trying
@@ -972,12 +1289,14 @@ __db_apprec(dbenv, max_lsn, trunclsn, update, flags)
 	void *txninfo;
 	DB_LSN logged_checkpoint_lsn;
 	int start_recovery_at_dbregs;
+	struct __redo *redo;
 
 	COMPQUIET(nfiles, (double)0);
 
 	logc = NULL;
 	ckp_args = NULL;
 	dtab = NULL;
+	redo = NULL;
 
 	hi_txn = TXN_MAXIMUM;
 	txninfo = NULL;
@@ -987,6 +1306,8 @@ __db_apprec(dbenv, max_lsn, trunclsn, update, flags)
 
 	pass = "initial";
 
+	__db_redo_pool_setup(dbenv);
+
 	/*
 	 * XXX
 	 * Get the log size.  No locking required because we're single-threaded
@@ -1445,6 +1766,8 @@ __db_apprec(dbenv, max_lsn, trunclsn, update, flags)
 
 	logmsg(LOGMSG_WARN, "running forward pass from %u:%u -> %u:%u\n",
 		lsn.file, lsn.offset, stop_lsn.file, stop_lsn.offset);
+	if ((ret = __db_redo_create(dbenv, txninfo, &redo)) != 0)
+		goto err;
 	for (ret = __log_c_get(logc, &lsn, &data, DB_NEXT);
 		ret == 0; ret = __log_c_get(logc, &lsn, &data, DB_NEXT)) {
 		/*
@@ -1468,9 +1791,12 @@ __db_apprec(dbenv, max_lsn, trunclsn, update, flags)
 			dbenv->db_feedback(dbenv, DB_RECOVER, progress);
 		}
 
-		ret = __db_dispatch(dbenv, dbenv->recover_dtab,
-			dbenv->recover_dtab_size, &data, &lsn,
-			DB_TXN_FORWARD_ROLL, txninfo);
+		if (redo != NULL)
+			ret = __db_redo_dispatch(redo, &data, &lsn);
+		else
+			ret = __db_dispatch(dbenv, dbenv->recover_dtab,
+				dbenv->recover_dtab_size, &data, &lsn,
+				DB_TXN_FORWARD_ROLL, txninfo);
 		if (ret != 0) {
 			if (ret != DB_TXN_CKP)
 				goto msgerr;
@@ -1482,6 +1808,14 @@ __db_apprec(dbenv, max_lsn, trunclsn, update, flags)
 
 	if (ret != 0 && ret != DB_NOTFOUND)
 		goto err;
+	if (redo != NULL) {
+		if ((ret = __db_redo_flush(redo, &lsn)) != 0)
+			goto msgerr;
+		logmsg(LOGMSG_WARN, "forward pass redid %"PRIu64" page records "
+			"in %"PRIu64" batches\n", redo->applied, redo->batches);
+		__db_redo_destroy(redo);
+		redo = NULL;
+	}
 	dbenv->recovery_pass = DB_TXN_NOT_IN_RECOVERY;
 
 	/*
@@ -1689,6 +2023,9 @@ msgerr:	__db_err(dbenv,
 err:	if (logc != NULL && (t_ret = __log_c_close(logc)) != 0 && ret == 0)
 		ret = t_ret;
 
+	if (redo != NULL)
+		__db_redo_destroy(redo);
+
 	if (txninfo != NULL)
 		__db_txnlist_end(dbenv, txninfo);
 
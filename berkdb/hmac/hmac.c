@@ -92,6 +92,90 @@ __db_chksum_no_crypto(data, data_len, store)
 	__db_chksum_int(data, data_len, NULL, store);
 }
 
+/*
+ * Writers that hold several pages at once can collect the crc32c page
+ * checksums on this thread and compute them together with crc32c_multi,
+ * which checksums independent buffers side by side.
+ */
+#define	DB_CHKSUM_BATCH	64
+static __thread struct {
+	int active;
+	int n;
+	const uint8_t *bufs[DB_CHKSUM_BATCH];
+	uint32_t lens[DB_CHKSUM_BATCH];
+	u_int8_t *stores[DB_CHKSUM_BATCH];
+} chksum_batch;
+
+static void
+__db_chksum_batch_flush()
+{
+	uint32_t hash[DB_CHKSUM_BATCH];
+	int i;
+
+	if (chksum_batch.n == 0)
+		return;
+	crc32c_multi(chksum_batch.bufs, chksum_batch.lens, hash,
+	    chksum_batch.n);
+	for (i = 0; i < chksum_batch.n; i++)
+		memcpy(chksum_batch.stores[i], &hash[i], sizeof(uint32_t));
+	chksum_batch.n = 0;
+}
+
+/*
+ * __db_chksum_batch_begin --
+ *	Start deferring __db_chksum_defer calls on this thread.
+ *
+ * PUBLIC: void __db_chksum_batch_begin __P((void));
+ */
+void
+__db_chksum_batch_begin()
+{
+	chksum_batch.active = 1;
+	chksum_batch.n = 0;
+}
+
+/*
+ * __db_chksum_batch_end --
+ *	Compute and store every checksum deferred since
+ *	__db_chksum_batch_begin.  The buffers must not have changed since.
+ *
+ * PUBLIC: void __db_chksum_batch_end __P((void));
+ */
+void
+__db_chksum_batch_end()
+{
+	__db_chksum_batch_flush();
+	chksum_batch.active = 0;
+}
+
+/*
+ * __db_chksum_defer --
+ *	Like __db_chksum, but queue the crc32c computation if a batch is
+ *	open on this thread.  The store is zeroed right away either way.
+ *
+ * PUBLIC: void __db_chksum_defer __P((u_int8_t *, size_t, u_int8_t *,
+ * PUBLIC:     u_int8_t *));
+ */
+void
+__db_chksum_defer(data, data_len, mac_key, store)
+	u_int8_t *data;
+	size_t data_len;
+	u_int8_t *mac_key;
+	u_int8_t *store;
+{
+	if (!chksum_batch.active || !gbl_crc32c || data_len > UINT32_MAX) {
+		__db_chksum_int(data, data_len, mac_key, store);
+		return;
+	}
+	if (chksum_batch.n == DB_CHKSUM_BATCH)
+		__db_chksum_batch_flush();
+	memset(store, 0, sizeof(uint32_t));
+	chksum_batch.bufs[chksum_batch.n] = data;
+	chksum_batch.lens[chksum_batch.n] = (uint32_t)data_len;
+	chksum_batch.stores[chksum_batch.n] = store;
+	chksum_batch.n++;
+}
+
 /*
  * __db_derive_mac --
  *	Create a MAC/SHA1 key.
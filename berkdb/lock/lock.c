@@ -2381,6 +2381,35 @@ __lock_get_internal_int(lt, locker, in_locker, flags, obj, lock_mode, timeout,
 	wwrite = NULL;
 	waitdie = 0;
 
+	/*
+	 * Uncontended read lock: nobody holds the object in a conflicting
+	 * mode and nobody waits for it, so the walk of the holders list
+	 * below could only end in GRANT, and only its conflict checks are
+	 * skipped: a read lock this locker already holds on the object is
+	 * still found among the holders and reused, as the walk does.
+	 */
+	if (lock_mode == DB_LOCK_READ && obj != NULL && sh_obj->nexcl == 0 &&
+	    !LF_ISSET(DB_LOCK_UPGRADE | DB_LOCK_SWITCH | DB_LOCK_LOGICAL) &&
+	    sh_locker->timestamp == 0 &&
+	    SH_TAILQ_FIRST(&sh_obj->waiters, __db_lock) == NULL &&
+	    dbenv->attr.lock_read_fastpath) {
+		region->stat.st_nfastpath++;
+		for (lp = SH_TAILQ_FIRST(&sh_obj->holders, __db_lock);
+		    lp != NULL; lp = SH_TAILQ_NEXT(lp, links, __db_lock)) {
+			if (locker == lp->holderp->id &&
+			    lp->mode == DB_LOCK_READ &&
+			    lp->status == DB_LSTAT_HELD) {
+				lp->refcount++;
+				lock->off = R_OFFSET(&lt->reginfo, lp);
+				lock->gen = lp->gen;
+				lock->mode = lp->mode;
+				goto done;
+			}
+		}
+		action = GRANT;
+		goto grant;
+	}
+
 	/* Distributed txns can only block on younger timestamps */
 	if (sh_locker->timestamp > 0) {
 		lp = SH_TAILQ_FIRST(&sh_obj->holders, __db_lock);
@@ -2626,6 +2655,7 @@ __lock_get_internal_int(lt, locker, in_locker, flags, obj, lock_mode, timeout,
 		}
 	}
 
+grant:
 	switch (action) {
 	case HEAD:
 	case TAIL:
@@ -2717,7 +2747,9 @@ upgrade:
 			    lock->off);
 		if (IS_WRITELOCK(lock_mode) && !IS_WRITELOCK(lp->mode))
 			sh_locker->nwrites++;
+		OBJ_HOLDER_DEL(lt, region, sh_obj, lp->mode);
 		lp->mode = lock_mode;
+		OBJ_HOLDER_ADD(lt, region, sh_obj, lp->mode);
 		if (is_pagelock(sh_obj) &&
 		    IS_WRITELOCK(lock_mode) &&
 		    F_ISSET(sh_locker, DB_LOCKER_TRACK_WRITELOCKS) &&
@@ -2753,6 +2785,7 @@ upgrade:
 	case GRANT:
 		newl->status = DB_LSTAT_HELD;
 		SH_TAILQ_INSERT_TAIL(&sh_obj->holders, newl, links);
+		OBJ_HOLDER_ADD(lt, region, sh_obj, newl->mode);
 		if (gbl_bb_berkdb_enable_thread_stats) {
 			struct berkdb_thread_stats *t;
 			struct berkdb_thread_stats *p;
@@ -2933,10 +2966,22 @@ upgrade:
 
 		/*
 		 * We are about to wait; before waiting, see if the deadlock
-		 * detector should be run.
+		 * detector should be run.  Unless wait-die or lock timeouts
+		 * are in play, it only needs to run if our wait can close a
+		 * cycle.
 		 */
-		if (region->detect != DB_LOCK_NORUN && !no_dd)
-			__lock_detect(dbenv, region->detect, NULL);
+		if (region->detect != DB_LOCK_NORUN && !no_dd) {
+			DB_LOCKER *master = sh_locker;
+
+			if (master->master_locker != INVALID_ROFF)
+				master = R_ADDR(&lt->reginfo,
+				    master->master_locker);
+			if (!dbenv->attr.lock_detect_incremental ||
+			    master->timestamp > 0 ||
+			    LOCK_TIME_ISVALID(&region->next_timeout) ||
+			    __dd_closes_cycle(dbenv, sh_obj, master->id))
+				__lock_detect(dbenv, region->detect, NULL);
+		}
 
 		if (gbl_bb_berkdb_enable_lock_timing) {
 			x1 = bb_berkdb_fasttime();
@@ -3034,6 +3079,7 @@ expired:			obj_ndx = sh_obj->index;
 			 */
 			SH_TAILQ_REMOVE(&sh_obj->holders, newl, links,
 			    __db_lock);
+			OBJ_HOLDER_DEL(lt, region, sh_obj, newl->mode);
 			goto upgrade;
 		} else
 			newl->status = DB_LSTAT_HELD;
@@ -3534,6 +3580,7 @@ __lock_downgrade(dbenv, lock, new_mode, flags)
 	DB_LOCKOBJ *obj;
 	DB_LOCKREGION *region;
 	DB_LOCKTAB *lt;
+	db_lockmode_t old_mode;
 	u_int32_t partition;
 	int ret;
 	int state_changed;
@@ -3570,6 +3617,7 @@ __lock_downgrade(dbenv, lock, new_mode, flags)
 	if (new_mode == DB_LOCK_WWRITE)
 		F_SET(sh_locker, DB_LOCKER_DIRTY);
 
+	old_mode = lockp->mode;
 	lockp->mode = new_mode;
 	lock->mode = new_mode;
 
@@ -3581,6 +3629,8 @@ __lock_downgrade(dbenv, lock, new_mode, flags)
 	assert(partition == obj->partition);
 
 	lock_obj_partition(region, partition);
+	OBJ_HOLDER_DEL(lt, region, obj, old_mode);
+	OBJ_HOLDER_ADD(lt, region, obj, new_mode);
 	__lock_promote(lt, obj, &state_changed, LF_ISSET(DB_LOCK_NOWAITERS));
 	unlock_obj_partition(region, partition);
 
@@ -3685,8 +3735,10 @@ __lock_put_internal(lt, lockp, lock, obj_ndx, need_dd, flags)
 	/* Remove this lock from its holders/waitlist. */
 	if (lockp->status != DB_LSTAT_HELD && lockp->status != DB_LSTAT_PENDING)
 		__lock_remove_waiter(lt, sh_obj, lockp, DB_LSTAT_FREE);
-	else
+	else {
 		SH_TAILQ_REMOVE(&sh_obj->holders, lockp, links, __db_lock);
+		OBJ_HOLDER_DEL(lt, region, sh_obj, lockp->mode);
+	}
 
 	if (LF_ISSET(DB_LOCK_NOPROMOTE))
 		state_changed = 0;
@@ -4547,6 +4599,7 @@ __lock_getobj(lt, obj, ndx, partition, create, retp)
 
 		SH_TAILQ_INIT(&sh_obj->waiters);
 		SH_TAILQ_INIT(&sh_obj->holders);
+		sh_obj->nexcl = 0;
 		sh_obj->lockobj.size = obj->size;
 		sh_obj->lockobj.data = p;
 		sh_obj->partition = partition;
@@ -4728,6 +4781,7 @@ __lock_inherit_locks(lt, locker, flags)
 			/* Remove lock from object list and free it. */
 			DB_ASSERT(lp->status == DB_LSTAT_HELD);
 			SH_TAILQ_REMOVE(&obj->holders, lp, links, __db_lock);
+			OBJ_HOLDER_DEL(lt, region, obj, lp->mode);
 			(void)__lock_freelock(lt, lp, sh_locker, DB_LOCK_FREE);
 		} else {
 			/* Just move lock to parent chains. */
@@ -4836,6 +4890,7 @@ __lock_promote(lt, obj, changed, flags)
 		SH_TAILQ_REMOVE(&obj->waiters, lp_w, links, __db_lock);
 		lp_w->status = DB_LSTAT_PENDING;
 		SH_TAILQ_INSERT_TAIL(&obj->holders, lp_w, links);
+		OBJ_HOLDER_ADD(lt, region, obj, lp_w->mode);
 
 		/* Wake up waiter. */
 		MUTEX_UNLOCK(lt->dbenv, &lp_w->mutex);
@@ -32,9 +32,24 @@ static const char revid[] = "$Id: lock_deadlock.c,v 11.66 2003/11/19 19:59:02 ub
 
 #include "debug_switches.h"
 #include "logmsg.h"
+#include <epochlib.h>
+#include <comdb2_atomic.h>
 #include "sys_wrap.h"
 
 extern int verbose_deadlocks;
+
+/*
+ * The detector stats are bumped by lockers walking waits-for edges without
+ * any common lock, so they are all updated atomically.
+ */
+static inline void
+__dd_stat_max(u_int64_t *statp, u_int64_t v)
+{
+	u_int64_t cur;
+
+	while ((cur = ATOMIC_LOAD64(*statp)) < v && !CAS64(*statp, cur, v))
+		;
+}
 extern int gbl_sparse_lockerid_map;
 extern int gbl_rowlocks;
 extern int gbl_print_deadlock_cycles;
@@ -506,13 +521,22 @@ __lock_detect(dbenv, atype, abortp)
 
 	Pthread_mutex_lock(&dlock);
 	{
+		DB_LOCKREGION *region;
+		u_int64_t start, us;
+
 		Pthread_mutex_lock(&qlock);
 		q = 0;
 		Pthread_mutex_unlock(&qlock);
+		start = comdb2_time_epochus();
 		int retry = 0;
 		ret = __lock_detect_int(dbenv, atype, abortp, &retry);
 		if (retry)
 			ret = __lock_detect_int(dbenv, atype, abortp, NULL);
+
+		us = comdb2_time_epochus() - start;
+		region = ((DB_LOCKTAB *)dbenv->lk_handle)->reginfo.primary;
+		ATOMIC_ADD64(region->stat.st_detect_usecs, us);
+		__dd_stat_max(&region->stat.st_detect_max_usecs, us);
 	}
 	Pthread_mutex_unlock(&dlock);
 	return ret;
@@ -546,6 +570,8 @@ __lock_detect_int(dbenv, atype, abortp, can_retry)
 
 	++detect_run;
 	is_client = __rep_is_client(dbenv);
+	ATOMIC_ADD64(((DB_LOCKREGION *)((DB_LOCKTAB *)dbenv->lk_handle)->
+	    reginfo.primary)->stat.st_ndetects, 1);
 
 	if (!is_client) {
 		/* master */
@@ -633,6 +659,7 @@ __lock_detect_int(dbenv, atype, abortp, can_retry)
 
 	if (nlockers == 0)
 		return (0);
+	__dd_stat_max(&region->stat.st_detect_max_lockers, nlockers);
 
 	/* Find & abort waitdie dependencies then rebuild map */
 	if (tscnt > 0 && !gbl_debug_disable_waitdie_deadlock_detection) {
@@ -945,6 +972,164 @@ err:
 	return (ret);
 }
 
+/*
+ * The waits-for walk run by a locker about to block.  Edges are the same as
+ * __dd_build's: a waiting locker waits for every holder of the object it is
+ * waiting on, with child lockers folded into their master.
+ */
+#define	DD_WALK_MAX	64
+
+struct dd_walk_obj {
+	DB_LOCKOBJ *obj;
+	u_int32_t partition;
+	u_int32_t generation;
+};
+
+/*
+ * __dd_waiting_on --
+ *	Find the object that locker id (a master) is waiting on.  Returns 0
+ *	and fills in *wp if it is waiting, DB_NOTFOUND if it is not, and
+ *	DB_LOCK_DEADLOCK if we can't tell.
+ */
+static int
+__dd_waiting_on(lt, id, wp)
+	DB_LOCKTAB *lt;
+	u_int32_t id;
+	struct dd_walk_obj *wp;
+{
+	DB_LOCKREGION *region;
+	DB_LOCKER *lockerp, *lip;
+	struct __db_lock *lp;
+	u_int32_t ndx, part;
+	int ret;
+
+	region = lt->reginfo.primary;
+	LOCKER_INDX(lt, region, id, ndx);
+	if (__lock_getlocker(lt, id, ndx, GETLOCKER_KEEP_PART, &lockerp) != 0)
+		return (DB_LOCK_DEADLOCK);
+	if (lockerp == NULL)
+		return (DB_NOTFOUND);
+	if (!lockerp->wstatus) {
+		unlock_locker_partition(region, lockerp->partition);
+		return (DB_NOTFOUND);
+	}
+
+	/*
+	 * The waiting lock is the most recent one, so it is at the head of
+	 * the heldby list of the master or of one of its children.
+	 */
+	ret = DB_LOCK_DEADLOCK;
+	lip = lockerp;
+	do {
+		lp = SH_LIST_FIRST(&lip->heldby, __db_lock);
+		if (lp != NULL && (part = lp->lpartition) < gbl_lk_parts) {
+			lock_obj_partition(region, part);
+			if (lp == SH_LIST_FIRST(&lip->heldby, __db_lock) &&
+			    part == lp->lpartition &&
+			    lp->status == DB_LSTAT_WAITING) {
+				wp->obj = lp->lockobj;
+				wp->partition = part;
+				wp->generation = wp->obj->generation;
+				ret = 0;
+			}
+			unlock_obj_partition(region, part);
+		}
+		lip = lip == lockerp ?
+		    SH_LIST_FIRST(&lockerp->child_locker, __db_locker) :
+		    SH_LIST_NEXT(lip, child_link, __db_locker);
+	} while (ret != 0 && lip != NULL);
+
+	unlock_locker_partition(region, lockerp->partition);
+	return (ret);
+}
+
+/*
+ * __dd_closes_cycle --
+ *	Called by locker id (a master) after queueing on sh_obj and before
+ *	blocking.  Every new waits-for cycle is closed by some locker
+ *	blocking, and that locker publishes its own wait before walking, so
+ *	if id cannot reach itself from sh_obj this block created no deadlock
+ *	and the full detector need not run.  Returns 1 if it found a path
+ *	back to id or gave up (raced with a lock being released, or more
+ *	than DD_WALK_MAX lockers), 0 if there is no cycle through id.
+ *
+ * PUBLIC: int __dd_closes_cycle __P((DB_ENV *, DB_LOCKOBJ *, u_int32_t));
+ */
+int
+__dd_closes_cycle(dbenv, sh_obj, id)
+	DB_ENV *dbenv;
+	DB_LOCKOBJ *sh_obj;
+	u_int32_t id;
+{
+	DB_LOCKER *lockerp;
+	DB_LOCKREGION *region;
+	DB_LOCKTAB *lt;
+	struct __db_lock *lp;
+	struct dd_walk_obj stack[DD_WALK_MAX], w;
+	u_int32_t holders[DD_WALK_MAX], seen[DD_WALK_MAX];
+	int i, j, nholders, nseen, nstack, ret;
+
+	lt = dbenv->lk_handle;
+	region = lt->reginfo.primary;
+	ATOMIC_ADD64(region->stat.st_ndetect_walks, 1);
+
+	/* Our waiting lock keeps sh_obj from going away. */
+	stack[0].obj = sh_obj;
+	stack[0].partition = sh_obj->partition;
+	lock_obj_partition(region, stack[0].partition);
+	stack[0].generation = sh_obj->generation;
+	unlock_obj_partition(region, stack[0].partition);
+	nstack = 1;
+	nseen = 0;
+
+	while (nstack > 0) {
+		w = stack[--nstack];
+		lock_obj_partition(region, w.partition);
+		if (w.obj->partition != w.partition ||
+		    w.obj->generation != w.generation) {
+			unlock_obj_partition(region, w.partition);
+			return (1);
+		}
+		nholders = 0;
+		for (lp = SH_TAILQ_FIRST(&w.obj->holders, __db_lock);
+		    lp != NULL; lp = SH_TAILQ_NEXT(lp, links, __db_lock)) {
+			if (lp->status != DB_LSTAT_HELD)
+				continue;
+			lockerp = lp->holderp;
+			if (lockerp->master_locker != INVALID_ROFF)
+				lockerp = R_ADDR(&lt->reginfo,
+				    lockerp->master_locker);
+			if (lockerp->id == id || nholders == DD_WALK_MAX) {
+				unlock_obj_partition(region, w.partition);
+				return (1);
+			}
+			if (lockerp->wstatus)
+				holders[nholders++] = lockerp->id;
+		}
+		unlock_obj_partition(region, w.partition);
+
+		for (i = 0; i < nholders; i++) {
+			for (j = 0; j < nseen && seen[j] != holders[i]; j++)
+				;
+			if (j < nseen)
+				continue;
+			if (nseen == DD_WALK_MAX)
+				return (1);
+			seen[nseen++] = holders[i];
+
+			if ((ret = __dd_waiting_on(lt, holders[i], &w)) ==
+			    DB_NOTFOUND)
+				continue;
+			if (ret != 0 || nstack == DD_WALK_MAX)
+				return (1);
+			stack[nstack++] = w;
+		}
+	}
+
+	ATOMIC_ADD64(region->stat.st_ndetect_skipped, 1);
+	return (0);
+}
+
 /*
  * ========================================================================
  * Utilities
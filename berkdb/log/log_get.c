@@ -1102,6 +1102,9 @@ __log_c_inregion_int(logc, lsn, rlockp, last_lsn, hdr, pp)
 		return (0);
 
 	if (lp->num_segments > 1) {
+		/* Records may still be being copied into the buffer. */
+		__log_wait_copies(dblp);
+
 		/* Need this to find the oldest in-memory lsn. */
 		seg_lsn_array = R_ADDR(&dblp->reginfo, lp->segment_lsns_off);
 
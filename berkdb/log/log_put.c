@@ -46,6 +46,8 @@ static const char revid[] = "$Id: log_put.c,v 11.145 2003/09/13 19:20:39 bostic
 #include "logmsg.h"
 #include <sys_wrap.h>
 #include <poll.h>
+#include <sched.h>
+#include <comdb2_atomic.h>
 
 extern unsigned long long get_commit_context(const void *, uint32_t generation);
 extern int bdb_update_startlwm_berk(void *statearg, unsigned long long ltranid,
@@ -55,17 +57,40 @@ extern int bdb_push_pglogs_commit(void *in_bdb_state, DB_LSN commit_lsn,
 	uint32_t generation, unsigned long long ltranid, int push);
 
 
+/*
+ * A log record whose space has been reserved in the segmented log buffer
+ * under the region lock, but which is copied in only after the lock has been
+ * dropped.  Each piece is a contiguous run within a single segment; a record
+ * is only deferred if it fits in one segment, so it spans at most two
+ * segments and at most three pieces (header and data each split at most
+ * once, and not both).
+ */
+#define LOG_COPY_MAXPIECES 4
+struct __log_copy {
+	int npieces;
+	struct {
+		u_int8_t *dst;
+		const void *src;
+		u_int32_t len;
+		u_int32_t seg;
+	} piece[LOG_COPY_MAXPIECES];
+};
+
 static int __log_encrypt_record __P((DB_ENV *, DBT *, HDR *, u_int32_t));
 static int __log_file __P((DB_ENV *, const DB_LSN *, char *, size_t));
 static int __log_fill __P((DB_LOG *, DB_LSN *, void *, u_int32_t));
 static int __log_fill_segments __P((DB_LOG *, DB_LSN *, DB_LSN *, void *,
-	u_int32_t));
+	u_int32_t, struct __log_copy *));
 static int __log_flush_commit __P((DB_ENV *, const DB_LSN *, u_int32_t));
 static int __log_newfh __P((DB_LOG *));
 static int __log_put_next __P((DB_ENV *,
 	DB_LSN *, u_int64_t *, DBT *, const DBT *, HDR *, DB_LSN *, int,
-	u_int8_t *key, u_int32_t));
-static int __log_putr __P((DB_LOG *, DB_LSN *, const DBT *, u_int32_t, HDR *));
+	u_int8_t *key, u_int32_t, struct __log_copy *));
+static int __log_putr __P((DB_LOG *, DB_LSN *, const DBT *, u_int32_t, HDR *,
+	struct __log_copy *));
+static void __log_copy_finish __P((DB_LOG *, struct __log_copy *));
+static void __log_write_segments_init __P((void));
+static void __log_wait_seg_copies __P((DB_LOG *, u_int32_t));
 static int __log_write __P((DB_LOG *, void *, u_int32_t));
 static void __log_sync_range __P((DB_LOG *, off_t));
 
@@ -76,6 +101,12 @@ static pthread_t log_write_td = 0;
 static int log_write_td_should_stop = 0;
 static DB_LOG *log_write_dblp = NULL;
 
+/*
+ * Per segment count of reserved-but-not-yet-copied pieces.  A segment can't
+ * be written to disk (or read by a log cursor) until its count drops to 0.
+ */
+static int *log_seg_copies = NULL;
+
 int __db_debug_log(DB_ENV *, DB_TXN *, DB_LSN *, u_int32_t, const DBT *,
     int32_t, const DBT *, const DBT *, u_int32_t);
 
@@ -178,6 +209,7 @@ __log_put_int_int(dbenv, lsnp, contextp, udbt, flags, off_context, usr_ptr)
 	u_int8_t *key = NULL;
 	u_int32_t rectype = 0;
 	int delay;
+	struct __log_copy copy, *copyp;
 
 	dblp = dbenv->lg_handle;
 	lp = dblp->reginfo.primary;
@@ -191,6 +223,17 @@ __log_put_int_int(dbenv, lsnp, contextp, udbt, flags, off_context, usr_ptr)
 	lock_held = need_free = 0;
 	flags &= (~(DB_LOG_DONT_LOCK | DB_LOG_DONT_INFLATE));
 
+	/*
+	 * Masters drop the region lock straight after putting the record,
+	 * so they can reserve space in the segmented buffer under the lock
+	 * and copy the record in once it has been released.
+	 */
+	copy.npieces = 0;
+	copyp = NULL;
+	if (IS_REP_MASTER(dbenv) && lp->num_segments > 1 &&
+	    dbenv->attr.log_put_deferred_copy)
+		copyp = &copy;
+
 	{
 		pp = udbt->data;
 		LOGCOPY_32(&rectype, pp);
@@ -279,7 +322,7 @@ __log_put_int_int(dbenv, lsnp, contextp, udbt, flags, off_context, usr_ptr)
 
 	if ((ret =
 		__log_put_next(dbenv, lsnp, contextp, dbt, udbt, &hdr, &old_lsn,
-		    off_context, key, flags)) != 0)
+		    off_context, key, flags, copyp)) != 0)
 		goto panic_check;
 
 	lsn = *lsnp;
@@ -301,6 +344,11 @@ __log_put_int_int(dbenv, lsnp, contextp, udbt, flags, off_context, usr_ptr)
 		 */
 		R_UNLOCK(dbenv, &dblp->reginfo);
 		lock_held = 0;
+
+		/* Copy in the record we reserved space for. */
+		if (copy.npieces > 0)
+			__log_copy_finish(dblp, &copy);
+
 		/*
 		 * If we are not a rep application, but are sharing a
 		 * master rep env, we should not be writing log records.
@@ -359,6 +407,13 @@ __log_put_int_int(dbenv, lsnp, contextp, udbt, flags, off_context, usr_ptr)
 			    db_eid_broadcast, REP_LOG_LOGPUT, &lsn, udbt, flags,
 			    usr_ptr) != 0) && LF_ISSET(DB_LOG_PERM))
 			 LF_SET(DB_FLUSH);
+	} else if (copy.npieces > 0) {
+		/*
+		 * We lost mastership after reserving space.  Copy the record
+		 * in while still holding the lock: the flush below would
+		 * otherwise wait on our own reservation forever.
+		 */
+		__log_copy_finish(dblp, &copy);
 	}
 
 	/*
@@ -394,13 +449,20 @@ panic_check:	/*
 		 * replication clients, the transaction can no longer
 		 * abort, otherwise the master would be out of sync with
 		 * the rest of the replication group.  Panic the system.
+		 * Finish any partial reservation first, so that nothing
+		 * waits on it.
 		 */
+		if (copy.npieces > 0)
+			__log_copy_finish(dblp, &copy);
 		if (ret != 0 && IS_REP_MASTER(dbenv))
 			ret = __db_panic(dbenv, ret);
 	}
 err:
 	if (lock_held)
 		R_UNLOCK(dbenv, &dblp->reginfo);
+	/* Never leave a reservation behind: the log writer would wait on it. */
+	if (copy.npieces > 0)
+		__log_copy_finish(dblp, &copy);
 	if (need_free)
 		__os_free(dbenv, dbt->data);
 
@@ -653,7 +715,7 @@ __log_txn_lsn(dbenv, lsnp, mbytesp, bytesp)
  * turn out to be.
  */
 static int
-__log_put_next(dbenv, lsn, context, dbt, udbt, hdr, old_lsnp, off_context, key, flags)
+__log_put_next(dbenv, lsn, context, dbt, udbt, hdr, old_lsnp, off_context, key, flags, copy)
 	DB_ENV *dbenv;
 	DB_LSN *lsn;
 	u_int64_t *context;
@@ -664,6 +726,7 @@ __log_put_next(dbenv, lsn, context, dbt, udbt, hdr, old_lsnp, off_context, key,
 	int off_context;
 	u_int8_t *key;
 	u_int32_t flags;
+	struct __log_copy *copy;
 {
 	DB_LOG *dblp;
 	DB_LSN old_lsn;
@@ -795,7 +858,8 @@ __log_put_next(dbenv, lsn, context, dbt, udbt, hdr, old_lsnp, off_context, key,
 	}
 
 	/* Actually put the record. */
-	return (__log_putr(dblp, lsn, dbt, lp->lsn.offset - lp->len, hdr));
+	return (__log_putr(dblp, lsn, dbt, lp->lsn.offset - lp->len, hdr,
+	    copy));
 }
 
 /*
@@ -853,6 +917,9 @@ __write_inmemory_buffer_lk(dblp, bytes_written, write_all)
 
 	/* Write to the buffer end. */
 	if (nxwseg > curseg) {
+		for (begseg = nxwseg; begseg < lp->num_segments; begseg++)
+			__log_wait_seg_copies(dblp, begseg);
+
 		/* Actually do the write. */
 		if ((ret = __log_write(dblp, dblp->bufp + lp->l_off,
 			    lp->buffer_size - lp->l_off)) != 0) {
@@ -876,7 +943,13 @@ __write_inmemory_buffer_lk(dblp, bytes_written, write_all)
 
 	/* Write to the begining of the current segment. */
 	if (nxwseg < curseg || (write_all && nxwseg == curseg)) {
+		for (begseg = nxwseg; begseg < curseg; begseg++)
+			__log_wait_seg_copies(dblp, begseg);
+
 		if (write_all) {
+			/* The region lock is held, so b_off can't move. */
+			__log_wait_seg_copies(dblp, curseg);
+
 			/* Write if there's anything to write. */
 			if (lp->b_off != lp->l_off)
 				ret = __log_write(dblp, dblp->bufp + lp->l_off,
@@ -1127,7 +1200,7 @@ __log_newfile(dblp, lsnp)
 	    (CRYPTO_ON(dbenv)) ? db_cipher->mac_key : NULL, hdr.chksum);
 	lsn = lp->lsn;
 	if ((ret = __log_putr(dblp, &lsn,
-		    &t, lastoff == 0 ? 0 : lastoff - lp->len, &hdr)) != 0)
+		    &t, lastoff == 0 ? 0 : lastoff - lp->len, &hdr, NULL)) != 0)
 		goto err;
 
 	/* Update the LSN information returned to the caller. */
@@ -1142,15 +1215,19 @@ err:
 
 /*
  * __log_putr --
- *	Actually put a record into the log.
+ *	Actually put a record into the log.  If copy is non-NULL and the
+ * record fits in a log segment, space is only reserved for it and the caller
+ * must call __log_copy_finish once it has dropped the region lock.  The
+ * header and data must stay valid until then.
  */
 static int
-__log_putr(dblp, lsn, dbt, prev, h)
+__log_putr(dblp, lsn, dbt, prev, h, copy)
 	DB_LOG *dblp;
 	DB_LSN *lsn;
 	const DBT *dbt;
 	u_int32_t prev;
 	HDR *h;
+	struct __log_copy *copy;
 {
 	DB_CIPHER *db_cipher;
 	DB_ENV *dbenv;
@@ -1206,8 +1283,13 @@ __log_putr(dblp, lsn, dbt, prev, h)
 
 	/* Run segmented __log_fill if enabled. */
 	if (lp->num_segments > 1) {
+		log_write_dblp = dblp;
+		pthread_once(&log_write_once, __log_write_segments_init);
+		if (copy != NULL && (h == NULL || log_seg_copies == NULL ||
+		    nr + dbt->size > lp->segment_size))
+			copy = NULL;
 		tmplsn = *lsn;
-		ret = __log_fill_segments(dblp, lsn, &tmplsn, hdr, nr);
+		ret = __log_fill_segments(dblp, lsn, &tmplsn, hdr, nr, copy);
 		assert(tmplsn.offset == lsn->offset + nr);
 	} else {
 		ret = __log_fill(dblp, lsn, hdr, (u_int32_t)nr);
@@ -1220,7 +1302,7 @@ __log_putr(dblp, lsn, dbt, prev, h)
 		/* Sanity check. */
 		ret =
 		    __log_fill_segments(dblp, lsn, &tmplsn, dbt->data,
-		    dbt->size);
+		    dbt->size, copy);
 		assert(tmplsn.offset == lsn->offset + nr + dbt->size);
 	} else {
 		ret = __log_fill(dblp, lsn, dbt->data, dbt->size);
@@ -1750,20 +1832,93 @@ __log_write_td(arg)
 static void
 __log_write_segments_init(void)
 {
+	LOG *lp = log_write_dblp->reginfo.primary;
+
+	/* Without the counters records are just copied under the lock. */
+	if (__os_calloc(log_write_dblp->dbenv, lp->num_segments,
+	    sizeof(int), &log_seg_copies) != 0)
+		log_seg_copies = NULL;
 	Pthread_create(&log_write_td, NULL, __log_write_td, log_write_dblp);
 }
 
+/*
+ * Wait for copies reserved in segment seg to be completed.  The threads
+ * doing them hold no locks, so this can't deadlock.
+ */
+static void
+__log_wait_seg_copies(dblp, seg)
+	DB_LOG *dblp;
+	u_int32_t seg;
+{
+	LOG *lp;
+	int spins;
+
+	if (log_seg_copies == NULL || ATOMIC_LOAD32(log_seg_copies[seg]) == 0)
+		return;
+
+	lp = dblp->reginfo.primary;
+	++lp->stat.st_copy_waits;
+	for (spins = 0; ATOMIC_LOAD32(log_seg_copies[seg]) != 0; ++spins) {
+		if (spins < 100)
+			sched_yield();
+		else
+			__os_yield(dblp->dbenv, 1);
+	}
+}
+
+/*
+ * __log_wait_copies --
+ *	Wait for all outstanding copies into the segmented log buffer.  Called
+ * with the region lock held, so no new space can be reserved meanwhile.
+ *
+ * PUBLIC: void __log_wait_copies __P((DB_LOG *));
+ */
+void
+__log_wait_copies(dblp)
+	DB_LOG *dblp;
+{
+	LOG *lp;
+	u_int32_t seg;
+
+	lp = dblp->reginfo.primary;
+	if (lp->num_segments <= 1 || log_seg_copies == NULL)
+		return;
+	for (seg = 0; seg < lp->num_segments; seg++)
+		__log_wait_seg_copies(dblp, seg);
+}
+
+/*
+ * __log_copy_finish --
+ *	Copy a record into the space reserved for it by __log_fill_segments
+ * and publish each piece.  Called without the region lock.
+ */
+static void
+__log_copy_finish(dblp, copy)
+	DB_LOG *dblp;
+	struct __log_copy *copy;
+{
+	int i;
+
+	for (i = 0; i < copy->npieces; i++) {
+		memcpy(copy->piece[i].dst, copy->piece[i].src,
+		    copy->piece[i].len);
+		ATOMIC_ADD32(log_seg_copies[copy->piece[i].seg], -1);
+	}
+	copy->npieces = 0;
+}
+
 /*
  * __log_fill_segments --
  * Multi-segmented version of __log_fill.
  */
 static int
-__log_fill_segments(dblp, startlsn, lsn, addr, len)
+__log_fill_segments(dblp, startlsn, lsn, addr, len, copy)
 	DB_LOG *dblp;
 	DB_LSN *startlsn;
 	DB_LSN *lsn;
 	void *addr;
 	u_int32_t len;
+	struct __log_copy *copy;
 {
 	LOG *lp;
 	DB_LSN *seg_lsn_array, *seg_start_lsn_array;
@@ -1868,8 +2023,22 @@ __log_fill_segments(dblp, startlsn, lsn, addr, len)
 		/* Determine the amount to copy. */
 		copyamt = (segspace > len) ? len : segspace;
 
-		/* Copy into the log-buffer. */
-		memcpy(dblp->bufp + lp->b_off, addr, copyamt);
+		/*
+		 * Copy into the log-buffer, or just reserve the space.  The
+		 * count has to be raised before b_off moves past it, since
+		 * the writer thread reads b_off without the region lock.
+		 */
+		if (copy != NULL) {
+			DB_ASSERT(copy->npieces < LOG_COPY_MAXPIECES);
+			ATOMIC_ADD32(log_seg_copies[curseg], 1);
+			copy->piece[copy->npieces].dst = dblp->bufp + lp->b_off;
+			copy->piece[copy->npieces].src = addr;
+			copy->piece[copy->npieces].len = (u_int32_t)copyamt;
+			copy->piece[copy->npieces].seg = curseg;
+			copy->npieces++;
+			++lp->stat.st_deferred_copies;
+		} else
+			memcpy(dblp->bufp + lp->b_off, addr, copyamt);
 
 		/* Increment addr. */
 		addr = (u_int8_t *)addr + copyamt;
@@ -2312,7 +2481,7 @@ __log_rep_put(dbenv, lsnp, rec)
 	    (CRYPTO_ON(dbenv)) ? db_cipher->mac_key : NULL, hdr.chksum);
 
 	DB_ASSERT(log_compare(lsnp, &lp->lsn) == 0);
-	ret = __log_putr(dblp, lsnp, dbt, lp->lsn.offset - lp->len, &hdr);
+	ret = __log_putr(dblp, lsnp, dbt, lp->lsn.offset - lp->len, &hdr, NULL);
 
         /* Physical replication:
 
@@ -33,6 +33,7 @@ static const char revid[] = "$Id: mp_alloc.c,v 11.40 2003/07/03 02:24:34 bostic
 #include <cdb2_constants.h>
 #include "logmsg.h"
 #include "sys_wrap.h"
+#include "comdb2_atomic.h"
 
 typedef struct {
 	DB_MPOOL_HASH *bucket;
@@ -184,6 +185,11 @@ static void dump_page_stats(DB_ENV *dbenv) {
 	logmsgf(LOGMSG_USER, out, "st_pf_evict: %"PRId64"\n", mpool_stats->st_pf_evict);
 	logmsgf(LOGMSG_USER, out, "st_rw_evict_skip: %"PRId64"\n", mpool_stats->st_rw_evict_skip);
 	logmsgf(LOGMSG_USER, out, "st_page_trickle: %"PRId64"\n", mpool_stats->st_page_trickle);
+	logmsgf(LOGMSG_USER, out, "st_trickle_passes: %"PRId64"\n", mpool_stats->st_trickle_passes);
+	logmsgf(LOGMSG_USER, out, "st_trickle_paced: %"PRId64"\n", mpool_stats->st_trickle_paced);
+	logmsgf(LOGMSG_USER, out, "st_trickle_logbytes: %"PRId64"\n", mpool_stats->st_trickle_logbytes);
+	logmsgf(LOGMSG_USER, out, "st_trickle_dirty: %"PRId64"\n", mpool_stats->st_trickle_dirty);
+	logmsgf(LOGMSG_USER, out, "st_trickle_max_dirty: %"PRId64"\n", mpool_stats->st_trickle_max_dirty);
 	logmsgf(LOGMSG_USER, out, "st_pages: %"PRId64"\n", mpool_stats->st_pages);
 	logmsgf(LOGMSG_USER, out, "st_page_clean: %"PRId64"\n", mpool_stats->st_page_clean);
 	logmsgf(LOGMSG_USER, out, "st_page_dirty: %"PRId32"\n", mpool_stats->st_page_dirty);
@@ -194,6 +200,9 @@ static void dump_page_stats(DB_ENV *dbenv) {
 	logmsgf(LOGMSG_USER, out, "st_hash_nowait: %"PRId64"\n", mpool_stats->st_hash_nowait);
 	logmsgf(LOGMSG_USER, out, "st_hash_wait: %"PRId64"\n", mpool_stats->st_hash_wait);
 	logmsgf(LOGMSG_USER, out, "st_hash_max_wait: %"PRId64"\n", mpool_stats->st_hash_max_wait);
+	logmsgf(LOGMSG_USER, out, "st_hash_max_wait_bucket: %"PRId64"\n", mpool_stats->st_hash_max_wait_bucket);
+	logmsgf(LOGMSG_USER, out, "st_hash_optimistic: %"PRId64"\n", mpool_stats->st_hash_optimistic);
+	logmsgf(LOGMSG_USER, out, "st_hash_optimistic_fail: %"PRId64"\n", mpool_stats->st_hash_optimistic_fail);
 	logmsgf(LOGMSG_USER, out, "st_hash_region_wait: %"PRId64"\n", mpool_stats->st_region_wait);
 	logmsgf(LOGMSG_USER, out, "st_hash_region_nowait: %"PRId64"\n",
 		mpool_stats->st_region_nowait);
@@ -249,7 +258,7 @@ __memp_alloc_flags(dbmp, memreg, mfp, len, offsetp, flags, retp)
 	DB_MUTEX *mutexp;
 	MPOOL *c_mp;
 	MPOOLFILE *bh_mfp;
-	size_t freed_space;
+	size_t freed_space, len_freed;
 	u_int32_t buckets, buffers, high_priority, priority, put_counter;
 	u_int32_t total_buckets;
 	int aggressive, giveup, ret;
@@ -495,7 +504,7 @@ found:		if (offsetp != NULL)
 		 */
 		if ((bhp =
 			SH_TAILQ_FIRST(&hp->hash_bucket,
-			    __bh)) == NULL ||bhp->ref != 0 ||
+			    __bh)) == NULL || BH_REF(bhp) != 0 ||
 		    bhp->priority > priority)
 			goto next_hb;
 
@@ -522,9 +531,9 @@ found:		if (offsetp != NULL)
 				goto next_hb;
 			}
 
-			++bhp->ref;
+			(void)BH_REF_INC(bhp);
 			ret = __memp_bhwrite(dbmp, hp, bh_mfp, bhp, 0);
-			--bhp->ref;
+			(void)BH_REF_DEC(bhp);
 			if (ret == 0) {
 				++c_mp->stat.st_rw_evict;
 				if(ISLEAF(bhp->buf)) ++c_mp->stat.st_rw_levict;
@@ -545,7 +554,7 @@ found:		if (offsetp != NULL)
 		 * something to allocate, avoid selecting this buffer again
 		 * by making it the bucket's least-desirable buffer.
 		 */
-		if (ret != 0 || bhp->ref != 0) {
+		if (ret != 0 || BH_REF(bhp) != 0) {
 			if (ret != 0 && aggressive)
 				__memp_bad_buffer(hp);
 			goto next_hb;
@@ -558,14 +567,17 @@ found:		if (offsetp != NULL)
 		 */
 		if (mfp != NULL &&
 		    mfp->stat.st_pagesize == bh_mfp->stat.st_pagesize) {
-			__memp_bhfree(dbmp, hp, bhp, 0);
+			if (__memp_bhfree(dbmp, hp, bhp, 0, 0) != 0)
+				goto next_hb;
 
 			p = bhp;
 			goto found;
 		}
 
-		freed_space += __db_shsizeof(bhp);
-		__memp_bhfree(dbmp, hp, bhp, 1);
+		len_freed = __db_shsizeof(bhp);
+		if (__memp_bhfree(dbmp, hp, bhp, 0, 1) != 0)
+			goto next_hb;
+		freed_space += len_freed;
 		if (aggressive > 1)
 			aggressive = 1;
 
@@ -623,6 +635,8 @@ __memp_bad_buffer(hp)
 	BH *bhp;
 	u_int32_t priority;
 
+	MP_HASH_WRITE_BEGIN(hp);
+
 	/* Remove the first buffer from the bucket. */
 	bhp = SH_TAILQ_FIRST(&hp->hash_bucket, __bh);
 	SH_TAILQ_REMOVE(&hp->hash_bucket, bhp, hq, __bh);
@@ -642,6 +656,8 @@ __memp_bad_buffer(hp)
 	bhp->priority = priority;
 	SH_TAILQ_INSERT_TAIL(&hp->hash_bucket, bhp, hq);
 
+	MP_HASH_WRITE_END(hp);
+
 	/* Reset the hash bucket's priority. */
 	hp->hash_priority = SH_TAILQ_FIRST(&hp->hash_bucket, __bh)->priority;
 }
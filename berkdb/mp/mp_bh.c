@@ -510,7 +510,10 @@ err:	MUTEX_UNLOCK(dbenv, &bhp->mutex);
 	/*
 	 * If no errors occurred, the data is now valid, clear the BH_TRASH
 	 * flag; regardless, clear the lock bit and let other threads proceed.
+	 * Optimistic readers test these flags without the bucket mutex, so
+	 * the page contents must be visible before the flags change.
 	 */
+	ATOMIC_FENCE();
 	F_CLR(bhp, BH_LOCKED);
 	if (ret == 0)
 		F_CLR(bhp, BH_TRASH);
@@ -894,17 +897,24 @@ __memp_pgwrite_multi(dbenv, dbmfp, hps, bhps, numpages, wrrec)
 	/*
 	 * Call any pgout function.  We set the callpgin flag so that we flag
 	 * that the contents of the buffer will need to be passed through pgin
-	 * before they are reused.
+	 * before they are reused.  With several pages in hand, let pgout
+	 * defer the page checksums so they can be computed together.
 	 */
+	if (numpages > 1)
+		__db_chksum_batch_begin();
 	for (i = 0; i < numpages; i++) {
 		bhp = bhps[i];
 
 		if (mfp->ftype != 0 && !F_ISSET(bhp, BH_CALLPGIN)) {
 			callpgin[i] = 1;
 			if ((ret = __memp_pg(dbmfp, bhp, 0)) != 0)
-				goto err;
+				break;
 		}
 	}
+	if (numpages > 1)
+		__db_chksum_batch_end();
+	if (ret != 0)
+		goto err;
 
 	/* Recovery-page logging.  */
 	for (i = 0; i < numpages; i++) {
@@ -1164,15 +1174,20 @@ __memp_pg(dbmfp, bhp, is_pgin)
 
 /*
  * __memp_bhfree --
- *	Free a bucket header and its referenced data.
+ *	Free a bucket header and its referenced data.  The caller holds ref
+ *	references to the buffer; if an optimistic fget pinned it in the
+ *	meantime, leave it alone, return DB_LOCK_NOTGRANTED and keep the hash
+ *	bucket locked.
  *
- * PUBLIC: void __memp_bhfree __P((DB_MPOOL *, DB_MPOOL_HASH *, BH *, int));
+ * PUBLIC: int __memp_bhfree
+ * PUBLIC:     __P((DB_MPOOL *, DB_MPOOL_HASH *, BH *, u_int16_t, int));
  */
-void
-__memp_bhfree(dbmp, hp, bhp, free_mem)
+int
+__memp_bhfree(dbmp, hp, bhp, ref, free_mem)
 	DB_MPOOL *dbmp;
 	DB_MPOOL_HASH *hp;
 	BH *bhp;
+	u_int16_t ref;
 	int free_mem;
 {
 	DB_ENV *dbenv;
@@ -1187,6 +1202,17 @@ __memp_bhfree(dbmp, hp, bhp, free_mem)
 	mp = dbmp->reginfo[0].primary;
 	n_cache = NCACHE(mp, bhp->mpf, bhp->pgno);
 
+	/*
+	 * Announce the chain change before checking the reference count: an
+	 * optimistic fget bumps the count and then checks the generation, so
+	 * one of us is guaranteed to see the other.
+	 */
+	MP_HASH_WRITE_BEGIN(hp);
+	if (BH_REF(bhp) != ref) {
+		MP_HASH_WRITE_END(hp);
+		return (DB_LOCK_NOTGRANTED);
+	}
+
 	/*
 	 * Delete the buffer header from the hash bucket queue and reset
 	 * the hash bucket's priority, if necessary.
@@ -1196,6 +1222,7 @@ __memp_bhfree(dbmp, hp, bhp, free_mem)
 		hp->hash_priority =
 		    SH_TAILQ_FIRST(&hp->hash_bucket, __bh) == NULL ?
 		    0 : SH_TAILQ_FIRST(&hp->hash_bucket, __bh)->priority;
+	MP_HASH_WRITE_END(hp);
 
 	/*
 	 * Discard the hash bucket's mutex, it's no longer needed, and
@@ -1203,6 +1230,12 @@ __memp_bhfree(dbmp, hp, bhp, free_mem)
 	 */
 	MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
 
+	/*
+	 * A lock-free reader may still be looking at the header; wait for
+	 * it before the memory is reused or freed.
+	 */
+	__memp_optimistic_quiesce();
+
 	/*
 	 * Find the underlying MPOOLFILE and decrement its reference count.
 	 * If this is its last reference, remove it.
@@ -1233,4 +1266,5 @@ __memp_bhfree(dbmp, hp, bhp, free_mem)
 		c_mp->stat.st_pages--;
 	}
 	R_UNLOCK(dbenv, &dbmp->reginfo[n_cache]);
+	return (0);
 }
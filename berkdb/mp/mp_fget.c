@@ -214,6 +214,208 @@ __memp_falloc_len(mfp, offset, len)
 
 u_int64_t gbl_memp_pgreads = 0;
 
+/*
+ * Optimistic lookups --
+ *	A page already in the cache can usually be pinned without the hash
+ *	bucket mutex: walk the chain checking the bucket generation between
+ *	steps, bump the buffer's reference count, and check the generation
+ *	again.  Anything that unlinks a buffer header checks the reference
+ *	count after bumping the generation (see __memp_bhfree), so either the
+ *	reader or the writer backs off.
+ *
+ *	A writer that removed a header must also not reuse its memory while a
+ *	reader may still be walking over it.  Each thread announces its
+ *	lookups in a slot (odd while a lookup runs), and
+ *	__memp_optimistic_quiesce waits out any lookup it sees in flight.  The
+ *	slots are process memory, so this is only done for DB_PRIVATE
+ *	environments.
+ */
+#define	MP_OPT_NSLOTS	4096		/* Threads that can take the path. */
+#define	MP_OPT_MAXCHAIN	16		/* Longest chain walked lock-free. */
+
+struct mp_opt_slot {
+	u_int32_t seq;			/* Odd while a lookup is running. */
+	u_int32_t inuse;
+	u_int8_t  pad[64 - 2 * sizeof(u_int32_t)];
+};
+
+static struct mp_opt_slot mp_opt_slots[MP_OPT_NSLOTS];
+static u_int32_t mp_opt_nslots;		/* Slots ever handed out. */
+static pthread_mutex_t mp_opt_lk = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t mp_opt_once = PTHREAD_ONCE_INIT;
+static pthread_key_t mp_opt_key;
+static __thread struct mp_opt_slot *mp_opt_slot;
+static __thread int mp_opt_noslot;
+
+static void
+__memp_opt_slot_release(arg)
+	void *arg;
+{
+	struct mp_opt_slot *slot;
+
+	slot = arg;
+	Pthread_mutex_lock(&mp_opt_lk);
+	slot->inuse = 0;
+	Pthread_mutex_unlock(&mp_opt_lk);
+}
+
+static void
+__memp_opt_init(void)
+{
+	Pthread_key_create(&mp_opt_key, __memp_opt_slot_release);
+}
+
+static struct mp_opt_slot *
+__memp_opt_get_slot(void)
+{
+	struct mp_opt_slot *slot;
+	u_int32_t i;
+
+	if (mp_opt_slot != NULL || mp_opt_noslot)
+		return (mp_opt_slot);
+
+	Pthread_once(&mp_opt_once, __memp_opt_init);
+	slot = NULL;
+	Pthread_mutex_lock(&mp_opt_lk);
+	for (i = 0; i < MP_OPT_NSLOTS; i++) {
+		if (mp_opt_slots[i].inuse)
+			continue;
+		slot = &mp_opt_slots[i];
+		slot->inuse = 1;
+		if (i >= mp_opt_nslots)
+			(void)XCHANGE32(mp_opt_nslots, i + 1);
+		break;
+	}
+	Pthread_mutex_unlock(&mp_opt_lk);
+
+	/* Out of slots: this thread always takes the bucket mutex. */
+	if (slot == NULL) {
+		mp_opt_noslot = 1;
+		return (NULL);
+	}
+	Pthread_setspecific(mp_opt_key, slot);
+	return (mp_opt_slot = slot);
+}
+
+/*
+ * __memp_optimistic_quiesce --
+ *	Wait for every optimistic lookup that may have seen a buffer header
+ *	which the caller just unlinked from its hash chain.
+ *
+ * PUBLIC: void __memp_optimistic_quiesce __P((void));
+ */
+void
+__memp_optimistic_quiesce()
+{
+	u_int32_t i, n, seq, spins;
+
+	ATOMIC_FENCE();
+	n = ATOMIC_LOAD32(mp_opt_nslots);
+	for (i = 0; i < n; i++) {
+		if (((seq = ATOMIC_LOAD32(mp_opt_slots[i].seq)) & 1) == 0)
+			continue;
+		for (spins = 0;
+		    ATOMIC_LOAD32(mp_opt_slots[i].seq) == seq; ++spins)
+			if (spins > 100)
+				__os_yield(NULL, 1);
+	}
+}
+
+/*
+ * __memp_optimistic_unpin --
+ *	Back out a reference taken by an optimistic lookup that failed its
+ *	final checks.  This is the reference accounting of __memp_fput.
+ */
+static void
+__memp_optimistic_unpin(dbenv, hp, bhp)
+	DB_ENV *dbenv;
+	DB_MPOOL_HASH *hp;
+	BH *bhp;
+{
+	MUTEX_LOCK(dbenv, &hp->hash_mutex);
+	if (BH_REF_DEC(bhp) <= 1 &&
+	    F_ISSET(bhp, BH_LOCKED) && bhp->ref_sync != 0)
+		--bhp->ref_sync;
+	MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
+}
+
+/*
+ * Buffers the optimistic path won't hand out.  Dirty buffers are left to
+ * the locked path because eviction writes them without waiting for pins
+ * taken after it checked the reference count.
+ */
+#define	MP_OPT_BADFLAGS	(BH_CALLPGIN | BH_DIRTY | BH_LOCKED | BH_TRASH)
+
+/*
+ * __memp_fget_optimistic --
+ *	Try to find and pin a resident page without the hash bucket mutex.
+ *	Returns NULL if the page has to be looked up the usual way.
+ */
+static BH *
+__memp_fget_optimistic(dbenv, c_mp, hp, mfp, pgno)
+	DB_ENV *dbenv;
+	MPOOL *c_mp;
+	DB_MPOOL_HASH *hp;
+	MPOOLFILE *mfp;
+	db_pgno_t pgno;
+{
+	struct mp_opt_slot *slot;
+	BH *bhp;
+	u_int32_t gen, n;
+	u_int16_t ref;
+
+	if ((slot = __memp_opt_get_slot()) == NULL)
+		return (NULL);
+
+	(void)ATOMIC_ADD32(slot->seq, 1);
+	ATOMIC_FENCE();
+
+	if ((gen = ATOMIC_LOAD32(hp->hash_gen)) & 1)
+		goto busy;
+	for (n = 0, bhp = SH_TAILQ_FIRST(&hp->hash_bucket, __bh);;
+	    bhp = SH_TAILQ_NEXT(bhp, hq, __bh)) {
+		/* Don't follow a link a writer may have been changing. */
+		ATOMIC_ACQUIRE_FENCE();
+		if (ATOMIC_LOAD32(hp->hash_gen) != gen)
+			goto busy;
+		if (bhp == NULL)
+			goto miss;
+		if (bhp->pgno == pgno && bhp->mpf == mfp)
+			break;
+		if (++n == MP_OPT_MAXCHAIN)
+			goto miss;
+	}
+
+	for (;;) {
+		if (F_ISSET(bhp, MP_OPT_BADFLAGS))
+			goto miss;
+		if ((ref = BH_REF(bhp)) >= UINT16_T_MAX - 1)
+			goto miss;
+		if (CAS16(bhp->ref, ref, ref + 1))
+			break;
+	}
+
+	/*
+	 * We hold a reference: nobody can free the buffer unless they got to
+	 * it before we did, in which case the generation has moved.
+	 */
+	if (ATOMIC_LOAD32(hp->hash_gen) != gen ||
+	    F_ISSET(bhp, MP_OPT_BADFLAGS) ||
+	    bhp->pgno != pgno || bhp->mpf != mfp) {
+		__memp_optimistic_unpin(dbenv, hp, bhp);
+		goto busy;
+	}
+	ATOMIC_ACQUIRE_FENCE();
+	(void)ATOMIC_ADD32(slot->seq, 1);
+
+	++c_mp->stat.st_hash_optimistic;
+	return (bhp);
+
+busy:	++hp->hash_optimistic_fail;
+miss:	(void)ATOMIC_ADD32(slot->seq, 1);
+	return (NULL);
+}
+
 /*
  * __memp_fget_internal --
  *	Get a page from the file.
@@ -326,6 +528,22 @@ hb_search:
 	hp = R_ADDR(&dbmp->reginfo[n_cache], c_mp->htab);
 	hp = &hp[NBUCKET(c_mp, mfp, *pgnoaddr)];
 
+	/* Try to pin a resident page without the hash bucket mutex. */
+	if (alloc_bhp == NULL && dbenv->attr.mpool_optimistic_fget &&
+	    F_ISSET(dbenv, DB_ENV_PRIVATE) &&
+	    (flags == 0 || flags == DB_MPOOL_CREATE ||
+	    flags == DB_MPOOL_LAST) &&
+	    (bhp = __memp_fget_optimistic(dbenv,
+	    c_mp, hp, mfp, *pgnoaddr)) != NULL) {
+		/* Layer violation */
+		if (ISINTERNAL(bhp->buf))
+			++mfp->stat.st_cache_ihit;
+		else if (ISLEAF(bhp->buf))
+			++mfp->stat.st_cache_lhit;
+		++mfp->stat.st_cache_hit;
+		goto pinned;
+	}
+
 	/* Search the hash chain for the page. */
 retry:	st_hsearch = 0;
 	MUTEX_LOCK(dbenv, &hp->hash_mutex);
@@ -341,7 +559,7 @@ retry:	st_hsearch = 0;
 		 * need to ensure it doesn't move and its contents remain
 		 * unchanged.
 		 */
-		if (bhp->ref == UINT16_T_MAX) {
+		if (BH_REF(bhp) == UINT16_T_MAX) {
 			__db_err(dbenv,
 			    "%s: page %lu: reference count overflow",
 			    __memp_fn(dbmfp), (u_long)bhp->pgno);
@@ -349,7 +567,7 @@ retry:	st_hsearch = 0;
 			MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
 			goto err;
 		}
-		++bhp->ref;
+		(void)BH_REF_INC(bhp);
 		b_incr = 1;
 
 		/*
@@ -367,7 +585,7 @@ retry:	st_hsearch = 0;
 			 * and try again.
 			 */
 			if (!first && bhp->ref_sync != 0) {
-				--bhp->ref;
+				(void)BH_REF_DEC(bhp);
 				b_incr = 0;
 				MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
 				__os_yield(dbenv, 1);
@@ -626,7 +844,7 @@ alloc:		/*
 		 * another one.
 		 */
 		if (flags == DB_MPOOL_NEW) {
-			--bhp->ref;
+			(void)BH_REF_DEC(bhp);
 			b_incr = 0;
 			goto alloc;
 		}
@@ -644,23 +862,28 @@ alloc:		/*
 		alloc_bhp = NULL;
 
 		/*
-		 * Initialize all the BH and hash bucket fields so we can call
-		 * __memp_bhfree if an error occurs.
-		 *
-		 * Append the buffer to the tail of the bucket list and update
-		 * the hash bucket's priority.
+		 * Initialize all the BH fields before the buffer is linked into
+		 * the bucket: optimistic lookups walk the chain without the
+		 * hash mutex, and must see either a BH_TRASH or a BH_DIRTY
+		 * buffer they leave alone, or nothing at all.
 		 */
-		b_incr = 1;
-
 		memset(bhp, 0, sizeof(BH));
 		bhp->ref = 1;
 		bhp->priority = UINT32_T_MAX;
 		bhp->pgno = *pgnoaddr;
 		bhp->mpf = mfp;
-		SH_TAILQ_INSERT_TAIL(&hp->hash_bucket, bhp, hq);
 
-		hp->hash_priority =
-		    SH_TAILQ_FIRST(&hp->hash_bucket, __bh)->priority;
+		/*
+		 * Initialize the mutex first, because it's the only step that
+		 * can fail, and until the buffer is linked in the err label
+		 * just gives back its memory.
+		 */
+		if ((ret = __db_mutex_setup(dbenv,
+		    &dbmp->reginfo[n_cache], &bhp->mutex, 0)) != 0) {
+			alloc_bhp = bhp;
+			MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
+			goto err;
+		}
 
 		/* If we extended the file, make sure the page is never lost. */
 		if (extending) {
@@ -683,6 +906,24 @@ alloc:		/*
 			F_SET(bhp, BH_NOINCR);
 		}
 
+		/* The page has to be read in. */
+		if (!extending)
+			F_SET(bhp, BH_TRASH);
+
+		/*
+		 * Append the buffer to the tail of the bucket list and update
+		 * the hash bucket's priority.  From here on errors go through
+		 * __memp_bhfree.
+		 */
+		b_incr = 1;
+		ATOMIC_FENCE();
+		MP_HASH_WRITE_BEGIN(hp);
+		SH_TAILQ_INSERT_TAIL(&hp->hash_bucket, bhp, hq);
+		MP_HASH_WRITE_END(hp);
+
+		hp->hash_priority =
+		    SH_TAILQ_FIRST(&hp->hash_bucket, __bh)->priority;
+
 		/*
 		 * If we created the page, zero it out.  If we didn't create
 		 * the page, read from the backing file.
@@ -717,8 +958,6 @@ alloc:		/*
 
 			++mfp->stat.st_page_create;
 		} else {
-
-			F_SET(bhp, BH_TRASH);
 			++mfp->stat.st_cache_miss;
 			if (LF_ISSET(DB_MPOOL_PFGET)) {
 				++c_mp->stat.st_page_pf_in;
@@ -738,16 +977,6 @@ alloc:		/*
 		MUTEX_LOCK(dbenv, &mfp->mutex);
 		++mfp->block_cnt;
 		MUTEX_UNLOCK(dbenv, &mfp->mutex);
-
-		/*
-		 * Initialize the mutex.  This is the last initialization step,
-		 * because it's the only one that can fail, and everything else
-		 * must be set up or we can't jump to the err label because it
-		 * will call __memp_bhfree.
-		 */
-		if ((ret = __db_mutex_setup(dbenv,
-		    &dbmp->reginfo[n_cache], &bhp->mutex, 0)) != 0)
-			goto err;
 	}
 
 	DB_ASSERT(bhp->ref != 0);
@@ -760,12 +989,14 @@ alloc:		/*
 	 */
 
 	/* from patch */
-	if (state != SECOND_MISS && bhp->ref == 1) {
+	if (state != SECOND_MISS && BH_REF(bhp) == 1) {
 		bhp->priority = UINT32_T_MAX;
 		if (SH_TAILQ_FIRST(&hp->hash_bucket, __bh) !=
 		    SH_TAILQ_LAST(&hp->hash_bucket, HashTab)) {
+			MP_HASH_WRITE_BEGIN(hp);
 			SH_TAILQ_REMOVE(&hp->hash_bucket, bhp, hq, __bh);
 			SH_TAILQ_INSERT_TAIL(&hp->hash_bucket, bhp, hq);
+			MP_HASH_WRITE_END(hp);
 		}
 		hp->hash_priority =
 		    SH_TAILQ_FIRST(&hp->hash_bucket, __bh)->priority;
@@ -819,11 +1050,14 @@ alloc:		/*
 	if (F_ISSET(bhp, BH_CALLPGIN)) {
 		if ((ret = __memp_pg(dbmfp, bhp, 1)) != 0)
 			goto err;
+		ATOMIC_FENCE();
 		F_CLR(bhp, BH_CALLPGIN);
 	}
 
 	MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
 
+pinned:
+
 #ifdef DIAGNOSTIC
 	/* Update the file's pinned reference count. */
 	R_LOCK(dbenv, dbmp->reginfo);
@@ -851,13 +1085,10 @@ err:	/*
 	 * the buffer entirely.  If we held a reference to a buffer, we are
 	 * also still holding the hash bucket mutex.
 	 */
-	if (b_incr) {
-		if (bhp->ref == 1)
-			(void)__memp_bhfree(dbmp, hp, bhp, 1);
-		else {
-			--bhp->ref;
-			MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
-		}
+	if (b_incr && (BH_REF(bhp) != 1 ||
+	    __memp_bhfree(dbmp, hp, bhp, 1, 1) != 0)) {
+		(void)BH_REF_DEC(bhp);
+		MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
 	}
 
 	/* If alloc_bhp is set, free the memory. */
@@ -71,6 +71,7 @@ __memp_fput_internal(dbmfp, pgaddr, flags, pgorder)
 	DB_MPOOL_HASH *hp;
 	MPOOL *c_mp;
 	u_int32_t n_cache;
+	u_int16_t ref;
 	int adjust, ret, incr_count = 1;
 
 	dbenv = dbmfp->dbenv;
@@ -177,7 +178,7 @@ __memp_fput_internal(dbmfp, pgaddr, flags, pgorder)
 	 * Check for a reference count going to zero.  This can happen if the
 	 * application returns a page twice.
 	 */
-	if (bhp->ref == 0) {
+	if (BH_REF(bhp) == 0) {
 		__db_err(dbenv, "%s: page %lu: unpinned page returned",
 		    __memp_fn(dbmfp), (u_long)bhp->pgno);
 		MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
@@ -192,7 +193,8 @@ __memp_fput_internal(dbmfp, pgaddr, flags, pgorder)
 	 * thread waiting to flush the buffer to disk, we're done.  Ignore the
 	 * discard flags (for now) and leave the buffer's priority alone.
 	 */
-	if (--bhp->ref > 1 || (bhp->ref == 1 && !F_ISSET(bhp, BH_LOCKED))) {
+	if ((ref = BH_REF_DEC(bhp)) > 1 ||
+	    (ref == 1 && !F_ISSET(bhp, BH_LOCKED))) {
 #ifdef REF_SYNC_TEST
 		if (F_ISSET(bhp, BH_LOCKED) && bhp->ref_sync) {
 			fprintf(stderr,
@@ -274,6 +276,7 @@ __memp_fput_internal(dbmfp, pgaddr, flags, pgorder)
 	    SH_TAILQ_LAST(&hp->hash_bucket, HashTab))
 		goto done;
 
+	MP_HASH_WRITE_BEGIN(hp);
 	if (fbhp == bhp)
 		fbhp = SH_TAILQ_NEXT(fbhp, hq, __bh);
 	SH_TAILQ_REMOVE(&hp->hash_bucket, bhp, hq, __bh);
@@ -286,6 +289,7 @@ __memp_fput_internal(dbmfp, pgaddr, flags, pgorder)
 		SH_TAILQ_INSERT_HEAD(&hp->hash_bucket, bhp, hq, __bh);
 	else
 		SH_TAILQ_INSERT_AFTER(&hp->hash_bucket, prev, bhp, hq, __bh);
+	MP_HASH_WRITE_END(hp);
 
 done:
 	/* Reset the hash bucket's priority. */
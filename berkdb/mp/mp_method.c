@@ -104,6 +104,7 @@ __memp_dbenv_create(dbenv)
 		dbenv->memp_load = __memp_load_pp;
 		dbenv->memp_dump_default = __memp_dump_default_pp;
 		dbenv->memp_load_default = __memp_load_default_pp;
+		dbenv->mempv_stat = __mempv_stat_pp;
 		dbenv->memp_trickle = __memp_trickle_pp;
 	}
 	dbenv->memp_fcreate = __memp_fcreate_pp;
@@ -138,6 +138,15 @@ __memp_stat(dbenv, gspp, fspp, flags)
 			sp->st_pf_evict += c_mp->stat.st_pf_evict;
 			sp->st_rw_evict_skip += c_mp->stat.st_rw_evict_skip;
 			sp->st_page_trickle += c_mp->stat.st_page_trickle;
+			sp->st_trickle_passes += c_mp->stat.st_trickle_passes;
+			sp->st_trickle_paced += c_mp->stat.st_trickle_paced;
+			sp->st_trickle_logbytes +=
+			    c_mp->stat.st_trickle_logbytes;
+			sp->st_trickle_dirty += c_mp->stat.st_trickle_dirty;
+			if (sp->st_trickle_max_dirty <
+			    c_mp->stat.st_trickle_max_dirty)
+				sp->st_trickle_max_dirty =
+				    c_mp->stat.st_trickle_max_dirty;
 			sp->st_pages += c_mp->stat.st_pages;
 			/*
 			 * st_page_dirty	calculated by __memp_stat_hash
@@ -150,9 +159,11 @@ __memp_stat(dbenv, gspp, fspp, flags)
 			sp->st_hash_searches += c_mp->stat.st_hash_searches;
 			sp->st_hash_longest += c_mp->stat.st_hash_longest;
 			sp->st_hash_examined += c_mp->stat.st_hash_examined;
+			sp->st_hash_optimistic += c_mp->stat.st_hash_optimistic;
 			/*
 			 * st_hash_nowait	calculated by __memp_stat_wait
 			 * st_hash_wait
+			 * st_hash_optimistic_fail
 			 */
 			__memp_stat_wait(&dbmp->reginfo[i], c_mp, sp, flags);
 			sp->st_region_nowait +=
@@ -540,17 +551,22 @@ __memp_stat_wait(reginfo, mp, mstat, flags)
 	int i;
 
 	mstat->st_hash_max_wait = 0;
+	mstat->st_hash_max_wait_bucket = 0;
 	hp = R_ADDR(reginfo, mp->htab);
 	for (i = 0; i < mp->htab_buckets; i++, hp++) {
 		mutexp = &hp->hash_mutex;
 		mstat->st_hash_nowait += mutexp->mutex_set_nowait;
 		mstat->st_hash_wait += mutexp->mutex_set_wait;
-		if (mutexp->mutex_set_wait > mstat->st_hash_max_wait)
+		if (mutexp->mutex_set_wait > mstat->st_hash_max_wait) {
 			mstat->st_hash_max_wait = mutexp->mutex_set_wait;
+			mstat->st_hash_max_wait_bucket = i;
+		}
+		mstat->st_hash_optimistic_fail += hp->hash_optimistic_fail;
 
 		if (LF_ISSET(DB_STAT_CLEAR)) {
 			mutexp->mutex_set_wait = 0;
 			mutexp->mutex_set_nowait = 0;
+			hp->hash_optimistic_fail = 0;
 		}
 	}
 }
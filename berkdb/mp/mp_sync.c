@@ -20,6 +20,7 @@ static const char revid[] = "$Id: mp_sync.c,v 11.80 2003/09/13 19:20:41 bostic E
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <pthread.h>
 #include <limits.h>
 #include <stdlib.h>
@@ -35,6 +36,7 @@ static const char revid[] = "$Id: mp_sync.c,v 11.80 2003/09/13 19:20:41 bostic E
 #include <pool.h>
 #include "logmsg.h"
 #include "sys_wrap.h"
+#include "comdb2_atomic.h"
 #include "debug_switches.h"
 #include "schema_lk.h"
 
@@ -651,7 +653,7 @@ trickle_do_work(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 				bhparray[j]->ref_sync = 0;
 
 				/* Discard our reference and unlock the bucket*/
-				--bhparray[j]->ref;
+				(void)BH_REF_DEC(bhparray[j]);
 				MUTEX_UNLOCK(dbenv, &hparray[j]->hash_mutex);
 			}
 
@@ -688,7 +690,7 @@ trickle_do_work(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 		 * If the buffer isn't pinned or dirty, we're done, there's
 		 * no work needed.
 		 */
-		if (bhp == NULL || (bhp->ref == 0 && !F_ISSET(bhp, BH_DIRTY))) {
+		if (bhp == NULL || (BH_REF(bhp) == 0 && !F_ISSET(bhp, BH_DIRTY))) {
 			MUTEX_UNLOCK(dbenv, mutexp);
 			--remaining;
 			bharray[i].track_hp = NULL;
@@ -706,7 +708,7 @@ trickle_do_work(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 		 * In either case, skip the buffer if we're not required to
 		 * write it.
 		 */
-		if (F_ISSET(bhp, BH_LOCKED) || (bhp->ref != 0 && pass < 2)) {
+		if (F_ISSET(bhp, BH_LOCKED) || (BH_REF(bhp) != 0 && pass < 2)) {
 			MUTEX_UNLOCK(dbenv, mutexp);
 			if (op != DB_SYNC_CACHE && op != DB_SYNC_FILE) {
 				--remaining;
@@ -720,12 +722,13 @@ trickle_do_work(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 		 *
 		 * Set the sync wait-for count, used to count down outstanding
 		 * references to this buffer as they are returned to the cache.
+		 *
+		 * Lock the buffer before taking our pin: an optimistic fget
+		 * pins without the bucket mutex, and either it is counted in
+		 * ref_sync here or it sees BH_LOCKED and backs its pin out.
 		 */
-		bhp->ref_sync = bhp->ref;
-
-		/* Pin the buffer into memory and lock it. */
-		++bhp->ref;
 		F_SET(bhp, BH_LOCKED);
+		bhp->ref_sync = BH_REF_INC(bhp) - 1;
 		MUTEX_LOCK(dbenv, &bhp->mutex);
 
 		/*
@@ -908,7 +911,7 @@ trickle_do_work(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 
 				/* Discard our reference and unlock
 				 * the bucket. */
-				--bhparray[j]->ref;
+				(void)BH_REF_DEC(bhparray[j]);
 				MUTEX_UNLOCK(dbenv, &hparray[j]->hash_mutex);
 			}
 
@@ -978,7 +981,7 @@ trickle_do_work(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 			bhp->ref_sync = 0;
 
 			/* Discard our reference and unlock the bucket. */
-			--bhp->ref;
+			(void)BH_REF_DEC(bhp);
 			MUTEX_UNLOCK(dbenv, mutexp);
 		}
 
@@ -1042,7 +1045,7 @@ trickle_do_work(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 		bhparray[j]->ref_sync = 0;
 
 		/* Discard our reference and unlock the bucket. */
-		--bhparray[j]->ref;
+		(void)BH_REF_DEC(bhparray[j]);
 		MUTEX_UNLOCK(dbenv, &hparray[j]->hash_mutex);
 	}
 
@@ -1063,6 +1066,9 @@ int gbl_load_cache_threads = 8;
 int gbl_load_cache_max_pages = 0;
 int gbl_dump_cache_max_pages = 0;
 int gbl_max_pages_per_cache_thread = 8192;
+int gbl_load_cache_readahead = 0;
+int gbl_load_cache_throttle_ms = 0;
+int gbl_load_cache_stop = 0;
 
 void init_trickle_threads(void)
 {
@@ -1238,7 +1244,7 @@ __memp_sync_int(dbenv, dbmfp, trickle_max, op, wrotep, restartable,
 			for (bhp = SH_TAILQ_FIRST(&hp->hash_bucket, __bh);
 			    bhp != NULL; bhp = SH_TAILQ_NEXT(bhp, hq, __bh)) {
 				/* Always ignore unreferenced, clean pages. */
-				if (bhp->ref == 0 && !F_ISSET(bhp, BH_DIRTY))
+				if (BH_REF(bhp) == 0 && !F_ISSET(bhp, BH_DIRTY))
 					continue;
 
 				/*
@@ -1941,6 +1947,35 @@ typedef struct fileid_page_env
 } fileid_page_env_t;
 
 void touch_page(DB_MPOOLFILE *mpf, db_pgno_t pgno);
+extern int gbl_force_direct_io;
+extern int db_is_exiting(void);
+
+/*
+ * load_readahead --
+ *	Ask the kernel to start reading the run of consecutive pages that
+ *	begins at pages[from], and return the index just past that run.
+ */
+static int
+load_readahead(DB_MPOOLFILE *dbmfp, db_pgno_t *pages, int from, int cnt)
+{
+	DB_FH *fhp;
+	off_t pgsz;
+	int to;
+
+	for (to = from + 1; to < cnt && pages[to] == pages[to - 1] + 1; ++to)
+		;
+#if defined(POSIX_FADV_WILLNEED)
+	fhp = dbmfp->fhp;
+	pgsz = dbmfp->mfp->stat.st_pagesize;
+	if (fhp != NULL && F_ISSET(fhp, DB_FH_OPENED))
+		(void)posix_fadvise(fhp->fd, (off_t)pages[from] * pgsz,
+		    (off_t)(to - from) * pgsz, POSIX_FADV_WILLNEED);
+#else
+	COMPQUIET(fhp, NULL);
+	COMPQUIET(pgsz, 0);
+#endif
+	return (to);
+}
 
 static void
 load_fileids(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
@@ -1951,11 +1986,24 @@ load_fileids(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 	DB_ENV *dbenv;
 	DB_MPOOL *dbmp;
 	DB_MPOOLFILE *dbmfp;
+	int ra, window, throttle;
 
 	dbenv = fileid_env->dbenv;
 	dbmp = dbenv->mp_handle;
 	dbmfp = NULL;
 
+	/*
+	 * Touch the pages in file order, keeping up to load_cache_readahead
+	 * of them in flight ahead of us so each thread has many reads
+	 * outstanding instead of one.  Readahead is pointless when the files
+	 * bypass the OS cache.
+	 */
+	qsort(pagelist->pages, pagelist->cnt, sizeof(db_pgno_t), pgcmp);
+	window = gbl_load_cache_readahead;
+	if (gbl_force_direct_io && F_ISSET(dbenv, DB_ENV_DIRECT_DB))
+		window = 0;
+	throttle = gbl_load_cache_throttle_ms;
+
 	rdlock_schema_lk();
 	MUTEX_THREAD_LOCK(dbenv, dbmp->mutexp);
 	for (dbmfp = TAILQ_FIRST(&dbmp->dbmfq); dbmfp != NULL;
@@ -1973,7 +2021,18 @@ load_fileids(struct thdpool *thdpool, void *work, void *thddata, int thd_op)
 			}
 		}
 
+		ra = 0;
 		for(int pages = 0 ; pages < pagelist->cnt; pages++) {
+			if (gbl_load_cache_stop || db_is_exiting())
+				break;
+			while (window > 0 && ra < pagelist->cnt &&
+			    ra < pages + window)
+				ra = load_readahead(dbmfp, pagelist->pages, ra,
+				    pagelist->cnt);
+			/* Leave the disks to foreground reads for a while. */
+			if (throttle > 0 && pages > 0 &&
+			    pages % (window > 0 ? window : 256) == 0)
+				poll(NULL, 0, throttle);
 			touch_page(dbmfp, pagelist->pages[pages]);
 		}
 	}
@@ -2154,9 +2213,11 @@ __memp_load(dbenv, s, pagecount, lines)
 	}
 
 	start = time(NULL);
+	gbl_load_cache_stop = 0;
 	char cfileid[DB_FILE_ID_LEN*2+1];
 	cfileid[DB_FILE_ID_LEN*2] = 0;
-	while ((!max_pages || (*pagecount) < max_pages) && (ret =
+	while ((!max_pages || (*pagecount) < max_pages) &&
+	    !gbl_load_cache_stop && (ret =
 				cdb2buf_fread(cfileid, DB_FILE_ID_LEN * 2, 1, s)) == 1) {
 		lineno++;
 		char *p = cfileid;
@@ -2246,8 +2307,12 @@ done:
 	Pthread_mutex_unlock(&lk);
 	end = time(NULL);
 
-	logmsg(LOGMSG_DEBUG, "Loaded %"PRIu64" bufferpool pages in %u seconds\n",
-			*pagecount, (end - start));
+	if (gbl_load_cache_stop)
+		logmsg(LOGMSG_INFO, "Stopped bufferpool load after %u seconds\n",
+		    (end - start));
+	else
+		logmsg(LOGMSG_DEBUG, "Loaded %"PRIu64" bufferpool pages in %u "
+		    "seconds\n", *pagecount, (end - start));
 	(*lines) = lineno;
 	return ret;
 }
@@ -25,6 +25,7 @@ static const char revid[] = "$Id: mp_trickle.c,v 11.30 2003/09/13 19:20:41 bosti
 #include <time.h>
 
 static int __memp_trickle __P((DB_ENV *, int, int *, int));
+static u_int64_t __memp_trickle_logbytes __P((DB_ENV *, DB_LSN *, DB_LSN *));
 
 /*
  * __memp_trickle_pp --
@@ -52,6 +53,28 @@ __memp_trickle_pp(dbenv, pct, nwrotep, lru)
 	return (ret);
 }
 
+/*
+ * __memp_trickle_logbytes --
+ *	Approximate the number of log bytes written between two LSNs.
+ */
+static u_int64_t
+__memp_trickle_logbytes(dbenv, from, to)
+	DB_ENV *dbenv;
+	DB_LSN *from, *to;
+{
+	DB_LOG *dblp;
+	LOG *lp;
+	int64_t bytes;
+
+	if (IS_ZERO_LSN(*from) || (dblp = dbenv->lg_handle) == NULL)
+		return (0);
+	lp = dblp->reginfo.primary;
+
+	bytes = (int64_t)(to->file - from->file) * lp->log_size +
+	    (int64_t)to->offset - (int64_t)from->offset;
+	return (bytes > 0 ? (u_int64_t)bytes : 0);
+}
+
 /*
  * __memp_trickle --
  *	DB_ENV->memp_trickle.
@@ -64,6 +87,7 @@ __memp_trickle(dbenv, pct, nwrotep, lru)
 	DB_MPOOL *dbmp;
 	MPOOL *c_mp, *mp;
 	DB_LSN last_lsn;
+	u_int64_t logbytes, pace;
 	u_int32_t dirty, i, total, dtmp;
 	int n, ret, wrote;
 
@@ -104,6 +128,30 @@ __memp_trickle(dbenv, pct, nwrotep, lru)
 	 * Be careful in modifying this calculation, total may be 0.
 	 */
 	n = ((total * pct) / 100) - (total - dirty);
+
+	/*
+	 * Pace the flusher against the log: for every memp_trickle_pace_mb
+	 * of log written since the last pass, write the whole dirty set once,
+	 * even if the clean percentage is already met.  This keeps the dirty
+	 * set from piling up until a checkpoint has to write it in one burst.
+	 */
+	logbytes = __memp_trickle_logbytes(dbenv, &mp->trickle_lsn, &last_lsn);
+	mp->stat.st_trickle_passes++;
+	mp->stat.st_trickle_logbytes += logbytes;
+	mp->stat.st_trickle_dirty = dirty;
+	if (mp->stat.st_trickle_max_dirty < dirty)
+		mp->stat.st_trickle_max_dirty = dirty;
+	if (dbenv->attr.memp_trickle_pace_mb > 0) {
+		pace = (u_int64_t)dirty * logbytes /
+		    ((u_int64_t)dbenv->attr.memp_trickle_pace_mb * MEGABYTE);
+		if (pace > dirty)
+			pace = dirty;
+		if ((int64_t)pace > n) {
+			mp->stat.st_trickle_paced += pace - (n > 0 ? n : 0);
+			n = (int)pace;
+		}
+	}
+
 	if (dirty == 0 || n <= 0)
 		goto done;
 
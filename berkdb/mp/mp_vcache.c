@@ -35,6 +35,23 @@ static int __mempv_cache_page_destroy(cache_page, arg)
 	return 0;
 }
 
+/*
+ * __mempv_cache_shard_of --
+ * Returns the shard that holds versions of the given page.  Consecutive pages
+ * of a file land in different shards.
+ */
+static MEMPV_CACHE_SHARD *__mempv_cache_shard_of(cache, key)
+	MEMPV_CACHE *cache;
+	MEMPV_CACHE_PAGE_KEY *key;
+{
+	u_int32_t h;
+	int i;
+
+	for (h = key->pgno * 2654435761U, i = 0; i < DB_FILE_ID_LEN; i++)
+		h = h * 31 + key->ufid[i];
+	return &cache->shards[(h ^ (h >> 16)) % MEMPV_CACHE_SHARDS];
+}
+
 /*
  * __mempv_cache_init --
  * Initializes a cache. 
@@ -51,20 +68,24 @@ int __mempv_cache_init(dbenv, cache)
 	DB_ENV *dbenv;
 	MEMPV_CACHE *cache;
 {
-	int ret;
+	MEMPV_CACHE_SHARD *shard;
+	int i, ret;
 
 	ret = 0;
 
-	cache->num_cached_pages = 0;
-	cache->pages = hash_init_o(offsetof(MEMPV_CACHE_PAGE_VERSIONS, key), sizeof(MEMPV_CACHE_PAGE_KEY)); 
-	if (cache->pages == NULL) {
-		ret = ENOMEM;
-		goto done;
-	}
+	memset(cache, 0, sizeof(*cache));
+	for (i = 0; i < MEMPV_CACHE_SHARDS; i++) {
+		shard = &cache->shards[i];
+		shard->pages = hash_init_o(offsetof(MEMPV_CACHE_PAGE_VERSIONS, key), sizeof(MEMPV_CACHE_PAGE_KEY)); 
+		if (shard->pages == NULL) {
+			ret = ENOMEM;
+			goto done;
+		}
 
-	listc_init(&cache->evict_list, offsetof(MEMPV_CACHE_PAGE_HEADER, evict_link)); 
+		listc_init(&shard->evict_list, offsetof(MEMPV_CACHE_PAGE_HEADER, evict_link)); 
 
-	pthread_mutex_init(&(cache->lock), NULL);
+		pthread_mutex_init(&(shard->lock), NULL);
+	}
 done:
 	return ret;
 }
@@ -82,35 +103,45 @@ done:
 void __mempv_cache_destroy(cache)
 	MEMPV_CACHE *cache;
 {
-	hash_for(cache->pages, (hashforfunc_t *const) __mempv_cache_page_destroy, NULL);
-	destroy_hash(cache->pages, free_it);
+	MEMPV_CACHE_SHARD *shard;
+	int i;
+
+	for (i = 0; i < MEMPV_CACHE_SHARDS; i++) {
+		shard = &cache->shards[i];
+		if (shard->pages == NULL)
+			continue;
+		hash_for(shard->pages, (hashforfunc_t *const) __mempv_cache_page_destroy, NULL);
+		destroy_hash(shard->pages, free_it);
 
-	pthread_mutex_destroy(&(cache->lock));
+		pthread_mutex_destroy(&(shard->lock));
+	}
 }
 
 /*
  * __mempv_cache_evict_page --
- * Evicts a page version from the cache and frees its resources.
+ * Evicts the least recently used page version from a cache shard and frees its resources.
  * If the evicted version is the only version of a page in the cache, then the list of versions 
  * associated with that page is freed UNLESS this list is passed in as `pinned_version_list`.
  *
  * dbp: Open db.
- * cache: Target cache.
+ * cache: Cache of the shard.
+ * shard: Target cache shard.
  * pinned_version_list: A list of versions that cannot be freed or NULL.
  *
  * Returns 0 on success and non-0 on failure.
  *
  * PUBLIC: static int __mempv_cache_evict_page
- * PUBLIC:	__P((DB *, MEMPV_CACHE *, MEMPV_CACHE_PAGE_VERSIONS *));
+ * PUBLIC:	__P((DB *, MEMPV_CACHE *, MEMPV_CACHE_SHARD *, MEMPV_CACHE_PAGE_VERSIONS *));
  */
-static int __mempv_cache_evict_page(dbp, cache, pinned_version_list)
+static int __mempv_cache_evict_page(dbp, cache, shard, pinned_version_list)
 	DB *dbp;
 	MEMPV_CACHE *cache;
+	MEMPV_CACHE_SHARD *shard;
 	MEMPV_CACHE_PAGE_VERSIONS *pinned_version_list;
 {
 	MEMPV_CACHE_PAGE_HEADER *to_evict;
 
-	to_evict = listc_rtl(&cache->evict_list);
+	to_evict = listc_rtl(&shard->evict_list);
 	if (to_evict == NULL) {
 		return 1;
 	}
@@ -121,21 +152,60 @@ static int __mempv_cache_evict_page(dbp, cache, pinned_version_list)
 		// If we emptied the list of versions for a page and we are not about to add a version for the page,
 		// then we can delete the list of versions.
 
-		hash_del(cache->pages, to_evict->cache);
+		hash_del(shard->pages, to_evict->cache);
 		hash_free(to_evict->cache->versions); 
 		__os_free(dbp->dbenv, to_evict->cache); 
 	}
 
+	shard->bytes -= to_evict->size;
 	__os_free(dbp->dbenv, to_evict); 
-	cache->num_cached_pages--;
+	shard->num_cached_pages--;
+	ATOMIC_ADD32(cache->num_cached_pages, -1);
+	shard->evictions++;
 	
 	return 0;
 }
 
+/*
+ * __mempv_cache_evict_other --
+ * Evicts the least recently used page version of another shard, for a shard
+ * with nothing left to evict while the cache is full.  The caller holds its
+ * own shard lock, so busy shards are skipped rather than waited for.
+ *
+ * Returns 0 if a version was evicted and non-0 otherwise.
+ */
+static int __mempv_cache_evict_other(dbp, cache, shard)
+	DB *dbp;
+	MEMPV_CACHE *cache;
+	MEMPV_CACHE_SHARD *shard;
+{
+	MEMPV_CACHE_SHARD *other;
+	int i, ret;
+
+	for (i = 1; i < MEMPV_CACHE_SHARDS; i++) {
+		other = &cache->shards[(shard - cache->shards + i) % MEMPV_CACHE_SHARDS];
+		if (other->num_cached_pages == 0 ||
+		    pthread_mutex_trylock(&(other->lock)) != 0)
+			continue;
+		ret = other->num_cached_pages > 0 ?
+		    __mempv_cache_evict_page(dbp, cache, other, NULL) : 1;
+		pthread_mutex_unlock(&(other->lock));
+		if (ret == 0)
+			return 0;
+	}
+	return 1;
+}
+
 /*
  * __mempv_cache_put --
  * Puts *a copy* of the page version given by `bhp` into the cache.
  *
+ * The mempv_max_cache_entries limit holds for the whole cache: a version
+ * takes a slot of the global count, and a full cache frees one by evicting
+ * the least recently used version of the page's shard, or of another shard
+ * when that one is empty.  Each shard gets an equal part of the
+ * mempv_cache_bytes budget.
+ *
  * dbp: Open db.
  * cache: Target cache.
  * file_id: File id associated with the page.
@@ -157,20 +227,33 @@ int __mempv_cache_put(dbp, cache, file_id, pgno, bhp, target_lsn)
 	BH *bhp;
 	DB_LSN target_lsn;
 {
+	MEMPV_CACHE_SHARD *shard;
 	MEMPV_CACHE_PAGE_VERSIONS *versions;
 	MEMPV_CACHE_PAGE_KEY key;
 	MEMPV_CACHE_PAGE_HEADER *page_header;
-	int ret, allocd_versions, allocd_header;
+	size_t size, max_bytes;
+	int ret, allocd_versions, allocd_header, reserved, max_entries;
 
 	versions = NULL;
 	page_header = NULL;
-	ret = allocd_versions = allocd_header = 0;
+	ret = allocd_versions = allocd_header = reserved = 0;
 	key.pgno = pgno;
 	memcpy(key.ufid, file_id, DB_FILE_ID_LEN);
 
-	pthread_mutex_lock(&(cache->lock));
+	size = sizeof(MEMPV_CACHE_PAGE_HEADER)-sizeof(u_int8_t) + SSZA(BH, buf) + dbp->pgsize;
+	max_bytes = (size_t)dbp->dbenv->attr.mempv_cache_bytes / MEMPV_CACHE_SHARDS;
+
+	max_entries = dbp->dbenv->attr.mempv_max_cache_entries;
+
+	shard = __mempv_cache_shard_of(cache, &key);
+	pthread_mutex_lock(&(shard->lock));
+
+	if (size > max_bytes || max_entries <= 0) {
+		// Caching is disabled, or this shard can't hold a single page.
+		goto done;
+	}
 
-	versions = hash_find(cache->pages, &key);
+	versions = hash_find(shard->pages, &key);
 	if (versions != NULL) {
 		// If we already have a list of versions for this page, we can just add this version to that list.
 		goto put_version;
@@ -193,7 +276,7 @@ int __mempv_cache_put(dbp, cache, file_id, pgno, bhp, target_lsn)
 		goto err;
 	}
 
-	ret = hash_add(cache->pages, versions);
+	ret = hash_add(shard->pages, versions);
 	if (ret) {
 		goto err;
 	}
@@ -205,16 +288,30 @@ put_version:
 		goto done;
 	}
 
-	// We need to allocate space for the new page version.
+	// We need to make room for the new page version: a slot under the
+	// global entry limit, and bytes in this shard.
 
-	if(cache->num_cached_pages == dbp->dbenv->attr.mempv_max_cache_entries) {
-		if ((ret = __mempv_cache_evict_page(dbp, cache, versions)), ret != 0) {
+	while (ATOMIC_ADD32(cache->num_cached_pages, 1) > max_entries) {
+		ATOMIC_ADD32(cache->num_cached_pages, -1);
+		if (shard->num_cached_pages == 0) {
+			// Nothing we can evict; don't cache this one.
+			if (__mempv_cache_evict_other(dbp, cache, shard) != 0)
+				goto err;
+		} else if ((ret = __mempv_cache_evict_page(dbp, cache, shard, versions)), ret != 0) {
 			logmsg(LOGMSG_ERROR, "%s: Could not evict cache page\n", __func__);
 			goto err;
 		}
 	}
+	reserved = 1;
 
-	__os_malloc(dbp->dbenv, sizeof(MEMPV_CACHE_PAGE_HEADER)-sizeof(u_int8_t) + SSZA(BH, buf) + dbp->pgsize, &page_header); 
+	while (shard->num_cached_pages > 0 && shard->bytes + size > max_bytes) {
+		if ((ret = __mempv_cache_evict_page(dbp, cache, shard, versions)), ret != 0) {
+			logmsg(LOGMSG_ERROR, "%s: Could not evict cache page\n", __func__);
+			goto err;
+		}
+	}
+
+	__os_malloc(dbp->dbenv, size, &page_header); 
 	if (page_header == NULL) {
 		ret = ENOMEM;
 		goto err;
@@ -224,8 +321,9 @@ put_version:
 	memcpy((char*)(page_header->page), bhp, offsetof(BH, buf) + dbp->pgsize);
 
 	page_header->snapshot_lsn = target_lsn;
+	page_header->size = size;
 	page_header->cache = versions;
-	listc_abl(&cache->evict_list, page_header);
+	listc_abl(&shard->evict_list, page_header);
 
 	ret = hash_add(versions->versions, page_header);
 	if (ret) {
@@ -233,16 +331,17 @@ put_version:
 		goto err;
 	}
 
-	cache->num_cached_pages++;
+	shard->num_cached_pages++;
+	shard->bytes += size;
 
 done:
-	pthread_mutex_unlock(&(cache->lock));
+	pthread_mutex_unlock(&(shard->lock));
 	return ret;
 	
 err:
 	if (allocd_versions) {
-		if (hash_find(cache->pages, &key)) {
-			hash_del(cache->pages, versions);
+		if (hash_find(shard->pages, &key)) {
+			hash_del(shard->pages, versions);
 		}
 		if (versions->versions != NULL) {
 			hash_free(versions->versions); 
@@ -254,11 +353,15 @@ err:
 		if (!allocd_versions && hash_find(versions->versions, page_header)) {
 			hash_del(versions->versions, page_header);	
 		}
-		listc_maybe_rfl(&cache->evict_list, page_header);
+		listc_maybe_rfl(&shard->evict_list, page_header);
 		__os_free(dbp->dbenv, page_header);
 	}
 
-	pthread_mutex_unlock(&(cache->lock));
+	if (reserved) {
+		ATOMIC_ADD32(cache->num_cached_pages, -1);
+	}
+
+	pthread_mutex_unlock(&(shard->lock));
 	return ret;
 }
 
@@ -286,6 +389,7 @@ int __mempv_cache_get(dbp, cache, file_id, pgno, target_lsn, bhp)
 	DB_LSN target_lsn;
 	BH *bhp;
 {
+	MEMPV_CACHE_SHARD *shard;
 	MEMPV_CACHE_PAGE_VERSIONS *versions;
 	MEMPV_CACHE_PAGE_KEY key;
 	MEMPV_CACHE_PAGE_HEADER *page_header;
@@ -297,9 +401,10 @@ int __mempv_cache_get(dbp, cache, file_id, pgno, target_lsn, bhp)
 	key.pgno = pgno;
 	memcpy(key.ufid, file_id, DB_FILE_ID_LEN);
 
-	pthread_mutex_lock(&(cache->lock));
+	shard = __mempv_cache_shard_of(cache, &key);
+	pthread_mutex_lock(&(shard->lock));
 
-	versions = hash_find(cache->pages, &key);
+	versions = hash_find(shard->pages, &key);
 	if (versions == NULL) {
 		ret = DB_NOTFOUND; 
 		goto done;
@@ -313,17 +418,83 @@ int __mempv_cache_get(dbp, cache, file_id, pgno, target_lsn, bhp)
 
 	// Found the page in the cache. Update lru and copy it out.
 
-	listc_rfl(&cache->evict_list, page_header);
-	listc_abl(&cache->evict_list, page_header);
+	listc_rfl(&shard->evict_list, page_header);
+	listc_abl(&shard->evict_list, page_header);
 
 	memcpy(bhp, (char*)(page_header->page), offsetof(BH, buf) + dbp->pgsize);
 
 done:
-	pthread_mutex_unlock(&(cache->lock));
+	if (ret == 0)
+		shard->hits++;
+	else
+		shard->misses++;
+	pthread_mutex_unlock(&(shard->lock));
 
 	return ret;
 }
 
+/*
+ * __mempv_cache_rebuilt --
+ * Counts a page version rebuilt from the log, whether or not it could be
+ * cached or the rebuild finished.
+ *
+ * PUBLIC: void __mempv_cache_rebuilt
+ * PUBLIC:	__P((MEMPV_CACHE *, u_int8_t[DB_FILE_ID_LEN], db_pgno_t, u_int32_t));
+ */
+void __mempv_cache_rebuilt(cache, file_id, pgno, nundo)
+	MEMPV_CACHE *cache;
+	u_int8_t file_id[DB_FILE_ID_LEN];
+	db_pgno_t pgno;
+	u_int32_t nundo;
+{
+	MEMPV_CACHE_SHARD *shard;
+	MEMPV_CACHE_PAGE_KEY key;
+
+	key.pgno = pgno;
+	memcpy(key.ufid, file_id, DB_FILE_ID_LEN);
+	shard = __mempv_cache_shard_of(cache, &key);
+
+	pthread_mutex_lock(&(shard->lock));
+	shard->rebuilds++;
+	shard->undo_records += nundo;
+	if (shard->max_undo_chain < nundo)
+		shard->max_undo_chain = nundo;
+	pthread_mutex_unlock(&(shard->lock));
+}
+
+/*
+ * __mempv_cache_stat --
+ * Sums the statistics of all cache shards.
+ *
+ * PUBLIC: void __mempv_cache_stat
+ * PUBLIC:	__P((DB_ENV *, MEMPV_CACHE *, DB_MEMPV_STAT *));
+ */
+void __mempv_cache_stat(dbenv, cache, sp)
+	DB_ENV *dbenv;
+	MEMPV_CACHE *cache;
+	DB_MEMPV_STAT *sp;
+{
+	MEMPV_CACHE_SHARD *shard;
+	int i;
+
+	memset(sp, 0, sizeof(*sp));
+	sp->st_max_bytes = dbenv->attr.mempv_cache_bytes;
+	for (i = 0; i < MEMPV_CACHE_SHARDS; i++) {
+		shard = &cache->shards[i];
+		pthread_mutex_lock(&(shard->lock));
+		sp->st_entries += shard->num_cached_pages;
+		sp->st_bytes += shard->bytes;
+		sp->st_hits += shard->hits;
+		sp->st_misses += shard->misses;
+		sp->st_evictions += shard->evictions;
+		sp->st_rebuilds += shard->rebuilds;
+		sp->st_undo_records += shard->undo_records;
+		if (sp->st_max_undo_chain < shard->max_undo_chain)
+			sp->st_max_undo_chain = shard->max_undo_chain;
+		pthread_mutex_unlock(&(shard->lock));
+	}
+}
+
 static int __mempv_cache_page_version_dump(cache_page_version, arg)
 	MEMPV_CACHE_PAGE_HEADER *cache_page_version;
 	void *arg;
@@ -345,8 +516,11 @@ static int __mempv_cache_page_dump(cache_page, arg)
 void __mempv_cache_dump(cache)
 	MEMPV_CACHE *cache;
 {
+	int i;
+
 	printf("DUMPING PAGE CACHE\n--------------------\n");
-	hash_for(cache->pages, (hashforfunc_t *const) __mempv_cache_page_dump, NULL);
+	for (i = 0; i < MEMPV_CACHE_SHARDS; i++)
+		hash_for(cache->shards[i].pages, (hashforfunc_t *const) __mempv_cache_page_dump, NULL);
 	printf("--------------------\nFINISHED DUMPING PAGE CACHE\n");
 }
 
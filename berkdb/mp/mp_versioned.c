@@ -28,6 +28,8 @@ extern int __txn_commit_map_get(DB_ENV *, u_int64_t, DB_LSN *);
 extern int __mempv_cache_init(DB_ENV *, MEMPV_CACHE *cache);
 extern int __mempv_cache_get(DB *dbp, MEMPV_CACHE *cache, u_int8_t file_id[DB_FILE_ID_LEN], db_pgno_t pgno, DB_LSN target_lsn, BH *bhp);
 extern int __mempv_cache_put(DB *dbp, MEMPV_CACHE *cache, u_int8_t file_id[DB_FILE_ID_LEN], db_pgno_t pgno, BH *bhp, DB_LSN target_lsn);
+extern void __mempv_cache_rebuilt(MEMPV_CACHE *cache, u_int8_t file_id[DB_FILE_ID_LEN], db_pgno_t pgno, u_int32_t nundo);
+extern void __mempv_cache_stat(DB_ENV *dbenv, MEMPV_CACHE *cache, DB_MEMPV_STAT *sp);
 
 typedef int (*recovery_func_t)(DB_ENV*, DBT*, DB_LSN*, db_recops, PAGE *);
 
@@ -62,6 +64,25 @@ done:
 	return ret;
 }
 
+/*
+ * __mempv_stat_pp --
+ *	DB_ENV->mempv_stat.
+ *
+ * PUBLIC: int __mempv_stat_pp
+ * PUBLIC:	   __P((DB_ENV *, DB_MEMPV_STAT *));
+ */
+int __mempv_stat_pp(dbenv, sp)
+	DB_ENV *dbenv;
+	DB_MEMPV_STAT *sp;
+{
+	if (dbenv->mempv == NULL) {
+		memset(sp, 0, sizeof(*sp));
+		return (0);
+	}
+	__mempv_cache_stat(dbenv, &dbenv->mempv->cache, sp);
+	return (0);
+}
+
 /*
  * __mempv_destroy --
  *	Destroy versioned memory pool.
@@ -184,6 +205,7 @@ int __mempv_fget(mpf, dbp, pgno, target_lsn, highest_checkpoint_lsn, ret_page, f
 {
 	recovery_func_t apply;
 	int add_to_cache, found, ret, mempv_debug;
+	u_int32_t nundo;
 	u_int64_t utxnid;
 	int64_t smallest_logfile;
 	DB_LOGC *logc;
@@ -194,6 +216,7 @@ int __mempv_fget(mpf, dbp, pgno, target_lsn, highest_checkpoint_lsn, ret_page, f
 	void *data_t;
 
 	ret = found = add_to_cache = 0;
+	nundo = 0;
 	logc = NULL;
 	page = page_image = NULL;
 	bhp = NULL;
@@ -334,6 +357,7 @@ int __mempv_fget(mpf, dbp, pgno, target_lsn, highest_checkpoint_lsn, ret_page, f
 			goto err;
 		}
 
+		nundo++;
 		current_lsn = LSN(page_image);
 	}
 
@@ -345,6 +369,8 @@ found_page:
 	}
 err:
 	if (logc) {
+		/* We had to rebuild this version from the log. */
+		__mempv_cache_rebuilt(&dbenv->mempv->cache, mpf->fileid, pgno, nundo);
 		__log_c_close(logc);
 	}
 	if (dbt.data) {
@@ -50,6 +50,10 @@
 
 #include "str_util.h" /* QUOTE */
 
+#ifdef CDB2API_LZ4
+#include <lz4.h>
+#endif
+
 #ifndef API_DRIVER_NAME
 #define API_DRIVER_NAME open_cdb2api
 #endif
@@ -172,6 +176,9 @@ static int cdb2_protobuf_heuristic = 0;
 static int cdb2_protobuf_heuristic = 1;
 #endif
 static int cdb2_protobuf_heuristic_set_from_env = 0;
+/* lets the server send large result sets many rows per response */
+static int cdb2_row_batch = 1;
+static int cdb2_row_batch_set_from_env = 0;
 static int cdb2_non_threaded_identity = 1;
 static int cdb2_non_threaded_identity_from_env = 0;
 
@@ -923,6 +930,33 @@ static int is_sql_read(const char *sqlstr)
     return 0;
 }
 
+/* Skip whitespace and sql comments */
+static const char *cdb2_skip_ws_comments(const char *sql)
+{
+    while (1) {
+        cdb2_skipws(sql);
+        if (sql[0] == '-' && sql[1] == '-') {
+            while (*sql && *sql != '\n')
+                ++sql;
+        } else if (sql[0] == '/' && sql[1] == '*') {
+            const char *end = strstr(sql + 2, "*/");
+            sql = end ? end + 2 : sql + strlen(sql);
+        } else {
+            return sql;
+        }
+    }
+}
+
+/* returns 1 if the first word of sqlstr, past comments, is keyword */
+static int is_sql_keyword(const char *sqlstr, const char *keyword)
+{
+    size_t len = strlen(keyword);
+    sqlstr = cdb2_skip_ws_comments(sqlstr);
+    if (strncasecmp(sqlstr, keyword, len) != 0)
+        return 0;
+    return !isalnum((unsigned char)sqlstr[len]) && sqlstr[len] != '_';
+}
+
 /* PASSFD CODE */
 #if defined(_LINUX_SOURCE)
 #define HAVE_MSGHDR_MSG_CONTROL
@@ -1713,6 +1747,7 @@ static void read_comdb2db_environment_cfg(cdb2_hndl_tp *hndl, const char *comdb2
                                    &cdb2_protobuf_heuristic_set_from_env);
         process_env_var_str_on_off("COMDB2_FEATURE_FLAT_COL_VALS", &cdb2_flat_col_vals,
                                    &cdb2_flat_col_vals_set_from_env);
+        process_env_var_str_on_off("COMDB2_FEATURE_ROW_BATCH", &cdb2_row_batch, &cdb2_row_batch_set_from_env);
         process_env_var_str_on_off("COMDB2_FEATURE_USE_BMSD", &cdb2_use_bmsd, &cdb2_use_bmsd_set_from_env);
         process_env_var_str_on_off("COMDB2_FEATURE_COMDB2DB_FALLBACK", &cdb2_comdb2db_fallback,
                                    &cdb2_comdb2db_fallback_set_from_env);
@@ -1977,6 +2012,9 @@ static void read_comdb2db_cfg(cdb2_hndl_tp *hndl, COMDB2BUF *s, const char *comd
             } else if (!cdb2_protobuf_heuristic_set_from_env && strcasecmp("protobuf_heuristic", tok) == 0) {
                 if ((tok = strtok_r(NULL, " =:,", &last)) != NULL)
                     cdb2_protobuf_heuristic = value_on_off(tok, &err);
+            } else if (!cdb2_row_batch_set_from_env && strcasecmp("row_batch", tok) == 0) {
+                if ((tok = strtok_r(NULL, " =:,", &last)) != NULL)
+                    cdb2_row_batch = value_on_off(tok, &err);
             }
         } else if (strcasecmp("comdb2_config", tok) == 0) {
             tok = strtok_r(NULL, " =:,", &last);
@@ -3905,7 +3943,7 @@ static int newsql_disconnect(cdb2_hndl_tp *hndl, COMDB2BUF *sb, int line)
     int fd_condition = 0;
 #endif
     int timeoutms = 10 * 1000;
-    if (hndl->is_admin || hndl->is_rejected ||
+    if (hndl->is_admin || hndl->is_rejected || hndl->pipeline_pending ||
         (!hndl->firstresponse && (hndl->sent_client_info || !donate_unused_connections)) || hndl->in_trans ||
         hndl->pid != _PID ||
         (hndl->firstresponse &&
@@ -4376,13 +4414,23 @@ static int cdb2_convert_error_code(int rc)
     }
 }
 
+static void free_last_response(cdb2_hndl_tp *hndl)
+{
+    if (hndl->lastresponse == &hndl->batch_row) {
+        hndl->lastresponse = hndl->batchresponse;
+        hndl->batchresponse = NULL;
+        hndl->batch_rows_left = 0;
+    }
+    cdb2__sqlresponse__free_unpacked(hndl->lastresponse, hndl->allocator);
+    if (hndl->protobuf_size)
+        hndl->protobuf_offset = 0;
+}
+
 static void clear_responses(cdb2_hndl_tp *hndl)
 {
     free_raw_response(hndl);
     if (hndl->lastresponse) {
-        cdb2__sqlresponse__free_unpacked(hndl->lastresponse, hndl->allocator);
-        if (hndl->protobuf_size)
-            hndl->protobuf_offset = 0;
+        free_last_response(hndl);
         hndl->lastresponse = NULL;
         free((void *)hndl->last_buf);
         hndl->last_buf = NULL;
@@ -4748,6 +4796,13 @@ static int cdb2_send_query(cdb2_hndl_tp *hndl, cdb2_hndl_tp *event_hndl, COMDB2B
            a nested data structure. This helps reduce server's memory footprint. */
         if (cdb2_flat_col_vals)
             features[n_features++] = CDB2_CLIENT_FEATURES__FLAT_COL_VALS;
+        /* Let the server pack the rows of large result sets into batches. */
+        if (cdb2_row_batch && (hndl->flags & CDB2_REQUIRE_FASTSQL) == 0) {
+            features[n_features++] = CDB2_CLIENT_FEATURES__ROW_BATCH;
+#ifdef CDB2API_LZ4
+            features[n_features++] = CDB2_CLIENT_FEATURES__ROW_BATCH_LZ4;
+#endif
+        }
 
         if ((hndl->flags & (CDB2_DIRECT_CPU | CDB2_MASTER)) ||
             (retries_done >= (hndl->num_hosts * 2 - 1) && hndl->master == hndl->connected_host)) {
@@ -4839,7 +4894,12 @@ static int cdb2_send_query(cdb2_hndl_tp *hndl, cdb2_hndl_tp *event_hndl, COMDB2B
     // Always enable for chunk transactions
     int check_hb_on_blocked_write_final = (check_hb_on_blocked_write || (hndl && hndl->is_chunk != CHUNK_NO));
     int timeout_error = 0;
-    rc = cdb2buf_flush_chk_timeout(sb, &timeout_error);
+    if (hndl && hndl->pipeline_unflushed) {
+        /* cdb2_pipeline_add: leave it buffered, cdb2_pipeline_next flushes */
+        rc = 0;
+    } else {
+        rc = cdb2buf_flush_chk_timeout(sb, &timeout_error);
+    }
 
     // Failed writing to server due to a timeout
     if (check_hb_on_blocked_write_final && timeout_error && !is_begin && hndl && !hndl->is_read && hndl->in_trans &&
@@ -4930,6 +4990,120 @@ static int retry_queries_and_skip(cdb2_hndl_tp *hndl, int num_retry,
         return (rcode);                                                                                                \
     } while (0)
 
+/* Decode the next row of a ROW_BATCH response into batch_row. Values are
+   copied to 8-byte boundaries, as they would be if unpacked by protobuf. */
+static int cdb2_next_batch_row(cdb2_hndl_tp *hndl)
+{
+    const uint8_t *p = hndl->batch_pos;
+    const uint8_t *end = hndl->batch_end;
+    ProtobufCBinaryData *values = hndl->batch_values;
+    size_t rowlen = 0;
+
+    for (int i = 0; i < hndl->batch_ncols; ++i) {
+        uint64_t v = 0;
+        int shift = 0;
+        do {
+            if (p >= end || shift > 28)
+                return -1;
+            v |= (uint64_t)(*p & 0x7f) << shift;
+            shift += 7;
+        } while (*p++ & 0x80);
+        hndl->batch_isnulls[i] = (v == 0);
+        if (v == 0) {
+            values[i].data = NULL;
+            values[i].len = 0;
+            continue;
+        }
+        if (--v > (uint64_t)(end - p))
+            return -1;
+        values[i].data = (uint8_t *)p;
+        values[i].len = v;
+        rowlen += (v + 7) & ~7;
+        p += v;
+    }
+
+    if (rowlen > hndl->batch_row_buf_len) {
+        uint8_t *buf = realloc(hndl->batch_row_buf, rowlen);
+        if (buf == NULL)
+            return -1;
+        hndl->batch_row_buf = buf;
+        hndl->batch_row_buf_len = rowlen;
+    }
+    uint8_t *out = hndl->batch_row_buf;
+    for (int i = 0; i < hndl->batch_ncols; ++i) {
+        if (values[i].data == NULL)
+            continue;
+        memcpy(out, values[i].data, values[i].len);
+        values[i].data = out;
+        out += (values[i].len + 7) & ~7;
+    }
+
+    hndl->batch_pos = p;
+    hndl->batch_rows_left--;
+    hndl->rows_read++;
+    return 0;
+}
+
+/* Start reading the ROW_BATCH response in lastresponse */
+static int cdb2_start_row_batch(cdb2_hndl_tp *hndl)
+{
+    CDB2SQLRESPONSE *r = hndl->lastresponse;
+    int ncols = hndl->firstresponse ? hndl->firstresponse->n_value : 0;
+    if (!r->has_row_batch || !r->has_row_batch_count || r->row_batch_count <= 0 || ncols <= 0)
+        return -1;
+
+    const uint8_t *data = r->row_batch.data;
+    size_t len = r->row_batch.len;
+    if (r->has_row_batch_len) {
+#ifdef CDB2API_LZ4
+        if (r->row_batch_len <= 0)
+            return -1;
+        if (r->row_batch_len > hndl->batch_buf_len) {
+            uint8_t *buf = realloc(hndl->batch_buf, r->row_batch_len);
+            if (buf == NULL)
+                return -1;
+            hndl->batch_buf = buf;
+            hndl->batch_buf_len = r->row_batch_len;
+        }
+        if (LZ4_decompress_safe((const char *)data, (char *)hndl->batch_buf, len, r->row_batch_len) !=
+            r->row_batch_len)
+            return -1;
+        data = hndl->batch_buf;
+        len = r->row_batch_len;
+#else
+        return -1;
+#endif
+    }
+
+    if (ncols > hndl->batch_ncols) {
+        ProtobufCBinaryData *values = realloc(hndl->batch_values, sizeof(*values) * ncols);
+        if (values == NULL)
+            return -1;
+        hndl->batch_values = values;
+        protobuf_c_boolean *isnulls = realloc(hndl->batch_isnulls, sizeof(*isnulls) * ncols);
+        if (isnulls == NULL)
+            return -1;
+        hndl->batch_isnulls = isnulls;
+    }
+    hndl->batch_ncols = ncols;
+
+    CDB2SQLRESPONSE *row = &hndl->batch_row;
+    cdb2__sqlresponse__init(row);
+    row->response_type = RESPONSE_TYPE__COLUMN_VALUES;
+    row->has_flat_col_vals = 1;
+    row->flat_col_vals = 1;
+    row->n_values = row->n_isnulls = ncols;
+    row->values = hndl->batch_values;
+    row->isnulls = hndl->batch_isnulls;
+
+    hndl->batch_pos = data;
+    hndl->batch_end = data + len;
+    hndl->batch_rows_left = r->row_batch_count;
+    hndl->batchresponse = r;
+    hndl->lastresponse = row;
+    return 0;
+}
+
 static int cdb2_next_record_int(cdb2_hndl_tp *hndl, int shouldretry)
 {
     int len;
@@ -4946,6 +5120,14 @@ retry_next_record:
     if (hndl->firstresponse && hndl->firstresponse->error_code)
         PRINT_AND_RETURN_OK(hndl->firstresponse->error_code);
 
+    if (hndl->batch_rows_left > 0) {
+        if (cdb2_next_batch_row(hndl) == 0)
+            PRINT_AND_RETURN_OK(CDB2_OK);
+        newsql_disconnect(hndl, hndl->sb, __LINE__);
+        sprintf(hndl->errstr, "%s: Malformed row batch from server", __func__);
+        PRINT_AND_RETURN_OK(-1);
+    }
+
     if (hndl->lastresponse) {
         if (hndl->lastresponse->response_type == RESPONSE_TYPE__LAST_ROW) {
             PRINT_AND_RETURN_OK(CDB2_OK_DONE);
@@ -5010,11 +5192,8 @@ retry_next_record:
     }
 
     /* free previous response */
-    if (hndl->lastresponse) {
-        cdb2__sqlresponse__free_unpacked(hndl->lastresponse, hndl->allocator);
-        if (hndl->protobuf_size)
-            hndl->protobuf_offset = 0;
-    }
+    if (hndl->lastresponse)
+        free_last_response(hndl);
 
     hndl->lastresponse = cdb2__sqlresponse__unpack(hndl->allocator, len, hndl->last_buf);
     debugprint("hndl->lastresponse->response_type=%d\n",
@@ -5033,6 +5212,14 @@ retry_next_record:
         hndl->snapshot_offset = hndl->lastresponse->snapshot_info->offset;
     }
 
+    if (hndl->lastresponse->response_type == RESPONSE_TYPE__ROW_BATCH) {
+        if (cdb2_start_row_batch(hndl) == 0 && cdb2_next_batch_row(hndl) == 0)
+            PRINT_AND_RETURN_OK(CDB2_OK);
+        newsql_disconnect(hndl, hndl->sb, __LINE__);
+        sprintf(hndl->errstr, "%s: Malformed row batch from server", __func__);
+        PRINT_AND_RETURN_OK(-1);
+    }
+
     if (hndl->lastresponse->response_type == RESPONSE_TYPE__COLUMN_VALUES ||
         hndl->lastresponse->response_type == RESPONSE_TYPE__SQL_ROW) {
         // "Good" rcodes are not retryable
@@ -5271,9 +5458,7 @@ int cdb2_close(cdb2_hndl_tp *hndl)
     }
 
     if (hndl->lastresponse) {
-        cdb2__sqlresponse__free_unpacked(hndl->lastresponse, hndl->allocator);
-        if (hndl->protobuf_size)
-            hndl->protobuf_offset = 0;
+        free_last_response(hndl);
         hndl->lastresponse = NULL;
         free((void *)hndl->last_buf);
         hndl->last_buf = NULL;
@@ -5282,6 +5467,12 @@ int cdb2_close(cdb2_hndl_tp *hndl)
     if (hndl->protobuf_data)
         free(hndl->protobuf_data);
 
+    free(hndl->batch_values);
+    free(hndl->batch_isnulls);
+    free(hndl->batch_buf);
+    free(hndl->batch_row_buf);
+    free(hndl->pipeline_is_read);
+
     if (hndl->num_set_commands && hndl->is_child_hndl) {
         // don't free memory for this, parent handle will free
         hndl->num_set_commands = 0;
@@ -6106,6 +6297,11 @@ static int cdb2_run_statement_typed_int(cdb2_hndl_tp *hndl, const char *sql, int
         PRINT_AND_RETURN(CDB2ERR_BADSTATE);
     }
 
+    if (hndl->pipeline_pending) {
+        sprintf(hndl->errstr, "%s: %d pipelined statement(s) not read", __func__, hndl->pipeline_pending);
+        PRINT_AND_RETURN(CDB2ERR_BADSTATE);
+    }
+
     if (hndl->pid != _PID) {
         pid_t oldpid = hndl->pid;
         newsql_disconnect(hndl, hndl->sb, __LINE__);
@@ -6918,6 +7114,181 @@ after_callback:
     return rc;
 }
 
+/* A pipelined statement could not be sent or its result could not be read.
+   Nothing is retried: drop the connection along with every response still
+   owed to us, and fail the transaction if there is one. */
+static int cdb2_pipeline_fail(cdb2_hndl_tp *hndl, int rc)
+{
+    hndl->pipeline_pending = 0;
+    hndl->pipeline_head = 0;
+    hndl->pipeline_unflushed = 0;
+    if (hndl->sb)
+        cdb2buf_close(hndl->sb); /* never donate it, responses may be in flight */
+    hndl->sb = NULL;
+    clear_responses(hndl);
+    if (hndl->in_trans) {
+        /* the transaction can't be replayed on another connection either:
+           it is only good for a rollback now */
+        hndl->error_in_trans = rc;
+        hndl->client_side_error = 1;
+        free_query_list_on_handle(hndl);
+        hndl->query_no = 0;
+    }
+    return rc;
+}
+
+/* Send sql, with the currently bound parameters, without waiting for the
+   results of statements sent before it. Statements are buffered until the
+   next cdb2_pipeline_next(), which sends all of them in one write. */
+int cdb2_pipeline_add(cdb2_hndl_tp *hndl, const char *sql)
+{
+    int rc;
+
+    if (hndl->fdb_hndl || hndl->is_hasql || hndl->is_tagged || hndl->pid != _PID) {
+        sprintf(hndl->errstr, "%s: pipelining is not supported on this handle", __func__);
+        PRINT_AND_RETURN(CDB2ERR_NOTSUPPORTED);
+    }
+    if (is_sql_keyword(sql, "set") || is_sql_keyword(sql, "begin") || is_sql_keyword(sql, "commit") ||
+        is_sql_keyword(sql, "rollback")) {
+        sprintf(hndl->errstr, "%s: '%.8s' can't be pipelined, use cdb2_run_statement", __func__,
+                cdb2_skip_ws_comments(sql));
+        PRINT_AND_RETURN(CDB2ERR_NOTSUPPORTED);
+    }
+    if (hndl->client_side_error == 1 && hndl->in_trans)
+        return hndl->error_in_trans;
+
+    if (hndl->pipeline_pending == 0) {
+        consume_previous_query(hndl);
+        clear_responses(hndl);
+        hndl->pipeline_head = 0;
+    }
+
+    if (hndl->pipeline_head + hndl->pipeline_pending == hndl->pipeline_cap) {
+        int cap = hndl->pipeline_cap ? hndl->pipeline_cap * 2 : 16;
+        uint8_t *is_read = realloc(hndl->pipeline_is_read, cap);
+        if (is_read == NULL) {
+            sprintf(hndl->errstr, "%s: out of memory", __func__);
+            PRINT_AND_RETURN(CDB2ERR_MALLOC);
+        }
+        hndl->pipeline_is_read = is_read;
+        hndl->pipeline_cap = cap;
+    }
+
+    if (!hndl->sb) {
+        if (hndl->num_hosts == 0 && hndl->got_dbinfo == 0) {
+            hndl->got_dbinfo = 1;
+            cdb2_get_dbhosts(hndl);
+        }
+        cdb2_connect_sqlhost(hndl);
+        if (!hndl->sb) {
+            sprintf(hndl->errstr, "%s: Cannot connect to db", __func__);
+            PRINT_AND_RETURN(CDB2ERR_CONNECT_ERROR);
+        }
+    }
+
+    int is_read = is_sql_read(sql);
+    int saved_is_read = hndl->is_read;
+    hndl->is_read = is_read;
+    if (!hndl->in_trans) { /* each pipelined statement is its own transaction */
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        hndl->timestampus = ((uint64_t)tv.tv_sec) * 1000000 + tv.tv_usec;
+        make_random_str(hndl->cnonce, sizeof(hndl->cnonce), &hndl->cnonce_len);
+    }
+
+    /* in a transaction, record it for replay like cdb2_run_statement does */
+    int do_append = hndl->in_trans ? 1 : 0;
+    hndl->query_no += do_append;
+    hndl->pipeline_unflushed = 1;
+    rc = cdb2_send_query(hndl, hndl, hndl->sb, hndl->dbname, sql, hndl->in_trans ? 0 : hndl->num_set_commands,
+                         hndl->in_trans ? 0 : hndl->num_set_commands_sent, hndl->commands, hndl->n_bindvars,
+                         hndl->bindvars, 0, NULL, 0, 0, 0, do_append, __LINE__);
+    hndl->is_read = saved_is_read;
+    if (rc) {
+        hndl->query_no -= do_append;
+        sprintf(hndl->errstr, "%s: Can't send query to the db", __func__);
+        PRINT_AND_RETURN(cdb2_pipeline_fail(hndl, CDB2ERR_TRAN_IO_ERROR));
+    }
+    /* the set commands went out with this statement */
+    hndl->num_set_commands_sent = hndl->num_set_commands;
+
+    hndl->pipeline_is_read[hndl->pipeline_head + hndl->pipeline_pending] = is_read;
+    hndl->pipeline_pending++;
+    return 0;
+}
+
+/* Make the result of the oldest pipelined statement the current one; read
+   its rows with cdb2_next_record. Returns that statement's rc. */
+int cdb2_pipeline_next(cdb2_hndl_tp *hndl)
+{
+    int rc, len, type = 0;
+
+    if (hndl->pipeline_pending == 0) {
+        sprintf(hndl->errstr, "%s: no pipelined statements", __func__);
+        PRINT_AND_RETURN(CDB2ERR_BADSTATE);
+    }
+
+    if (hndl->pipeline_unflushed) {
+        hndl->pipeline_unflushed = 0;
+        if (cdb2buf_flush(hndl->sb) < 0) {
+            sprintf(hndl->errstr, "%s: Can't send query to the db", __func__);
+            PRINT_AND_RETURN(cdb2_pipeline_fail(hndl, CDB2ERR_TRAN_IO_ERROR));
+        }
+    }
+
+    /* finish the previous statement, then take the next one off the queue */
+    consume_previous_query(hndl);
+    clear_responses(hndl);
+    if (hndl->sb == NULL) {
+        sprintf(hndl->errstr, "%s: Lost connection to the db", __func__);
+        PRINT_AND_RETURN(cdb2_pipeline_fail(hndl, CDB2ERR_TRAN_IO_ERROR));
+    }
+    int is_read = hndl->pipeline_is_read[hndl->pipeline_head++];
+    hndl->pipeline_pending--;
+    hndl->rows_read = 0;
+    hndl->first_record_read = 0;
+
+    /* server sends nothing back for these */
+    if (hndl->in_trans && !hndl->read_intrans_results && !is_read)
+        return 0;
+
+    rc = cdb2_read_record(hndl, &hndl->first_buf, &len, &type);
+    if (rc || hndl->first_buf == NULL) {
+        sprintf(hndl->errstr, "%s: Timeout while reading response from server", __func__);
+        PRINT_AND_RETURN(cdb2_pipeline_fail(hndl, CDB2ERR_TRAN_IO_ERROR));
+    }
+    if (type != RESPONSE_HEADER__SQL_RESPONSE) {
+        sprintf(hndl->errstr, "%s: Unexpected response type %d", __func__, type);
+        PRINT_AND_RETURN(cdb2_pipeline_fail(hndl, CDB2ERR_TRAN_IO_ERROR));
+    }
+    hndl->firstresponse = cdb2__sqlresponse__unpack(NULL, len, hndl->first_buf);
+    if (!hndl->firstresponse) {
+        sprintf(hndl->errstr, "%s: Can't read response from the db", __func__);
+        PRINT_AND_RETURN(cdb2_pipeline_fail(hndl, CDB2ERR_CORRUPT_RESPONSE));
+    }
+    if (hndl->firstresponse->response_type != RESPONSE_TYPE__COLUMN_NAMES || hndl->firstresponse->foreign_db) {
+        sprintf(hndl->errstr, "%s: Unexpected response type %d", __func__, hndl->firstresponse->response_type);
+        PRINT_AND_RETURN(cdb2_pipeline_fail(hndl, -1));
+    }
+    if (hndl->firstresponse->error_code) {
+        rc = cdb2_convert_error_code(hndl->firstresponse->error_code);
+        if (hndl->in_trans) /* Give the same error for every query until commit/rollback */
+            hndl->error_in_trans = rc;
+        PRINT_AND_RETURN(rc);
+    }
+
+    pb_alloc_heuristic(hndl);
+    rc = cdb2_next_record_int(hndl, 0);
+    if (rc == CDB2_OK || rc == CDB2_OK_DONE)
+        PRINT_AND_RETURN(0);
+    PRINT_AND_RETURN(cdb2_convert_error_code(rc));
+}
+
+int cdb2_pipeline_pending(cdb2_hndl_tp *hndl)
+{
+    return hndl->pipeline_pending;
+}
+
 int cdb2_numcolumns(cdb2_hndl_tp *hndl)
 {
     int rc;
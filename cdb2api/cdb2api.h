@@ -232,6 +232,10 @@ int cdb2_close(cdb2_hndl_tp *hndl);
 int cdb2_run_statement(cdb2_hndl_tp *hndl, const char *sql);
 int cdb2_run_statement_typed(cdb2_hndl_tp *hndl, const char *sql, int ntypes, const int *types);
 
+int cdb2_pipeline_add(cdb2_hndl_tp *hndl, const char *sql);
+int cdb2_pipeline_next(cdb2_hndl_tp *hndl);
+int cdb2_pipeline_pending(cdb2_hndl_tp *hndl);
+
 int cdb2_numcolumns(cdb2_hndl_tp *hndl);
 const char *cdb2_column_name(cdb2_hndl_tp *hndl, int col);
 int cdb2_column_type(cdb2_hndl_tp *hndl, int col);
@@ -118,6 +118,27 @@ struct cdb2_hndl {
     CDB2SQLRESPONSE *lastresponse;
     unsigned char *first_buf;
     CDB2SQLRESPONSE *firstresponse;
+    /* ROW_BATCH response being read; lastresponse points at batch_row, which
+       holds the current row of the batch */
+    CDB2SQLRESPONSE *batchresponse;
+    CDB2SQLRESPONSE batch_row;
+    const uint8_t *batch_pos;
+    const uint8_t *batch_end;
+    int batch_rows_left;
+    int batch_ncols;
+    ProtobufCBinaryData *batch_values;
+    protobuf_c_boolean *batch_isnulls;
+    uint8_t *batch_buf; /* decompressed batch */
+    int batch_buf_len;
+    uint8_t *batch_row_buf; /* aligned copy of the current row */
+    size_t batch_row_buf_len;
+    /* statements sent by cdb2_pipeline_add whose results were not read yet;
+       is_read of each, oldest at pipeline_head */
+    int pipeline_pending;
+    int pipeline_head;
+    int pipeline_cap;
+    uint8_t *pipeline_is_read;
+    int pipeline_unflushed;
     int error_in_trans;
     int client_side_error;
     int n_bindvars;
@@ -21,6 +21,7 @@
 #include <assert.h>
 #include <arpa/nameser_compat.h>
 #include "comdb2rle.h"
+#include <logmsg.h>
 
 #ifndef BYTE_ORDER
 #   error "BYTE_ORDER not defined"
@@ -227,63 +228,149 @@ static uint32_t space_reqd(uint32_t r, uint32_t s)
            (s > 1 ? (varint_need(s) + s) : s);
 }
 
+/* Return offset of first byte where p[i] != p[i + shift], or len if the
+ * first len bytes all match. 'sz' bytes repeat at p exactly as long as the
+ * buffer matches itself shifted by sz. */
+static size_t crle_diff_scalar(const uint8_t *p, size_t len, uint32_t shift)
+{
+    size_t i = 0;
+#ifndef _SUN_SOURCE
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t a, b;
+        memcpy(&a, p + i, sizeof(a));
+        memcpy(&b, p + i + shift, sizeof(b));
+        if (a != b)
+            break;
+    }
+#endif
+    while (i < len && p[i] == p[i + shift])
+        ++i;
+    return i;
+}
+
+/* Return how many bytes at the end of p[0..len) are equal to b */
+static size_t crle_rdiff_scalar(const uint8_t *p, size_t len, uint8_t b)
+{
+    size_t n = len;
+    while (n && p[n - 1] == b)
+        --n;
+    return len - n;
+}
+
+typedef size_t (*crle_diff_t)(const uint8_t *p, size_t len, uint32_t shift);
+typedef size_t (*crle_rdiff_t)(const uint8_t *p, size_t len, uint8_t b);
+static crle_diff_t crle_diff = crle_diff_scalar;
+static crle_rdiff_t crle_rdiff = crle_rdiff_scalar;
+
+#ifdef __x86_64__
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+static size_t crle_diff_sse2(const uint8_t *p, size_t len, uint32_t shift)
+{
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(p + i + shift));
+        uint32_t m = _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) ^ 0xffff;
+        if (m)
+            return i + __builtin_ctz(m);
+    }
+    return i + crle_diff_scalar(p + i, len - i, shift);
+}
+
+static size_t crle_rdiff_sse2(const uint8_t *p, size_t len, uint8_t b)
+{
+    __m128i v = _mm_set1_epi8(b);
+    size_t n = len;
+    for (; n >= 16; n -= 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p + n - 16));
+        uint32_t m = _mm_movemask_epi8(_mm_cmpeq_epi8(a, v)) ^ 0xffff;
+        if (m) /* bytes above the highest mismatch all match */
+            return (len - n) + (__builtin_clz(m) - 16);
+    }
+    return (len - n) + crle_rdiff_scalar(p, n, b);
+}
+
+__attribute__((target("avx2")))
+static size_t crle_diff_avx2(const uint8_t *p, size_t len, uint32_t shift)
+{
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p + i + shift));
+        uint32_t m = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+        if (m)
+            return i + __builtin_ctz(m);
+    }
+    return i + crle_diff_scalar(p + i, len - i, shift);
+}
+
+__attribute__((target("avx2")))
+static size_t crle_rdiff_avx2(const uint8_t *p, size_t len, uint8_t b)
+{
+    __m256i v = _mm256_set1_epi8(b);
+    size_t n = len;
+    for (; n >= 32; n -= 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(p + n - 32));
+        uint32_t m = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, v));
+        if (m)
+            return (len - n) + __builtin_clz(m);
+    }
+    return (len - n) + crle_rdiff_scalar(p, n, b);
+}
+
+/* Select best method to scan for repeats */
+void comdb2rle_init(int v)
+{
+    uint32_t eax, ebx, ecx, edx;
+    int avx2 = 0;
+    __cpuid(1, eax, ebx, ecx, edx);
+    /* AVX2 needs the OS to save ymm state as well as the cpu feature bit */
+    if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX) &&
+        __get_cpuid_max(0, NULL) >= 7) {
+        uint32_t xlo, xhi;
+        __asm__("xgetbv" : "=a"(xlo), "=d"(xhi) : "c"(0));
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        avx2 = ((xlo & 0x6) == 0x6) && (ebx & bit_AVX2);
+    }
+    if (avx2) {
+        crle_diff = crle_diff_avx2;
+        crle_rdiff = crle_rdiff_avx2;
+        if (v)
+            logmsg(LOGMSG_INFO, "comdb2rle = avx2\n");
+    } else {
+        crle_diff = crle_diff_sse2;
+        crle_rdiff = crle_rdiff_sse2;
+        if (v)
+            logmsg(LOGMSG_INFO, "comdb2rle = sse2\n");
+    }
+}
+
+#else
+
+void comdb2rle_init(int v)
+{
+    crle_diff = crle_diff_scalar;
+    crle_rdiff = crle_rdiff_scalar;
+    if (v)
+        logmsg(LOGMSG_INFO, "comdb2rle = scalar\n");
+}
+
+#endif
+
 /* Check if 'sz' bytes repeat */
 static uint32_t repeats(Data in, uint32_t sz, uint32_t *r_)
 {
-    uint32_t r;
-    r = *r_ = 0;
+    *r_ = 0;
     if (in.sz < (sz * 2))
         return 0;
-    uint8_t *bp, *bx, bt;
-    uint16_t *wp, word;
-    switch (sz) {
-    case 1:
-        bt = *in.dt;        // 1st byte
-        bp = in.dt + sz;    // byte ptr
-        bx = in.dt + in.sz; // byte ptr max
-#ifndef _SUN_SOURCE
-        if (in.sz > 16) {
-            size_t qz = in.sz - in.sz % 8; // # of quads
-            uint64_t qw;
-            memset(&qw, bt, sizeof(qw));             // 1st quad
-            uint64_t *qp = (uint64_t *)in.dt;        // quad ptr
-            uint64_t *qx = (uint64_t *)(in.dt + qz); // quad ptr max
-            while (qp < qx && *qp == qw)
-                ++qp;
-            if ((uint8_t *)qp != in.dt) {
-                if (qp < qx) // last quad != 1st
-                    --qp;
-                bp = (uint8_t *)qp;
-            }
-        }
-#endif
-        // check remainder byte at a time
-        while (bp < bx && *bp == bt)
-            ++bp;
-        r = bp - in.dt - 1;
-        break;
-#ifndef _SUN_SOURCE
-    case 2:
-        word = *(uint16_t *)in.dt;
-        wp = (uint16_t *)(in.dt + sz);
-        in.sz -= (in.sz % sz);
-        while ((in.sz -= sz) != 0 && word == *wp) {
-            ++wp;
-            ++r;
-        }
-        break;
-#endif
-    default:
-        bp = in.dt + sz;
-        in.sz -= (in.sz % sz);
-        while ((in.sz -= sz) != 0) {
-            if (memcmp(in.dt, bp, sz))
-                break;
-            bp += sz;
-            ++r;
-        }
-        break;
-    }
+    /* compare every whole block after the first one against its predecessor */
+    size_t span = (in.sz / sz - 1) * sz;
+    size_t same = span < 32 ? crle_diff_scalar(in.dt, span, sz)
+                            : crle_diff(in.dt, span, sz);
+    uint32_t r = same / sz;
     *r_ = r;
     return r;
 }
@@ -293,7 +380,7 @@ static int well_known(uint8_t *d, uint32_t s, uint32_t *w)
 {
     *w = MAXPAT;
     for (uint32_t i = 0; i < MAXPAT; ++i) {
-        if (s == psizes[i])
+        if (s == psizes[i] && *d == *patterns[i])
             if (memcmp(d, patterns[i], psizes[i]) == 0) {
                 *w = i;
                 return 1;
@@ -529,6 +616,17 @@ int decompressComdb2RLE(Comdb2RLE *d)
             memset(output.dt, *p, r);
             output.dt += r;
             output.sz -= r;
+        } else if (r > 3) {
+            /* copy the pattern once, then keep doubling what is written */
+            size_t done = s;
+            memcpy(output.dt, p, s);
+            while (done < reqd) {
+                size_t n = (done < reqd - done) ? done : reqd - done;
+                memcpy(output.dt + done, output.dt, n);
+                done += n;
+            }
+            output.dt += reqd;
+            output.sz -= reqd;
         } else
             for (uint32_t i = 0; i <= r; ++i) {
                 switch (s) {
@@ -564,13 +662,10 @@ int decompressComdb2RLE(Comdb2RLE *d)
  * r: output param */
 static int repeats_rev(const Data *input, uint32_t sz, uint32_t *r)
 {
-    uint8_t *first = input->dt - 1; //sentinel -- one before first
-    uint8_t *last = first + sz;
-    uint8_t b = *last--;
-    uint32_t dups = 0;
-    while (last != first && b == *last--) {
-        ++dups;
-    }
+    /* count bytes before the last one which equal the last one */
+    uint8_t b = input->dt[sz - 1];
+    uint32_t dups = sz < 32 ? crle_rdiff_scalar(input->dt, sz - 1, b)
+                            : crle_rdiff(input->dt, sz - 1, b);
     *r = dups;
     return dups;
 }
@@ -33,4 +33,7 @@ int compressComdb2RLE(Comdb2RLE *);
 int compressComdb2RLE_hints(Comdb2RLE *, uint16_t *);
 int decompressComdb2RLE(Comdb2RLE *);
 
+/* Pick the fastest repeat scanner for this cpu */
+void comdb2rle_init(int verbose);
+
 #endif
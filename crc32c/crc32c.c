@@ -132,6 +132,49 @@ uint32_t crc32c_comdb2(const uint8_t* buf, uint32_t sz)
 	return crc32c_func(buf, sz, CRC32C_SEED);
 }
 
+/*
+ * Checksum three independent buffers in lockstep. Each stream is a
+ * dependency chain on the crc32 instruction, so running three of them
+ * together keeps the unit busy without any recombination step. Process
+ * the common prefix this way and finish each buffer on its own.
+ */
+static void crc32c_sse_x3(const uint8_t **bufs, const uint32_t *szs,
+			  uint32_t *crcs)
+{
+	const uint8_t *b1 = bufs[0], *b2 = bufs[1], *b3 = bufs[2];
+	uint64_t c1 = CRC32C_SEED, c2 = CRC32C_SEED, c3 = CRC32C_SEED;
+	uint32_t common = szs[0];
+	if (szs[1] < common) common = szs[1];
+	if (szs[2] < common) common = szs[2];
+	common &= ~0x7;
+
+	for (uint32_t i = 0; i < common; i += 8) {
+		uint64_t w1, w2, w3;
+		memcpy(&w1, b1 + i, sizeof(w1));
+		memcpy(&w2, b2 + i, sizeof(w2));
+		memcpy(&w3, b3 + i, sizeof(w3));
+		c1 = _mm_crc32_u64(c1, w1);
+		c2 = _mm_crc32_u64(c2, w2);
+		c3 = _mm_crc32_u64(c3, w3);
+	}
+
+	crcs[0] = crc32c_func(b1 + common, szs[0] - common, c1);
+	crcs[1] = crc32c_func(b2 + common, szs[1] - common, c2);
+	crcs[2] = crc32c_func(b3 + common, szs[2] - common, c3);
+}
+
+void crc32c_multi(const uint8_t **bufs, const uint32_t *szs, uint32_t *crcs,
+		  int n)
+{
+	int i = 0;
+	if (crc32c_func != crc32c_software) {
+		for (; i + 3 <= n; i += 3)
+			crc32c_sse_x3(bufs + i, szs + i, crcs + i);
+	}
+	for (; i < n; ++i)
+		crcs[i] = crc32c_func(bufs[i], szs[i], CRC32C_SEED);
+}
+
 /* Helper routines */
 static inline uint32_t crc32c_1024_sse_int(const uint8_t *buf, uint32_t crc);
 static inline uint32_t crc32c_until_aligned(const uint8_t **buf, uint32_t *sz, uint32_t crc);
@@ -399,3 +442,12 @@ uint32_t crc32c_comdb2(const uint8_t* buf, uint32_t sz)
 }
 
 #endif
+
+#if !defined(__x86_64__)
+void crc32c_multi(const uint8_t **bufs, const uint32_t *szs, uint32_t *crcs,
+                  int n)
+{
+    for (int i = 0; i < n; ++i)
+        crcs[i] = crc32c(bufs[i], szs[i]);
+}
+#endif
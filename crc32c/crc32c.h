@@ -38,6 +38,10 @@ uint32_t crc32c_software(const uint8_t* data, uint32_t size, uint32_t crc);
 
 #define crc32c(buf, sz) crc32c_comdb2(buf, sz)
 
+/* Checksum n independent buffers: crcs[i] = crc32c(bufs[i], szs[i]) */
+void crc32c_multi(const uint8_t **bufs, const uint32_t *szs, uint32_t *crcs,
+                  int n);
+
 #ifdef __cplusplus
 }
 #endif
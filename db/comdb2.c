@@ -106,6 +106,7 @@ void berk_memp_sync_alarm_ms(int);
 #include <cdb2_constants.h>
 
 #include <crc32c.h>
+#include <comdb2rle.h>
 
 #include "fdb_fend.h"
 #include "fdb_bend.h"
@@ -304,6 +305,8 @@ int gbl_sqlreadahead = 0;
 int gbl_ioqueue = 0;
 int gbl_prefaulthelperthreads = 0;
 int gbl_osqlpfault_threads = 0;
+int gbl_osql_bplog_prefault_threads = 0;
+int gbl_osql_bplog_prefault_min_rows = 1000;
 int gbl_prefault_udp = 0;
 __thread int send_prefault_udp = 0;
 __thread snap_uid_t *osql_snap_info; /* contains cnonce */
@@ -3956,6 +3959,11 @@ static int init(int argc, char **argv)
         return -1;
     }
 
+    if (bplog_pfthdpool_init()) {
+        logmsg(LOGMSG_FATAL, "failed to initialise bplog prefault pool\n");
+        return -1;
+    }
+
     if (gbl_ctrace_dbdir)
         ctrace_openlog_taskname(thedb->basedir, dbname);
     else {
@@ -5817,6 +5825,7 @@ int main(int argc, char **argv)
     setvbuf(stdout, 0, _IOLBF, 0);
 
     crc32c_init(0);
+    comdb2rle_init(0);
 
     adjust_ulimits();
     sqlite3_tunables_init();
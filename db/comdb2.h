@@ -1256,6 +1256,14 @@ struct osql_target {
     COMDB2BUF *sb;
     int (*send)(struct osql_target *target, int usertype, void *data,
                 int datalen, int nodelay, void *tail, int tailen);
+
+    /* row ops pending to be shipped as one NET_OSQL_BATCH_RPL_UUID */
+    uint8_t *batch;
+    int batch_len;
+    int batch_cap;
+    int batch_nops;
+    int batch_type;
+    int batch_rc; /* a failed batch send fails the rest of the session */
 };
 typedef struct osql_target osql_target_t;
 
@@ -1706,6 +1714,8 @@ extern int gbl_ioqueue;
 extern int gbl_prefaulthelperthreads;
 
 extern int gbl_osqlpfault_threads;
+extern int gbl_osql_bplog_prefault_threads;
+extern int gbl_osql_bplog_prefault_min_rows;
 extern osqlpf_step *gbl_osqlpf_step;
 extern queue_type *gbl_osqlpf_stepq;
 
@@ -1873,6 +1883,7 @@ extern int gbl_prefault_toblock_local;
 extern int gbl_appsock_pooling;
 extern struct thdpool *gbl_appsock_thdpool;
 extern struct thdpool *gbl_osqlpfault_thdpool;
+extern struct thdpool *gbl_bplog_pfault_thdpool;
 extern struct thdpool *gbl_udppfault_thdpool;
 
 extern int gbl_consumer_rtcpu_check;
@@ -1976,6 +1987,7 @@ void sqlnet_init(void);
 int sqlpool_init(void);
 int schema_init(void);
 int osqlpfthdpool_init(void);
+int bplog_pfthdpool_init(void);
 int init_opcode_handlers();
 void toblock_init(void);
 int mach_class_cluster_init(void);
@@ -2349,7 +2361,8 @@ int ix_find_by_genid_origin(struct ireq *iq, unsigned long long genid,
                             void *fnddta, int *fndlen, int maxlen);
 int ix_find_by_rrn_and_genid_prefault(struct ireq *iq, int rrn,
                                       unsigned long long genid, void *fnddta,
-                                      int *fndlen, int maxlen);
+                                      int *fndlen, int maxlen,
+                                      uint32_t lockerid);
 int ix_find_by_rrn_and_genid_tran(struct ireq *iq, int rrn,
                                   unsigned long long genid, void *fnddta,
                                   int *fndlen, int maxlen, void *trans);
@@ -2368,7 +2381,7 @@ int ix_find_dirty(struct ireq *iq, int ixnum, void *key, int keylen,
                   void *fnddta, int *fndlen, int maxlen);
 int ix_find_prefault(struct ireq *iq, int ixnum, void *key, int keylen,
                      void *fndkey, int *fndrrn, unsigned long long *genid,
-                     void *fnddta, int *fndlen, int maxlen);
+                     void *fnddta, int *fndlen, int maxlen, uint32_t lockerid);
 int ix_find_nodatacopy(struct ireq *iq, int ixnum, void *key, int keylen,
                        void *fndkey, int *fndrrn, unsigned long long *genid,
                        void *fnddta, int *fndlen, int maxlen);
@@ -2885,8 +2898,11 @@ enum {
     RECFLAGS_DONT_LOCK_TBL = 1 << 11,
     RECFLAGS_COMDBG_FROM_LE = 1 << 12,
     RECFLAGS_INLINE_CONSTRAINTS = 1 << 13,
+    /* defer index adds to the thread's sorted key table; the caller
+     * inserts them with process_defered_table() */
+    RECFLAGS_SORTED_KEYS = 1 << 14,
 
-    RECFLAGS_MAX = 1 << 13
+    RECFLAGS_MAX = 1 << 14
 };
 
 /* flag codes */
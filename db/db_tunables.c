@@ -138,6 +138,7 @@ extern int gbl_max_key_size_new;
 extern int gbl_max_lua_instructions;
 extern int gbl_max_lua_source_len;
 extern int gbl_max_sqlcache;
+extern int gbl_max_sqlcache_shared_mem;
 extern int __gbl_max_mpalloc_sleeptime;
 extern int gbl_mem_nice;
 extern int gbl_notimeouts;
@@ -307,6 +308,8 @@ extern uint32_t gbl_rand_elect_min_ms;
 extern int gbl_rand_elect_max_ms;
 extern int gbl_handle_buf_add_latency_ms;
 extern int gbl_osql_send_startgen;
+extern int gbl_osql_batch_ops;
+extern int gbl_osql_batch_max_bytes;
 extern int gbl_create_default_user;
 extern int gbl_allow_neg_column_size;
 extern int gbl_client_heartbeat_ms;
@@ -341,6 +344,8 @@ extern int gbl_load_cache_threads;
 extern int gbl_load_cache_max_pages;
 extern int gbl_dump_cache_max_pages;
 extern int gbl_max_pages_per_cache_thread;
+extern int gbl_load_cache_readahead;
+extern int gbl_load_cache_throttle_ms;
 extern int gbl_memp_dump_cache_threshold;
 extern int gbl_disable_ckp;
 extern int gbl_abort_on_illegal_log_put;
@@ -356,6 +361,7 @@ extern int gbl_client_abort_on_slow;
 extern int gbl_max_trigger_threads;
 extern int gbl_alternate_normalize;
 extern int gbl_sc_logbytes_per_second;
+extern int gbl_sc_sorted_index_build;
 extern int gbl_fingerprint_max_queries;
 extern int gbl_query_plan_max_plans;
 extern double gbl_query_plan_percentage;
@@ -617,6 +623,9 @@ extern int gbl_retro_tpt_verbose;
 extern int gbl_retro_tpt_start;
 extern int gbl_legacy_tpt;
 extern int gbl_dohsql_joins;
+extern int gbl_dohsql_range_scan;
+extern int gbl_dohsql_agg_pushdown;
+extern int gbl_dohsql_agg_max_groups;
 extern int gbl_altersc_latency;
 extern int gbl_altersc_delay_usec;
 extern int gbl_altersc_latency_thr;
@@ -631,6 +640,9 @@ extern int gbl_legacy_requests_verbose;
 extern int gbl_long_request_ms;
 extern int gbl_nonodh_queue_scan_limit;
 extern int gbl_sql_row_delay_msecs;
+extern int gbl_sql_row_batch_min_rows;
+extern int gbl_sql_row_batch_bytes;
+extern int gbl_sql_row_batch_lz4;
 extern int gbl_thread_wait_sec;
 
 int64_t gbl_driver_ulimit = 0;
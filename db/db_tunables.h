@@ -827,6 +827,12 @@ REGISTER_TUNABLE("max_sqlcache_per_thread",
                  "cache is per-thread). (Default: 10)",
                  TUNABLE_INTEGER, &gbl_max_sqlcache, READONLY, NULL, NULL, NULL,
                  NULL);
+REGISTER_TUNABLE("max_sqlcache_shared_mem",
+                 "If set, per-thread statement caches are not limited to "
+                 "max_sqlcache_per_thread entries but share this many bytes "
+                 "of cached plans between them. (Default: 0)",
+                 TUNABLE_INTEGER, &gbl_max_sqlcache_shared_mem, 0, NULL, NULL,
+                 NULL, NULL);
 REGISTER_TUNABLE("maxt", NULL, TUNABLE_INTEGER, &gbl_maxthreads,
                  NOZERO, NULL, NULL, maxt_update, NULL);
 REGISTER_TUNABLE(
@@ -957,12 +963,28 @@ REGISTER_TUNABLE("optimize_repdb_truncate",
                  "Enables use of optimized repdb truncate code. (Default: on)",
                  TUNABLE_BOOLEAN, &gbl_optimize_truncate_repdb,
                  READONLY | NOARG | READEARLY, NULL, NULL, NULL, NULL);
+REGISTER_TUNABLE("osql_batch_ops",
+                 "Pack consecutive row ops of a transaction into a single net "
+                 "message to master. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_osql_batch_ops, 0, NULL, NULL, NULL, NULL);
+REGISTER_TUNABLE("osql_batch_max_bytes",
+                 "Maximum size of a batch of row ops sent to master. (Default: 65536)",
+                 TUNABLE_INTEGER, &gbl_osql_batch_max_bytes, NOZERO, NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("osql_bkoff_netsend", NULL, TUNABLE_INTEGER,
                  &gbl_osql_bkoff_netsend, READONLY, NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("osql_bkoff_netsend_lmt", NULL, TUNABLE_INTEGER,
                  &gbl_osql_bkoff_netsend_lmt, READONLY, NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("osqlprefaultthreads", "If set, send prefaulting hints to nodes. (Default: 0)", TUNABLE_INTEGER,
                  &gbl_osqlpfault_threads, READONLY, NULL, NULL, NULL, NULL);
+REGISTER_TUNABLE("osql_bplog_prefault_threads",
+                 "If set, fault in the pages of large transactions on this "
+                 "many threads, one table and stripe at a time, while the "
+                 "bplog is applied. (Default: 0)",
+                 TUNABLE_INTEGER, &gbl_osql_bplog_prefault_threads, READONLY, NULL, NULL, NULL, NULL);
+REGISTER_TUNABLE("osql_bplog_prefault_min_rows",
+                 "Only prefault transactions that change at least this many "
+                 "rows. (Default: 1000)",
+                 TUNABLE_INTEGER, &gbl_osql_bplog_prefault_min_rows, 0, NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("osql_verify_ext_chk",
                  "For block transaction mode only - after this many verify "
                  "errors, check if transaction is non-commitable (see default "
@@ -1026,7 +1048,7 @@ REGISTER_TUNABLE("random_lock_release_interval", NULL, TUNABLE_INTEGER,
 REGISTER_TUNABLE("rangextlim", NULL, TUNABLE_INTEGER, &gbl_rangextunit,
                  READONLY | NOZERO, NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE(
-    "rcache", "Keep a lookaside cache of root pages for B-trees. (Default: off)",
+    "rcache", "Keep a lookaside cache of root and upper internal pages for B-trees. (Default: off)",
     TUNABLE_BOOLEAN, &gbl_rcache, READONLY | NOARG, NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("reallearly",
                  "Acknowledge as soon as a commit record is seen by the "
@@ -1168,6 +1190,22 @@ REGISTER_TUNABLE("sqlsortermult", NULL, TUNABLE_INTEGER, &gbl_sqlite_sortermult,
 REGISTER_TUNABLE("sqlsorterpenalty",
                  "Sets the sorter penalty for query planner to prefer plans without explicit sort (Default: 5)",
                  TUNABLE_INTEGER, &gbl_sqlite_sorterpenalty, 0, NULL, NULL, NULL, NULL);
+REGISTER_TUNABLE("sql_row_batch_min_rows",
+                 "Send the rest of a result set in ROW_BATCH responses to "
+                 "clients which support them after this many rows. 0 "
+                 "disables. (Default: 1000)",
+                 TUNABLE_INTEGER, &gbl_sql_row_batch_min_rows, 0, NULL, NULL,
+                 NULL, NULL);
+REGISTER_TUNABLE("sql_row_batch_bytes",
+                 "Send a ROW_BATCH response once it holds this many bytes of "
+                 "row data. (Default: 65536)",
+                 TUNABLE_INTEGER, &gbl_sql_row_batch_bytes, NOZERO, NULL, NULL,
+                 NULL, NULL);
+REGISTER_TUNABLE("sql_row_batch_lz4",
+                 "Compress ROW_BATCH responses with lz4 for clients which "
+                 "support it. (Default: on)",
+                 TUNABLE_BOOLEAN, &gbl_sql_row_batch_lz4, 0, NULL, NULL, NULL,
+                 NULL);
 REGISTER_TUNABLE("sql_time_threshold",
                  "Sets the threshold time in ms after which queries are "
                  "reported as running a long time. (Default: 5000 ms)",
@@ -2149,6 +2187,19 @@ REGISTER_TUNABLE("load_cache_max_pages",
                  TUNABLE_INTEGER, &gbl_load_cache_max_pages, 0, NULL, NULL,
                  NULL, NULL);
 
+REGISTER_TUNABLE("load_cache_readahead",
+                 "Number of pages each cache loading thread asks the OS to "
+                 "read ahead of the page it is loading, 0 for none.  (Default: 0)",
+                 TUNABLE_INTEGER, &gbl_load_cache_readahead, 0, NULL, NULL,
+                 NULL, NULL);
+
+REGISTER_TUNABLE("load_cache_throttle_ms",
+                 "Pause cache loading threads for this many ms after each "
+                 "readahead window, to leave I/O for foreground requests.  "
+                 "(Default: 0)",
+                 TUNABLE_INTEGER, &gbl_load_cache_throttle_ms, 0, NULL, NULL,
+                 NULL, NULL);
+
 REGISTER_TUNABLE("dump_cache_max_pages",
                  "Maximum number of pages that will dump into a pagelist.  "
                  "Setting to 0 means that there is no limit.  (Default: 0)",
@@ -2614,6 +2665,19 @@ REGISTER_TUNABLE(
 
 REGISTER_TUNABLE("dohsql_joins", "Enable to support joins in parallel sql execution (default: on)", TUNABLE_BOOLEAN,
                  &gbl_dohsql_joins, 0, NULL, NULL, NULL, NULL);
+REGISTER_TUNABLE("dohsql_range_scan",
+                 "Run single table scans over a range partitioned table as parallel sql, one engine per range "
+                 "(default: off)",
+                 TUNABLE_BOOLEAN, &gbl_dohsql_range_scan, 0, NULL, NULL, NULL, NULL);
+
+REGISTER_TUNABLE("dohsql_agg_pushdown",
+                 "Compute partial aggregates in each parallel sql engine and combine them on the master "
+                 "(default: off)",
+                 TUNABLE_BOOLEAN, &gbl_dohsql_agg_pushdown, 0, NULL, NULL, NULL, NULL);
+REGISTER_TUNABLE("dohsql_agg_max_groups",
+                 "Maximum number of groups the master combines for a parallel aggregate; larger aggregates fail "
+                 "(0 for no limit)",
+                 TUNABLE_INTEGER, &gbl_dohsql_agg_max_groups, 0, NULL, NULL, NULL, NULL);
 
 REGISTER_TUNABLE("altersc_latency", "Enable tracking master queue latency and delay alter schema changes if too high",
                  TUNABLE_BOOLEAN, &gbl_altersc_latency, 0, NULL, NULL, NULL, NULL);
@@ -2644,6 +2708,10 @@ REGISTER_TUNABLE("sc_history_max_rows", "Max number of rows returned in comdb2_s
                  TUNABLE_INTEGER, &gbl_sc_history_max_rows, 0, NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("sc_status_max_rows", "Max number of rows returned in comdb2_sc_status (Default: 1000)",
                  TUNABLE_INTEGER, &gbl_sc_status_max_rows, 0, NULL, NULL, NULL, NULL);
+REGISTER_TUNABLE("sc_sorted_index_build",
+                 "Convert num_record_converts records per schema change transaction and add their index keys "
+                 "in key order at commit (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_sc_sorted_index_build, 0, NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("rep_process_pstack_time", "pstack the server if rep_process runs longer than time specified in secs. To disable set to 0 (Default: 0)",
                  TUNABLE_INTEGER, &gbl_rep_process_pstack_time, 0, NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("rep_process_warn_time", "Print trace if rep_process runs longer than time specified in secs (Default: 10s)",
@@ -21,10 +21,13 @@
 #include "dohsql.h"
 #include "sql.h"
 #include "fdb_fend.h"
+#include "shard_range.h"
 
 int gbl_dohast_disable = 0;
 int gbl_dohast_verbose = 0;
 int gbl_dohsql_joins = 1;
+int gbl_dohsql_range_scan = 0;
+int gbl_dohsql_agg_pushdown = 0;
 
 static void node_free(dohsql_node_t **pnode, sqlite3 *db);
 static void _save_params(Parse *pParse, dohsql_node_t *node);
@@ -172,7 +175,8 @@ Expr *_find_join_constrains(Expr *where, int iRightJoinTable)
 
 char *sqlite_struct_to_string(Vdbe *v, Select *p, Expr *extraRows,
                               int *order_size, int **order_dir,
-                              struct params_info **pParamsOut, int is_union)
+                              struct params_info **pParamsOut, int is_union,
+                              const char *range)
 {
     char *cols = NULL;
     char *tbl = NULL;
@@ -213,6 +217,16 @@ char *sqlite_struct_to_string(Vdbe *v, Select *p, Expr *extraRows,
         }
     }
 
+    if (range) {
+        /* restrict a range split to its own slice of the table */
+        char *tmp = where ? sqlite3_mprintf("(%s) AND (%s)", where, range)
+                          : sqlite3_mprintf("%s", range);
+        sqlite3_free(where);
+        if (!tmp)
+            return NULL;
+        where = tmp;
+    }
+
     if (p->pOrderBy) {
         orderby = describeExprList(v, p->pOrderBy, order_size, order_dir,
                                    pParamsOut, is_union);
@@ -498,7 +512,7 @@ void ast_destroy(ast_t **past, sqlite3 *db)
 
 static dohsql_node_t *gen_oneselect(Vdbe *v, Select *p, Expr *extraRows,
                                     int *order_size, int **order_dir,
-                                    int is_union)
+                                    int is_union, const char *range)
 {
     dohsql_node_t *node;
     Select *prior = p->pPrior;
@@ -518,7 +532,7 @@ static dohsql_node_t *gen_oneselect(Vdbe *v, Select *p, Expr *extraRows,
     node->type = AST_TYPE_SELECT;
     p->pPrior = p->pNext = NULL;
     node->sql = sqlite_struct_to_string(v, p, extraRows, order_size, order_dir,
-                                        &node->params, is_union);
+                                        &node->params, is_union, range);
     p->pPrior = prior;
     p->pNext = next;
 
@@ -553,6 +567,8 @@ static void node_free(dohsql_node_t **pnode, sqlite3 *db)
         free((*pnode)->params);
     }
 
+    free((*pnode)->agg);
+
     /* current node */
     if ((*pnode)->sql) {
         sqlite3_free((*pnode)->sql);
@@ -627,7 +643,7 @@ static dohsql_node_t *gen_union(Vdbe *v, Select *p, int span)
         assert(crt == p || !crt->pOrderBy); /* can "restore" to NULL? */
         crt->pOrderBy = p->pOrderBy;
         *psub = gen_oneselect(v, crt, pOffset, &node->order_size,
-                              &node->order_dir, 1);
+                              &node->order_dir, 1, NULL);
         crt->pLimit = NULL;
         if (crt != p)
             crt->pOrderBy = NULL;
@@ -698,6 +714,493 @@ static int skip_tables(Select *p)
     return 0;
 }
 
+/* result column an order by term sorts on, 1 based, or 0 if none */
+static int _order_by_col(Select *p, int i)
+{
+    struct ExprList_item *item = &p->pOrderBy->a[i];
+    int j;
+
+    if (item->u.x.iOrderByCol > 0)
+        return item->u.x.iOrderByCol;
+    for (j = 0; j < p->pEList->nExpr; j++) {
+        if (sqlite3ExprCompare(NULL, item->pExpr, p->pEList->a[j].pExpr,
+                               -1) == 0)
+            return j + 1;
+    }
+    return 0;
+}
+
+/**
+ * A plain scan of a single table that was split with CREATE RANGE PARTITION
+ * is run as a union all of one query per range; an order by, if any, is
+ * preserved by the ordered merge of the parallel results.
+ * Aggregates, distinct and limit need the whole result set and are not split,
+ * nor are tables that have no index led by the partition column.
+ */
+static dohsql_node_t *gen_range_select(Vdbe *v, Select *p)
+{
+    struct SrcList_item *item = &p->pSrc->a[0];
+    struct dbtable *db;
+    shard_limits_t *shards;
+    dohsql_node_t *node;
+    int *order_cols = NULL;
+    int i, span;
+
+    if (!gbl_dohsql_range_scan)
+        return NULL;
+
+    if (p->pSrc->nSrc != 1 || !item->zName || !item->pTab ||
+        item->pTab->iDb > 1 || p->pLimit || p->pWin ||
+        (p->selFlags & (SF_Aggregate | SF_Distinct)))
+        return NULL;
+
+    db = get_dbtable_by_name(item->zName);
+    if (!db || !(shards = db->sharding) || !shards->limits)
+        return NULL;
+
+    /* without an index each range would scan the whole table */
+    if (!shard_range_indexed(shards, item->pTab))
+        return NULL;
+    span = shards->nlimits + 1;
+
+    if (p->pOrderBy) {
+        order_cols = (int *)malloc(p->pOrderBy->nExpr * sizeof(int));
+        if (!order_cols)
+            return NULL;
+        for (i = 0; i < p->pOrderBy->nExpr; i++) {
+            /* the merge can only compare result columns */
+            if ((order_cols[i] = _order_by_col(p, i)) == 0) {
+                free(order_cols);
+                return NULL;
+            }
+        }
+    }
+
+    node = (dohsql_node_t *)calloc(1, sizeof(dohsql_node_t) +
+                                          span * sizeof(void *));
+    if (!node) {
+        free(order_cols);
+        return NULL;
+    }
+    node->type = AST_TYPE_UNION;
+    node->nodes = (dohsql_node_t **)(node + 1);
+    node->nnodes = span;
+    node->ncols = p->pEList->nExpr;
+
+    for (i = 0; i < span; i++) {
+        char *range = shard_range_predicate(shards, i);
+        if (range)
+            node->nodes[i] = gen_oneselect(v, p, NULL, &node->order_size,
+                                           &node->order_dir, 0, range);
+        sqlite3_free(range);
+        if (!node->nodes[i]) {
+            node_free(&node, v->db);
+            free(order_cols);
+            return NULL;
+        }
+    }
+
+    for (i = 0; i < node->order_size; i++)
+        node->order_dir[i] = order_cols[i] * (node->order_dir[i] ? -1 : 1);
+    free(order_cols);
+
+    node->sql = sqlite3_mprintf("%s", node->nodes[0]->sql);
+    for (i = 1; node->sql && i < span; i++) {
+        char *tmp =
+            sqlite3_mprintf("%s uNioN aLL %s", node->sql, node->nodes[i]->sql);
+        sqlite3_free(node->sql);
+        node->sql = tmp;
+    }
+    if (!node->sql)
+        node_free(&node, v->db);
+
+    return node;
+}
+
+/* aggregate functions the coordinator can combine from shard results */
+static int _agg_type(Expr *pExpr)
+{
+    const char *name = pExpr->u.zToken;
+    int nargs;
+
+    if (pExpr->op != TK_AGG_FUNCTION || pExpr->op2 ||
+        ExprHasProperty(pExpr, EP_Distinct | EP_WinFunc))
+        return -1;
+
+    nargs = pExpr->x.pList ? pExpr->x.pList->nExpr : 0;
+    if (sqlite3StrICmp(name, "count") == 0 && nargs <= 1)
+        return DOHSQL_AGG_COUNT;
+    if (nargs != 1)
+        return -1;
+    if (sqlite3StrICmp(name, "sum") == 0)
+        return DOHSQL_AGG_SUM;
+    if (sqlite3StrICmp(name, "total") == 0)
+        return DOHSQL_AGG_TOTAL;
+    if (sqlite3StrICmp(name, "min") == 0)
+        return DOHSQL_AGG_MIN;
+    if (sqlite3StrICmp(name, "max") == 0)
+        return DOHSQL_AGG_MAX;
+    if (sqlite3StrICmp(name, "avg") == 0)
+        return DOHSQL_AGG_AVG;
+    return -1;
+}
+
+/* partial sums are added up as plain numbers; only do that for columns
+ * that hold plain numbers (intervals have integer affinity) */
+static int _agg_numeric_arg(Expr *pExpr)
+{
+    Expr *arg = pExpr->x.pList->a[0].pExpr;
+    char aff;
+
+    if (arg->op != TK_COLUMN || !arg->y.pTab || arg->iColumn < 0)
+        return 0;
+    aff = sqlite3ExprAffinity(arg);
+    if (aff != SQLITE_AFF_INTEGER && aff != SQLITE_AFF_REAL)
+        return 0;
+    return sqlite3_strnicmp(
+               sqlite3ColumnType(&arg->y.pTab->aCol[arg->iColumn], ""),
+               "interval", 8) != 0;
+}
+
+/* the coordinator compares group keys, min/max and order by terms with
+ * the default collation; anything else has to run on one engine */
+static int _agg_binary_coll(Vdbe *v, Expr *pExpr)
+{
+    return sqlite3IsBinary(sqlite3ExprCollSeq(v->pParse, pExpr));
+}
+
+/* sql text of shard column "i" of a partial aggregate */
+static char *_agg_col_text(Vdbe *v, struct dohsql_agg *agg, Expr **exprs,
+                           int i, struct params_info **pParams)
+{
+    /* avg adds up shard totals, which cannot overflow like sum */
+    static const char *fn[] = {NULL,    "count", "sum", "total",
+                               "min",   "max",   "total"};
+    Expr *expr = exprs[i];
+    char *arg;
+    char *ret;
+
+    if (agg->col[i].type == DOHSQL_AGG_GROUP)
+        return sqlite3ExprDescribeParams(v, expr, pParams, NULL);
+
+    if (!expr->x.pList)
+        return sqlite3_mprintf("count(*)");
+    arg = sqlite3ExprDescribeParams(v, expr->x.pList->a[0].pExpr, pParams,
+                                    NULL);
+    if (!arg)
+        return NULL;
+    ret = sqlite3_mprintf("%s(%s)", fn[agg->col[i].type], arg);
+    sqlite3_free(arg);
+    return ret;
+}
+
+/* one shard of a partial aggregate:
+ * SELECT <partial columns> FROM <src> WHERE <where> AND <range> GROUP BY ..
+ */
+static dohsql_node_t *_agg_shard(Vdbe *v, Select *p, struct dohsql_agg *agg,
+                                 Expr **exprs, const char *src,
+                                 const char *range,
+                                 struct params_info *params)
+{
+    ExprList *pEList = p->pEList;
+    dohsql_node_t *node;
+    char *cols = NULL;
+    char *where = NULL;
+    char *group = NULL;
+    char *tmp;
+    char *col;
+    int i;
+
+    node = (dohsql_node_t *)calloc(1, sizeof(dohsql_node_t));
+    if (!node)
+        goto err;
+    node->type = AST_TYPE_SELECT;
+    node->ncols = agg->nshcols;
+    node->params = params;
+
+    for (i = 0; i < agg->nshcols; i++) {
+        const char *alias = NULL;
+
+        col = _agg_col_text(v, agg, exprs, i, &node->params);
+        if (!col)
+            goto err;
+        /* keep the column names the client would see */
+        if (i < agg->ncols)
+            alias = pEList->a[i].zName
+                        ? pEList->a[i].zName
+                        : (exprs[i]->op != TK_COLUMN ? pEList->a[i].zSpan
+                                                     : NULL);
+        tmp = sqlite3_mprintf("%s%s%s%s%s%s", cols ? cols : "",
+                              cols ? ", " : "", col, alias ? " aS \"" : "",
+                              alias ? alias : "", alias ? "\"" : "");
+        sqlite3_free(col);
+        sqlite3_free(cols);
+        if (!(cols = tmp))
+            goto err;
+    }
+
+    if (p->pWhere) {
+        where = sqlite3ExprDescribeParams(v, p->pWhere, &node->params, NULL);
+        if (!where)
+            goto err;
+    }
+    if (range) {
+        tmp = where ? sqlite3_mprintf("(%s) AND (%s)", where, range)
+                    : sqlite3_mprintf("%s", range);
+        sqlite3_free(where);
+        if (!(where = tmp))
+            goto err;
+    }
+
+    for (i = 0; p->pGroupBy && i < p->pGroupBy->nExpr; i++) {
+        col = sqlite3ExprDescribeParams(v, p->pGroupBy->a[i].pExpr,
+                                        &node->params, NULL);
+        if (!col)
+            goto err;
+        tmp = sqlite3_mprintf("%s%s%s", group ? group : "", group ? ", " : "",
+                              col);
+        sqlite3_free(col);
+        sqlite3_free(group);
+        if (!(group = tmp))
+            goto err;
+    }
+
+    node->sql = sqlite3_mprintf("SeLeCT %s FRoM %s%s%s%s%s", cols, src,
+                                where ? " WHeRe " : "", where ? where : "",
+                                group ? " GRouP By " : "", group ? group : "");
+    sqlite3_free(cols);
+    sqlite3_free(where);
+    sqlite3_free(group);
+    if (!node->sql)
+        node_free(&node, v->db);
+    return node;
+
+err:
+    sqlite3_free(cols);
+    sqlite3_free(where);
+    sqlite3_free(group);
+    if (node) {
+        node_free(&node, v->db);
+    } else if (params) {
+        free(params->params);
+        free(params);
+    }
+    return NULL;
+}
+
+/**
+ * An aggregate over a UNION ALL subquery (a time partition, for example) or
+ * over a range partitioned table runs as a union of per-shard partial
+ * aggregates; the coordinator combines the partial rows, so only one row per
+ * group and shard crosses threads instead of every qualifying row.
+ *
+ * Supported are count, sum, total, min, max and avg, and group by terms.
+ * Anything computed on top of an aggregate, having, distinct and limit
+ * keep running on a single engine, as do group keys, min/max and order by
+ * terms with a collation other than binary.
+ */
+static dohsql_node_t *gen_agg_select(Vdbe *v, Select *p)
+{
+    struct SrcList_item *item = &p->pSrc->a[0];
+    ExprList *pEList = p->pEList;
+    ExprList *pGroupBy = p->pGroupBy;
+    int ngroup = pGroupBy ? pGroupBy->nExpr : 0;
+    shard_limits_t *shards = NULL;
+    struct dohsql_agg *agg = NULL;
+    dohsql_node_t *node = NULL;
+    Expr **exprs = NULL;
+    Select *arm = NULL;
+    char *covered = NULL;
+    char *src = NULL;
+    int i, j, span, max;
+
+    if (!gbl_dohsql_agg_pushdown)
+        return NULL;
+
+    if (p->pPrior || p->pSrc->nSrc != 1 || !(p->selFlags & SF_Aggregate) ||
+        (p->selFlags & SF_Distinct) || p->pHaving || p->pLimit || p->pWin)
+        return NULL;
+
+    if (item->pSelect) {
+        /* union all of plain selects, no order or limit over the union */
+        Select *sub = item->pSelect;
+        if (!sub->pPrior || sub->pOrderBy || sub->pLimit || !item->pTab)
+            return NULL;
+        for (span = 0, arm = sub; arm; arm = arm->pPrior, span++) {
+            if ((arm->op != TK_ALL && arm->op != TK_SELECT) || arm->recording ||
+                skip_tables(arm) || arm->pEList->nExpr != item->pTab->nCol)
+                return NULL;
+        }
+        arm = sub;
+    } else {
+        struct dbtable *db;
+        if (!item->zName || !item->pTab || item->pTab->iDb > 1 ||
+            !gbl_dohsql_range_scan)
+            return NULL;
+        db = get_dbtable_by_name(item->zName);
+        if (!db || !(shards = db->sharding) || !shards->limits)
+            return NULL;
+        /* without an index each range would scan the whole table */
+        if (!shard_range_indexed(shards, item->pTab))
+            return NULL;
+        span = shards->nlimits + 1;
+        src = sqlite3_mprintf("\"%w\"", item->zName);
+        if (!src)
+            return NULL;
+    }
+
+    /* visible columns, group keys not selected, counts for avg */
+    max = 2 * pEList->nExpr + ngroup;
+    agg = (struct dohsql_agg *)calloc(1, sizeof(struct dohsql_agg) +
+                                             max * sizeof(*agg->col));
+    exprs = (Expr **)calloc(max, sizeof(Expr *));
+    covered = (char *)calloc(ngroup + 1, 1);
+    if (!agg || !exprs || !covered)
+        goto err;
+    agg->col = (void *)(agg + 1);
+    agg->ncols = pEList->nExpr;
+
+    for (i = 0; i < pEList->nExpr; i++) {
+        Expr *expr = exprs[i] = pEList->a[i].pExpr;
+        int type = _agg_type(expr);
+        if (type >= 0) {
+            if ((type == DOHSQL_AGG_SUM || type == DOHSQL_AGG_TOTAL ||
+                 type == DOHSQL_AGG_AVG) &&
+                !_agg_numeric_arg(expr))
+                goto err;
+            if ((type == DOHSQL_AGG_MIN || type == DOHSQL_AGG_MAX) &&
+                !_agg_binary_coll(v, expr->x.pList->a[0].pExpr))
+                goto err;
+            agg->col[i].type = type;
+            continue;
+        }
+        for (j = 0; j < ngroup; j++) {
+            if (sqlite3ExprCompare(NULL, expr, pGroupBy->a[j].pExpr, -1) == 0)
+                break;
+        }
+        if (j == ngroup)
+            goto err; /* not a group key, nor a plain aggregate */
+        agg->col[i].type = DOHSQL_AGG_GROUP;
+        covered[j] = 1;
+    }
+    for (j = 0; j < ngroup; j++) {
+        if (!_agg_binary_coll(v, pGroupBy->a[j].pExpr))
+            goto err;
+    }
+    for (j = 0; p->pOrderBy && j < p->pOrderBy->nExpr; j++) {
+        if (!_agg_binary_coll(v, p->pOrderBy->a[j].pExpr))
+            goto err;
+    }
+    agg->nshcols = agg->ncols;
+    for (j = 0; j < ngroup; j++) {
+        if (!covered[j]) {
+            exprs[agg->nshcols] = pGroupBy->a[j].pExpr;
+            agg->col[agg->nshcols++].type = DOHSQL_AGG_GROUP;
+        }
+    }
+    for (i = 0; i < agg->ncols; i++) {
+        if (agg->col[i].type == DOHSQL_AGG_AVG) {
+            agg->col[i].aux = agg->nshcols;
+            exprs[agg->nshcols] = exprs[i];
+            agg->col[agg->nshcols++].type = DOHSQL_AGG_COUNT;
+        }
+    }
+
+    node = (dohsql_node_t *)calloc(1, sizeof(dohsql_node_t) +
+                                          span * sizeof(void *));
+    if (!node)
+        goto err;
+    node->type = AST_TYPE_UNION;
+    node->nodes = (dohsql_node_t **)(node + 1);
+    node->nnodes = span;
+    node->ncols = agg->nshcols;
+
+    /* the final order is applied by the coordinator */
+    if (p->pOrderBy) {
+        node->order_size = p->pOrderBy->nExpr;
+        node->order_dir = (int *)malloc(node->order_size * sizeof(int));
+        if (!node->order_dir)
+            goto err;
+        for (i = 0; i < node->order_size; i++) {
+            int col = _order_by_col(p, i);
+            if (col == 0)
+                goto err;
+            node->order_dir[i] = p->pOrderBy->a[i].sortOrder ? -col : col;
+        }
+    }
+
+    for (i = 0; i < span; i++) {
+        struct params_info *params = NULL;
+        char *range = NULL;
+
+        if (arm) {
+            /* name the union columns the way the outer query knows them */
+            dohsql_node_t *armnode;
+            char **names = (char **)malloc(arm->pEList->nExpr * sizeof(char *));
+            if (!names)
+                goto err;
+            for (j = 0; j < arm->pEList->nExpr; j++) {
+                names[j] = arm->pEList->a[j].zName;
+                arm->pEList->a[j].zName = item->pTab->aCol[j].zName;
+            }
+            armnode = gen_oneselect(v, arm, NULL, NULL, NULL, 0, NULL);
+            for (j = 0; j < arm->pEList->nExpr; j++)
+                arm->pEList->a[j].zName = names[j];
+            free(names);
+            if (!armnode)
+                goto err;
+            src = sqlite3_mprintf("(%s)", armnode->sql);
+            params = armnode->params;
+            armnode->params = NULL;
+            node_free(&armnode, v->db);
+            arm = arm->pPrior;
+        } else {
+            range = shard_range_predicate(shards, i);
+            if (!range)
+                goto err;
+        }
+        if (src) {
+            node->nodes[i] =
+                _agg_shard(v, p, agg, exprs, src, range, params);
+        } else if (params) {
+            free(params->params);
+            free(params);
+        }
+        sqlite3_free(range);
+        if (item->pSelect) {
+            sqlite3_free(src);
+            src = NULL;
+        }
+        if (!node->nodes[i])
+            goto err;
+    }
+
+    node->sql = sqlite3_mprintf("%s", node->nodes[0]->sql);
+    for (i = 1; node->sql && i < span; i++) {
+        char *tmp =
+            sqlite3_mprintf("%s uNioN aLL %s", node->sql, node->nodes[i]->sql);
+        sqlite3_free(node->sql);
+        node->sql = tmp;
+    }
+    if (!node->sql)
+        goto err;
+
+    node->agg = agg;
+    sqlite3_free(src);
+    free(exprs);
+    free(covered);
+    return node;
+
+err:
+    if (node)
+        node_free(&node, v->db);
+    sqlite3_free(src);
+    free(agg);
+    free(exprs);
+    free(covered);
+    return NULL;
+}
+
 static dohsql_node_t *gen_select(Vdbe *v, Select *p)
 {
     Select *crt;
@@ -724,6 +1227,12 @@ static dohsql_node_t *gen_select(Vdbe *v, Select *p)
         crt = crt->pPrior;
     }
 
+    if (!not_recognized && p->op == TK_SELECT && p->pSrc->nSrc == 1) {
+        ret = gen_agg_select(v, p);
+        if (ret)
+            return ret;
+    }
+
     /* no with, joins or subqueries */
     if (not_recognized || p->pSrc->nSrc == 0 /*with*/ ||
         /*p->pSrc->nSrc > 1 joins || */ p->pSrc->a->pSelect /*subquery*/ ||
@@ -733,7 +1242,10 @@ static dohsql_node_t *gen_select(Vdbe *v, Select *p)
         return NULL;
 
     if (p->op == TK_SELECT) {
-        ret = gen_oneselect(v, p, NULL, NULL, NULL, 0);
+        ret = gen_range_select(v, p);
+        if (ret)
+            return ret;
+        ret = gen_oneselect(v, p, NULL, NULL, NULL, 0, NULL);
         if (ret) {
             /* single query case, can we push this remotely? */
             int i;
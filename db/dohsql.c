@@ -35,6 +35,7 @@ int gbl_dohsql_full_queue_poll_msec = 10;       /* 10msec */
 int gbl_dohsql_max_threads = 8; /* do not run more than 8 parallel shards */
 int gbl_dohsql_pool_thr_slack = 24; /* half default sqlengine pool maxthds */
 int gbl_dohsql_sc_max_threads = 8; /* do not run more than 8 parallel sc-s */
+int gbl_dohsql_agg_max_groups = 100000; /* groups combined by the master */
 /* for now we keep this tunning "private */
 static int gbl_dohsql_track_stats = 1;
 static int gbl_dohsql_que_free_highwm = 10;
@@ -123,12 +124,28 @@ struct dohsql {
     int order_size;
     int *order_dir;
     int nparams;
+    /* partial aggregates support */
+    struct dohsql_agg *agg;
+    struct agg_row *agg_rows; /* partial, then combined, rows */
+    int agg_nrows;
+    int agg_alloc;
+    int agg_next; /* next combined row to return, -1 while collecting */
+    row_t agg_out; /* wraps the combined row returned */
     /* stats */
     dohsql_req_stats_t stats;
 };
 
+/* a row owned by the coordinator, combined from partial aggregates */
+#define DOHSQL_AGG_SRC (-1)
+
+struct agg_row {
+    dohsql_t *conns;
+    Mem *cols;
+};
+
 struct dohsql_stats {
     long long num_reqs;
+    long long num_agg_reqs;
     int max_distribution;
     int max_queue_len;
     int max_free_queue_len;
@@ -149,6 +166,8 @@ static void sqlengine_work_shard(struct thdpool *pool, void *work,
 static int order_init(dohsql_t *conns, dohsql_node_t *node);
 static int dohsql_dist_next_row_ordered(struct sqlclntstate *clnt,
                                         sqlite3_stmt *stmt);
+static int dohsql_dist_next_row_agg(struct sqlclntstate *clnt,
+                                    sqlite3_stmt *stmt);
 static int _param_index(dohsql_connector_t *conn, const char *b, int64_t *c);
 static int _param_value(dohsql_connector_t *conn, struct param_data *b, int c,
                         const char *src);
@@ -453,6 +472,9 @@ static int inner_row_last(struct sqlclntstate *clnt)
 /* override sqlite engine */
 static int dohsql_dist_column_count(struct sqlclntstate *clnt, sqlite3_stmt *_)
 {
+    /* partial aggregates carry hidden columns at the end */
+    if (clnt->conns->agg)
+        return clnt->conns->agg->ncols;
     return clnt->conns->ncols;
 }
 
@@ -518,7 +540,7 @@ static int dohsql_dist_sqlite_error(struct sqlclntstate *clnt,
     int errcode;
     int src = conns->row_src;
 
-    if (src == 0) {
+    if (src <= 0) {
         return sqlite_stmt_error(stmt, errstr);
     }
 
@@ -557,7 +579,11 @@ static int dohsql_dist_param_value(struct sqlclntstate *clnt,
 static void donate_current_row(dohsql_t *conns, int locked)
 {
     if (conns->row) {
-        if (conns->row_src) {
+        if (conns->row_src == DOHSQL_AGG_SRC) {
+            /* combined row stays in conns->agg_rows */
+            conns->row = NULL;
+            conns->row_src = 0;
+        } else if (conns->row_src) {
             /* free what coordinator allocated before sending the row back */
             if (conns->row->unpacked) {
                 sqlite3UnpackedResultFree(&conns->row->unpacked, conns->ncols);
@@ -870,6 +896,284 @@ got_row:
     return SQLITE_ROW;
 }
 
+/* order of the group by keys */
+static int _agg_cmp_keys(const void *a, const void *b)
+{
+    const struct agg_row *ra = a;
+    const struct agg_row *rb = b;
+    struct dohsql_agg *agg = ra->conns->agg;
+    int i, ret;
+
+    for (i = 0; i < agg->nshcols; i++) {
+        if (agg->col[i].type != DOHSQL_AGG_GROUP)
+            continue;
+        ret = sqlite3MemCompare(&ra->cols[i], &rb->cols[i], NULL);
+        if (ret)
+            return ret;
+    }
+    return 0;
+}
+
+/* final order by, same encoding as the ordered merge */
+static int _agg_cmp_order(const void *a, const void *b)
+{
+    const struct agg_row *ra = a;
+    const struct agg_row *rb = b;
+    dohsql_t *conns = ra->conns;
+    int i, idx, ret;
+
+    for (i = 0; i < conns->order_size; i++) {
+        idx = ((conns->order_dir[i] > 0) ? conns->order_dir[i]
+                                         : -conns->order_dir[i]) - 1;
+        ret = sqlite3MemCompare(&ra->cols[idx], &rb->cols[idx], NULL);
+        if (ret)
+            return (conns->order_dir[i] < 0) ? -ret : ret;
+    }
+    return 0;
+}
+
+/* keep a copy of the partial row the merge just returned */
+static int _agg_add_row(sqlite3_stmt *stmt, dohsql_t *conns)
+{
+    struct agg_row *r;
+    Mem *src;
+    int i;
+
+    if (conns->row_src == 0) {
+        src = ((Vdbe *)stmt)->pResultSet;
+    } else {
+        if (!conns->row->unpacked) {
+            conns->row->unpacked =
+                sqlite3UnpackedResult(stmt, conns->ncols, conns->row->packed,
+                                      conns->row->row_size);
+        }
+        src = conns->row->unpacked;
+    }
+    if (!src)
+        return SQLITE_NOMEM;
+
+    if (conns->agg_nrows == conns->agg_alloc) {
+        int alloc = conns->agg_alloc ? 2 * conns->agg_alloc : 64;
+        r = realloc(conns->agg_rows, alloc * sizeof(struct agg_row));
+        if (!r)
+            return SQLITE_NOMEM;
+        conns->agg_rows = r;
+        conns->agg_alloc = alloc;
+    }
+
+    r = &conns->agg_rows[conns->agg_nrows];
+    r->conns = conns;
+    r->cols = sqlite3_malloc64(sizeof(Mem) * conns->ncols);
+    if (!r->cols)
+        return SQLITE_NOMEM;
+    bzero(r->cols, sizeof(Mem) * conns->ncols);
+    conns->agg_nrows++;
+
+    /* the source row goes back to its shard, copy the values out */
+    for (i = 0; i < conns->ncols; i++) {
+        if (sqlite3VdbeMemCopy(&r->cols[i], &src[i]))
+            return SQLITE_NOMEM;
+    }
+    return SQLITE_OK;
+}
+
+/* add partial row "val" into "acc"; both have the same group keys */
+static int _agg_combine(struct dohsql_agg *agg, Mem *acc, Mem *val)
+{
+    Mem *a, *b;
+    i64 sum;
+    int i, cmp;
+
+    for (i = 0; i < agg->nshcols; i++) {
+        a = &acc[i];
+        b = &val[i];
+        switch (agg->col[i].type) {
+        case DOHSQL_AGG_GROUP:
+            break;
+        case DOHSQL_AGG_COUNT:
+            sqlite3VdbeMemSetInt64(a, sqlite3VdbeIntValue(a) +
+                                          sqlite3VdbeIntValue(b));
+            break;
+        case DOHSQL_AGG_SUM:
+            if (b->flags & MEM_Null)
+                break;
+            if (a->flags & MEM_Null) {
+                if (sqlite3VdbeMemCopy(a, b))
+                    return SQLITE_NOMEM;
+                break;
+            }
+            if ((a->flags & MEM_Int) && (b->flags & MEM_Int)) {
+                /* same as sum() on a single engine */
+                sum = a->u.i;
+                if (sqlite3AddInt64(&sum, b->u.i))
+                    return SQLITE_ERROR;
+                sqlite3VdbeMemSetInt64(a, sum);
+                break;
+            }
+            sqlite3VdbeMemSetDouble(a, sqlite3VdbeRealValue(a) +
+                                           sqlite3VdbeRealValue(b));
+            break;
+        case DOHSQL_AGG_AVG:
+        case DOHSQL_AGG_TOTAL:
+            sqlite3VdbeMemSetDouble(a, sqlite3VdbeRealValue(a) +
+                                           sqlite3VdbeRealValue(b));
+            break;
+        case DOHSQL_AGG_MIN:
+        case DOHSQL_AGG_MAX:
+            if (b->flags & MEM_Null)
+                break;
+            if (!(a->flags & MEM_Null)) {
+                cmp = sqlite3MemCompare(b, a, NULL);
+                if (agg->col[i].type == DOHSQL_AGG_MIN ? cmp >= 0 : cmp <= 0)
+                    break;
+            }
+            if (sqlite3VdbeMemCopy(a, b))
+                return SQLITE_NOMEM;
+            break;
+        }
+    }
+    return SQLITE_OK;
+}
+
+/* combine the partial rows of each group into one row */
+static int _agg_compact(dohsql_t *conns)
+{
+    struct dohsql_agg *agg = conns->agg;
+    struct agg_row *rows = conns->agg_rows;
+    int i, n, rc;
+
+    if (conns->agg_nrows == 0)
+        return SQLITE_OK;
+
+    qsort(rows, conns->agg_nrows, sizeof(struct agg_row), _agg_cmp_keys);
+    for (i = 1, n = 0; i < conns->agg_nrows; i++) {
+        if (_agg_cmp_keys(&rows[n], &rows[i]) == 0) {
+            rc = _agg_combine(agg, rows[n].cols, rows[i].cols);
+            if (rc) {
+                /* keep every row reachable for dohsql_end_distribute */
+                for (n++; i < conns->agg_nrows; i++, n++)
+                    rows[n] = rows[i];
+                conns->agg_nrows = n;
+                return rc;
+            }
+            sqlite3UnpackedResultFree(&rows[i].cols, conns->ncols);
+        } else {
+            rows[++n] = rows[i];
+        }
+    }
+    conns->agg_nrows = n + 1;
+    return SQLITE_OK;
+}
+
+/* combine the partial rows of each group, finish avg, apply order by */
+static int _agg_merge(dohsql_t *conns)
+{
+    struct dohsql_agg *agg = conns->agg;
+    struct agg_row *rows;
+    int i, j, rc;
+
+    rc = _agg_compact(conns);
+    if (rc)
+        return rc;
+    rows = conns->agg_rows;
+
+    for (i = 0; i < conns->agg_nrows; i++) {
+        for (j = 0; j < agg->ncols; j++) {
+            Mem *m = &rows[i].cols[j];
+            i64 cnt;
+            if (agg->col[j].type != DOHSQL_AGG_AVG)
+                continue;
+            cnt = sqlite3VdbeIntValue(&rows[i].cols[agg->col[j].aux]);
+            if (cnt == 0 || (m->flags & MEM_Null))
+                sqlite3VdbeMemSetNull(m);
+            else
+                sqlite3VdbeMemSetDouble(m, sqlite3VdbeRealValue(m) / cnt);
+        }
+    }
+
+    if (conns->order_size)
+        qsort(rows, conns->agg_nrows, sizeof(struct agg_row), _agg_cmp_order);
+
+    return SQLITE_OK;
+}
+
+/* report a coordinator error through the statement, like the engine would;
+ * a combine error is an integer sum overflow */
+static int _agg_error(sqlite3_stmt *stmt, int rc, const char *fmt, ...)
+{
+    Vdbe *v = (Vdbe *)stmt;
+    va_list args;
+
+    if (v->rc == rc && v->zErrMsg)
+        return rc; /* already set */
+
+    v->rc = rc;
+    if (fmt) {
+        va_start(args, fmt);
+        sqlite3DbFree(v->db, v->zErrMsg);
+        v->zErrMsg = sqlite3VMPrintf(v->db, fmt, args);
+        va_end(args);
+    } else if (rc == SQLITE_ERROR) {
+        sqlite3VdbeError(v, "integer overflow");
+    }
+    return rc;
+}
+
+/**
+ * this combines partial aggregates from N engines; rows are returned
+ * once every engine is done
+ *
+ */
+static int dohsql_dist_next_row_agg(struct sqlclntstate *clnt,
+                                    sqlite3_stmt *stmt)
+{
+    dohsql_t *conns = clnt->conns;
+    int rc;
+
+    if (conns->agg_next < 0) {
+        while ((rc = dohsql_dist_next_row(clnt, stmt)) == SQLITE_ROW) {
+            rc = _agg_add_row(stmt, conns);
+            /* buffer up to twice the groups, then combine what we have */
+            if (rc == SQLITE_OK && gbl_dohsql_agg_max_groups > 0 &&
+                conns->agg_nrows >= 2 * gbl_dohsql_agg_max_groups) {
+                rc = _agg_compact(conns);
+                if (rc == SQLITE_OK &&
+                    conns->agg_nrows > gbl_dohsql_agg_max_groups)
+                    rc = _agg_error(stmt, SQLITE_ERROR,
+                                    "parallel aggregate has more than %d "
+                                    "groups",
+                                    gbl_dohsql_agg_max_groups);
+            }
+            if (rc != SQLITE_OK) {
+                _signal_children_master_is_done(conns);
+                return _agg_error(stmt, rc, NULL);
+            }
+        }
+        if (rc != SQLITE_DONE)
+            return rc;
+
+        rc = _agg_merge(conns);
+        if (rc != SQLITE_OK)
+            return _agg_error(stmt, rc, NULL);
+        conns->agg_next = 0;
+
+        if (gbl_dohsql_verbose)
+            logmsg(LOGMSG_USER, "%p %s: combined %d rows into %d groups\n",
+                   (void *)pthread_self(), __func__, conns->nrows,
+                   conns->agg_nrows);
+    }
+
+    donate_current_row(conns, 0);
+    if (conns->agg_next >= conns->agg_nrows)
+        return SQLITE_DONE;
+
+    conns->agg_out.unpacked = conns->agg_rows[conns->agg_next++].cols;
+    conns->row = &conns->agg_out;
+    conns->row_src = DOHSQL_AGG_SRC;
+
+    return SQLITE_ROW;
+}
+
 int dohsql_write_response(struct sqlclntstate *c, int t, void *a, int i)
 {
     if (gbl_plugin_api_debug)
@@ -1086,8 +1390,10 @@ static void _master_clnt_set(struct sqlclntstate *clnt)
     clnt->adapter_backup = clnt->adapter;
 
     clnt->plugin.column_count = dohsql_dist_column_count;
-    clnt->plugin.next_row = (clnt->conns->order) ? dohsql_dist_next_row_ordered
-                                                 : dohsql_dist_next_row;
+    clnt->plugin.next_row = (clnt->conns->agg) ? dohsql_dist_next_row_agg
+                            : (clnt->conns->order)
+                                ? dohsql_dist_next_row_ordered
+                                : dohsql_dist_next_row;
     clnt->plugin.column_type = dohsql_dist_column_type;
     clnt->plugin.column_int64 = dohsql_dist_column_int64;
     clnt->plugin.column_double = dohsql_dist_column_double;
@@ -1191,7 +1497,17 @@ int dohsql_distribute(dohsql_node_t *node)
     conns->ncols = node->ncols;
     conns->nparams = node->nparams;
 
-    if (node->order_size) {
+    if (node->agg) {
+        /* the coordinator waits for all shards before returning rows */
+        conns->agg = node->agg;
+        conns->agg_next = -1;
+        conns->order_size = node->order_size;
+        conns->order_dir = node->order_dir;
+        node->agg = NULL;
+        node->order_size = 0;
+        node->order_dir = NULL;
+        flags = THDPOOL_FORCE_DISPATCH;
+    } else if (node->order_size) {
         if (order_init(conns, node)) {
             free(conns);
             return SHARD_ERR_MALLOC;
@@ -1242,6 +1558,8 @@ int dohsql_distribute(dohsql_node_t *node)
 
     if (gbl_dohsql_track_stats) {
         gbl_dohsql_stats_dirty.num_reqs++;
+        if (conns->agg)
+            gbl_dohsql_stats_dirty.num_agg_reqs++;
         if (gbl_dohsql_stats_dirty.max_distribution < conns->nconns)
             gbl_dohsql_stats_dirty.max_distribution = conns->nconns;
 
@@ -1316,6 +1634,8 @@ int dohsql_end_distribute(struct sqlclntstate *clnt, struct reqlogger *logger)
     if (likely(gbl_dohsql_track_stats)) {
         Pthread_mutex_lock(&dohsql_stats_mtx);
         gbl_dohsql_stats.num_reqs++;
+        if (conns->agg)
+            gbl_dohsql_stats.num_agg_reqs++;
         if (gbl_dohsql_stats.max_distribution < conns->nconns)
             gbl_dohsql_stats.max_distribution = conns->nconns;
         if (gbl_dohsql_stats.max_queue_len < conns->stats.max_queue_len)
@@ -1337,9 +1657,13 @@ int dohsql_end_distribute(struct sqlclntstate *clnt, struct reqlogger *logger)
             conns->stats.max_free_queue_len, conns->stats.max_queue_bytes);
     }
 
-    if (conns->order) {
-        free(conns->order);
-        free(conns->order_dir);
+    free(conns->order);
+    free(conns->order_dir);
+    if (conns->agg) {
+        for (i = 0; i < conns->agg_nrows; i++)
+            sqlite3UnpackedResultFree(&conns->agg_rows[i].cols, conns->ncols);
+        free(conns->agg_rows);
+        free(conns->agg);
     }
     clnt_plugin_reset(clnt);
     clnt->conns = NULL;
@@ -1441,7 +1765,8 @@ void comdb2_register_offset(int iOffset, int iLimitOffset, int iSavedOffset)
 
 #define DOHSQL_MASTER                                                          \
     (clnt->plugin.next_row == dohsql_dist_next_row ||                          \
-     clnt->plugin.next_row == dohsql_dist_next_row_ordered)
+     clnt->plugin.next_row == dohsql_dist_next_row_ordered ||                  \
+     clnt->plugin.next_row == dohsql_dist_next_row_agg)
 
 void comdb2_handle_limit(Vdbe *v, Mem *m)
 {
@@ -1926,6 +2251,8 @@ void dohsql_stats(void)
 {
     logmsg(LOGMSG_USER, "Num requests: %lld [%lld]\n",
            gbl_dohsql_stats.num_reqs, gbl_dohsql_stats_dirty.num_reqs);
+    logmsg(LOGMSG_USER, "Num partial aggregate requests: %lld [%lld]\n",
+           gbl_dohsql_stats.num_agg_reqs, gbl_dohsql_stats_dirty.num_agg_reqs);
     logmsg(LOGMSG_USER, "Max distribution: %d [%d]\n",
            gbl_dohsql_stats.max_distribution,
            gbl_dohsql_stats_dirty.max_distribution);
@@ -1956,7 +2283,8 @@ void explain_distribution(dohsql_node_t *node)
         return;
 
     if (node->type == AST_TYPE_UNION) {
-        snprintf(str, sizeof(str), "Threads %d", node->nnodes);
+        snprintf(str, sizeof(str), "Threads %d%s", node->nnodes,
+                 node->agg ? " partial aggregates" : "");
         char *pstr = &str[0];
 
         if (write_response(clnt, RESPONSE_ROW_STR, &pstr, 1))
@@ -25,6 +25,32 @@ struct params_info {
     struct param_data *params;
 };
 
+/* how the coordinator combines a shard result column */
+enum dohsql_agg_type {
+    DOHSQL_AGG_GROUP = 0, /* group by key */
+    DOHSQL_AGG_COUNT = 1,
+    DOHSQL_AGG_SUM = 2,
+    DOHSQL_AGG_TOTAL = 3,
+    DOHSQL_AGG_MIN = 4,
+    DOHSQL_AGG_MAX = 5,
+    DOHSQL_AGG_AVG = 6 /* shards return the total; count is in col[].aux */
+};
+
+/**
+ * Partial aggregation plan: each shard runs the aggregate over its own rows
+ * and the coordinator combines the per-shard results; shard rows have the
+ * ncols columns returned to the client followed by hidden helper columns
+ *
+ */
+struct dohsql_agg {
+    int ncols;   /* columns returned to the client */
+    int nshcols; /* columns returned by each shard, ncols + hidden */
+    struct {
+        enum dohsql_agg_type type;
+        int aux; /* DOHSQL_AGG_AVG: shard column with the count */
+    } *col;
+};
+
 struct dohsql_node {
     enum ast_type type;
     char *sql;
@@ -36,6 +62,7 @@ struct dohsql_node {
     int nparams;
     int remotedb;
     struct params_info *params;
+    struct dohsql_agg *agg; /* union of partial aggregates, if set */
 };
 typedef struct dohsql_node dohsql_node_t;
 
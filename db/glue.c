@@ -1916,11 +1916,13 @@ int ix_find_nodatacopy(struct ireq *iq, int ixnum, void *key, int keylen,
 
 int ix_find_prefault(struct ireq *iq, int ixnum, void *key, int keylen,
                      void *fndkey, int *fndrrn, unsigned long long *genid,
-                     void *fnddta, int *fndlen, int maxlen)
+                     void *fnddta, int *fndlen, int maxlen, uint32_t lockerid)
 {
-    return ix_find_int(AUXDB_NONE, iq, ixnum, key, keylen, fndkey, fndrrn,
-                       genid, fnddta, fndlen, maxlen, 0, NULL, NULL, NULL, NULL,
-                       NULL, 1, 1, 0, NULL, NULL);
+    bdb_fetch_args_t args = {0};
+    args.lockerid = lockerid;
+    return ix_find_int_ll(AUXDB_NONE, iq, ixnum, key, keylen, fndkey, fndrrn,
+                          genid, fnddta, fndlen, maxlen, 0, NULL, NULL, NULL,
+                          NULL, NULL, 1, 1, 0, NULL, NULL, &args);
 }
 
 int ix_find_dirty(struct ireq *iq, int ixnum, void *key, int keylen,
@@ -2047,13 +2049,14 @@ int ix_find_auxdb_by_rrn_and_genid_dirty(int auxdb, struct ireq *iq, int rrn,
 int ix_find_auxdb_by_rrn_and_genid_prefault(int auxdb, struct ireq *iq, int rrn,
                                             unsigned long long genid,
                                             void *fnddta, int *fndlen,
-                                            int maxlen)
+                                            int maxlen, uint32_t lockerid)
 {
     int rc;
     void *bdb_handle;
     int bdberr;
     char *req;
     bdb_fetch_args_t args = {0};
+    args.lockerid = lockerid;
 
     bdb_handle = get_bdb_handle(iq->usedb, auxdb);
     if (!bdb_handle)
@@ -2259,10 +2262,12 @@ int ix_find_by_rrn_and_genid(struct ireq *iq, int rrn, unsigned long long genid,
 
 int ix_find_by_rrn_and_genid_prefault(struct ireq *iq, int rrn,
                                       unsigned long long genid, void *fnddta,
-                                      int *fndlen, int maxlen)
+                                      int *fndlen, int maxlen,
+                                      uint32_t lockerid)
 {
     return ix_find_auxdb_by_rrn_and_genid_prefault(AUXDB_NONE, iq, rrn, genid,
-                                                   fnddta, fndlen, maxlen);
+                                                   fnddta, fndlen, maxlen,
+                                                   lockerid);
 }
 
 int ix_find_by_rrn_and_genid_dirty(struct ireq *iq, int rrn,
@@ -1138,6 +1138,57 @@ static int process_this_session(
     return rc_out;
 }
 
+/* Split the sorted bplog in groups of updated/deleted genids per table and
+ * stripe, and have the prefault pool fault in their records and keys while
+ * the session is applied; the apply itself stays serial and in order.
+ * Called under store_mtx
+ */
+static bplog_pf_t *bplog_prefault_start(blocksql_tran_t *tran)
+{
+    struct temp_cursor *dbc;
+    bplog_pf_t *pf;
+    int bdberr = 0;
+    int rc;
+
+    dbc = bdb_temp_table_cursor(thedb->bdb_env, tran->db, NULL, &bdberr);
+    if (!dbc || bdberr)
+        return NULL;
+
+    pf = bplog_pf_create();
+    if (!pf)
+        goto done;
+
+    for (rc = bdb_temp_table_first(thedb->bdb_env, dbc, &bdberr); rc == 0;
+         rc = bdb_temp_table_next(thedb->bdb_env, dbc, &bdberr)) {
+        oplog_key_t *opkey = (oplog_key_t *)bdb_temp_table_key(dbc);
+        uint8_t *p_buf = bdb_temp_table_data(dbc);
+        int type = 0;
+
+        if (!opkey->is_rec || opkey->tbl_idx == 0 || opkey->tbl_idx > thedb->num_dbs)
+            continue;
+
+        buf_get(&type, sizeof(type), p_buf, p_buf + bdb_temp_table_datasize(dbc));
+        switch (type) {
+        case OSQL_DELREC:
+        case OSQL_DELETE:
+        case OSQL_UPDREC:
+        case OSQL_UPDATE:
+            break;
+        default:
+            continue;
+        }
+
+        if (bplog_pf_add(pf, thedb->dbs[opkey->tbl_idx - 1], opkey->stripe, opkey->genid))
+            break;
+    }
+
+    bplog_pf_dispatch(pf);
+
+done:
+    bdb_temp_table_close_cursor(thedb->bdb_env, dbc, &bdberr);
+    return pf;
+}
+
 static int apply_changes(struct ireq *iq, blocksql_tran_t *tran, void *iq_tran,
                          int *nops, struct block_err *err,
                          int (*func)(struct ireq *, uuid_t, void *, char **,
@@ -1150,6 +1201,7 @@ static int apply_changes(struct ireq *iq, blocksql_tran_t *tran, void *iq_tran,
     int bdberr = 0;
     struct temp_cursor *dbc = NULL;
     struct temp_cursor *dbc_ins = NULL;
+    bplog_pf_t *pf = NULL;
 
     /* lock the table (it should get no more access anway) */
     Pthread_mutex_lock(&tran->store_mtx);
@@ -1205,10 +1257,18 @@ static int apply_changes(struct ireq *iq, blocksql_tran_t *tran, void *iq_tran,
 
     listc_init(&iq->bpfunc_lst, offsetof(bpfunc_lstnode_t, linkct));
 
+    /* genids are only in the bplog key when reordering */
+    if (gbl_bplog_pfault_thdpool && tran->is_reorder_on &&
+        iq->sorese->tran_rows >= gbl_osql_bplog_prefault_min_rows)
+        pf = bplog_prefault_start(tran);
+
     /* go through the complete list and apply all the changes */
     out_rc = process_this_session(iq, iq_tran, iq->sorese, &bdberr, nops, err,
                                   dbc, dbc_ins, func);
 
+    if (pf)
+        bplog_pf_done(pf);
+
     Pthread_mutex_unlock(&tran->store_mtx);
 
     /* close the cursor */
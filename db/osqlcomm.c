@@ -78,6 +78,8 @@ int gbl_toblock_random_verify_error;
 int gbl_selectv_writelock = 0;
 int gbl_debug_invalid_genid;
 int gbl_partition_sc_reorder = 1;
+int gbl_osql_batch_ops = 0;
+int gbl_osql_batch_max_bytes = 65536;
 
 extern int db_is_exiting();
 extern int upsert_collision_should_force_verify_error(int flags, int ixnum);
@@ -3297,6 +3299,8 @@ static osql_comm_t *get_thecomm(void)
 
 static int net_osql_rpl(void *hndl, void *uptr, char *fromnode, struct interned_string *frominterned,
                         int usertype, void *dtap, int dtalen, uint8_t is_tcp);
+static void net_osql_rpl_batch(void *hndl, void *uptr, char *fromhost, struct interned_string *frominterned,
+                               int usertype, void *dtap, int dtalen, uint8_t is_tcp);
 static int net_osql_rpl_tail(void *hndl, void *uptr, char *fromnode,
                              int usertype, void *dtap, int dtalen, void *tail,
                              int tailen);
@@ -3477,6 +3481,8 @@ int osql_comm_init(struct dbenv *dbenv)
                          "osql_serial_rpl_uuid",
                          (void (*)(void*,void*,char*,struct interned_string*,int,void*,int,uint8_t))net_osql_rpl);
 
+    net_register_handler(tmp->handle_sibling, NET_OSQL_BATCH_RPL_UUID, "osql_batch_rpl_uuid", net_osql_rpl_batch);
+
     net_register_handler(tmp->handle_sibling, NET_OSQL_MASTER_CHECK_UUID,
                          "osql_master_check_uuid", net_osql_master_check);
     net_register_handler(tmp->handle_sibling, NET_OSQL_MASTER_CHECKED_UUID,
@@ -5766,6 +5772,64 @@ static int net_osql_rpl(void *hndl, void *uptr, char *fromnode, struct interned_
     return rc;
 }
 
+/* NET_OSQL_BATCH_RPL_UUID frame:
+ *   usertype (of every op in the batch), nops,
+ *   followed by nops times { oplen, op }
+ * Each op is the exact buffer a single-op send would have carried */
+enum { OSQLCOMM_BATCH_HDR_LEN = 4 + 4 };
+
+static void net_osql_rpl_batch(void *hndl, void *uptr, char *fromhost, struct interned_string *frominterned,
+                               int usertype, void *dtap, int dtalen, uint8_t is_tcp)
+{
+    uint8_t *p_buf = (uint8_t *)dtap;
+    uint8_t *p_buf_end = p_buf + dtalen;
+    int optype = 0;
+    int nops = 0;
+    int found = 0;
+
+    if (dtalen < OSQLCOMM_BATCH_HDR_LEN) {
+        logmsg(LOGMSG_ERROR, "%s: short batch from %s, len %d\n", __func__, fromhost, dtalen);
+        return;
+    }
+    p_buf = (uint8_t *)buf_get(&optype, sizeof(optype), p_buf, p_buf_end);
+    p_buf = (uint8_t *)buf_get(&nops, sizeof(nops), p_buf, p_buf_end);
+
+    int req = netrpl2req(optype);
+    stats[req].rcv += nops;
+
+    int rc = osql_sess_rcvop_batch(p_buf, p_buf_end, nops, &found);
+    if (rc)
+        stats[req].rcv_failed++;
+    if (!found)
+        stats[req].rcv_rdndt++;
+}
+
+/**
+ * Unpack the next op of a NET_OSQL_BATCH_RPL_UUID frame in place
+ * Returns a pointer past the op, or NULL if the frame is malformed
+ *
+ */
+uint8_t *osqlcomm_batch_op_get(uint8_t **op, int *oplen, int *type, uuid_t uuid, uint8_t *p_buf,
+                               const uint8_t *p_buf_end)
+{
+    osql_uuid_rpl_t hd;
+    int len = 0;
+
+    if (!(p_buf = (uint8_t *)buf_get(&len, sizeof(len), p_buf, p_buf_end)))
+        return NULL;
+    if (len < OSQLCOMM_UUID_RPL_TYPE_LEN || len > (p_buf_end - p_buf))
+        return NULL;
+    if (!osqlcomm_uuid_rpl_type_get(&hd, p_buf, p_buf + len))
+        return NULL;
+
+    *op = p_buf;
+    *oplen = len;
+    *type = hd.type;
+    comdb2uuidcpy(uuid, hd.uuid);
+
+    return p_buf + len;
+}
+
 static int check_master(const osql_target_t *target)
 {
     if (target->type == OSQL_OVER_NET) {
@@ -8717,6 +8781,146 @@ int offload_net_send(const char *host, int usertype, void *data, int datalen,
     return rc;
 }
 
+/* only row ops are batched; anything that can end, abort or alter the
+   session on master goes out on its own, after the pending batch */
+static int osql_op_can_batch(int usertype, void *data, int datalen)
+{
+    osql_uuid_rpl_t hd;
+
+    switch (usertype) {
+    case NET_OSQL_SOCK_RPL_UUID:
+    case NET_OSQL_RECOM_RPL_UUID:
+    case NET_OSQL_SNAPISOL_RPL_UUID:
+    case NET_OSQL_SERIAL_RPL_UUID:
+        break;
+    default:
+        return 0;
+    }
+
+    if (!osqlcomm_uuid_rpl_type_get(&hd, data, (uint8_t *)data + datalen))
+        return 0;
+
+    switch (hd.type) {
+    case OSQL_USEDB:
+    case OSQL_DELREC:
+    case OSQL_INSREC:
+    case OSQL_QBLOB:
+    case OSQL_UPDREC:
+    case OSQL_UPDCOLS:
+    case OSQL_RECGENID:
+    case OSQL_DELETE:
+    case OSQL_INSERT:
+    case OSQL_UPDATE:
+    case OSQL_DELIDX:
+    case OSQL_INSIDX:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Ship the row ops accumulated by osql_send_batched, if any
+ *
+ */
+int osql_flush_batch(osql_target_t *target, int nodelay)
+{
+    int rc;
+
+    if (target->batch_nops == 0)
+        return 0;
+
+    uint8_t *p_buf = target->batch;
+    uint8_t *p_buf_end = p_buf + OSQLCOMM_BATCH_HDR_LEN;
+    p_buf = buf_put(&target->batch_type, sizeof(target->batch_type), p_buf, p_buf_end);
+    p_buf = buf_put(&target->batch_nops, sizeof(target->batch_nops), p_buf, p_buf_end);
+
+    rc = offload_net_send(target->host, NET_OSQL_BATCH_RPL_UUID, target->batch, target->batch_len, nodelay, NULL, 0);
+    if (rc) {
+        /* the ops are gone; the transaction must not go on without them */
+        logmsg(LOGMSG_ERROR, "%s: failed to send %d row ops to %s rc %d\n", __func__, target->batch_nops,
+               target->host, rc);
+        target->batch_rc = rc;
+    }
+
+    target->batch_len = 0;
+    target->batch_nops = 0;
+
+    return rc;
+}
+
+/**
+ * Send a bplog message to master, packing consecutive row ops of a session
+ * into one net message of up to osql_batch_max_bytes
+ *
+ */
+int osql_send_batched(osql_target_t *target, int usertype, void *data, int datalen, int nodelay, void *tail,
+                      int tailen)
+{
+    int rc;
+    int oplen = datalen + tailen;
+    int need = sizeof(int) + oplen;
+
+    /* once a batch is lost every later op fails, including the commit */
+    if (target->batch_rc)
+        return target->batch_rc;
+
+    if (!gbl_osql_batch_ops || target->host == gbl_myhostname || !osql_op_can_batch(usertype, data, datalen) ||
+        OSQLCOMM_BATCH_HDR_LEN + need > gbl_osql_batch_max_bytes) {
+        if ((rc = osql_flush_batch(target, 0)) != 0)
+            return rc;
+        return offload_net_send(target->host, usertype, data, datalen, nodelay, tail, tailen);
+    }
+
+    if (target->batch_nops &&
+        (target->batch_type != usertype || target->batch_len + need > gbl_osql_batch_max_bytes)) {
+        if ((rc = osql_flush_batch(target, 0)) != 0)
+            return rc;
+    }
+
+    if (target->batch_nops == 0)
+        target->batch_len = OSQLCOMM_BATCH_HDR_LEN;
+
+    if (target->batch_len + need > target->batch_cap) {
+        int cap = gbl_osql_batch_max_bytes;
+        uint8_t *batch = realloc(target->batch, cap);
+        if (!batch) {
+            logmsg(LOGMSG_ERROR, "%s: failed to allocate %d bytes\n", __func__, cap);
+            target->batch_rc = -1;
+            return -1;
+        }
+        target->batch = batch;
+        target->batch_cap = cap;
+    }
+
+    uint8_t *p_buf = target->batch + target->batch_len;
+    p_buf = buf_put(&oplen, sizeof(oplen), p_buf, target->batch + target->batch_cap);
+    memcpy(p_buf, data, datalen);
+    if (tailen > 0)
+        memcpy(p_buf + datalen, tail, tailen);
+
+    target->batch_len += need;
+    target->batch_nops++;
+    target->batch_type = usertype;
+
+    /* the caller is waiting on this op; don't hold it back for more */
+    if (nodelay)
+        return osql_flush_batch(target, nodelay);
+
+    return 0;
+}
+
+/**
+ * Drop any pending row ops and release the batch buffer
+ *
+ */
+void osql_free_batch(osql_target_t *target)
+{
+    free(target->batch);
+    target->batch = NULL;
+    target->batch_len = target->batch_cap = target->batch_nops = 0;
+}
+
 /**
  * Read a commit (DONE/XERR) from a socket, used in bplog over socket
  * Timeoutms limits total amount of waiting for a commit
@@ -362,6 +362,13 @@ int osql_page_prefault(char *rpl, int rplen, struct dbtable **last_db,
                        int **iq_step_ix, unsigned long long rqid, uuid_t uuid,
                        unsigned long long seq);
 
+/* Commit-time prefault of the bplog, per table and stripe */
+typedef struct bplog_pf bplog_pf_t;
+bplog_pf_t *bplog_pf_create(void);
+int bplog_pf_add(bplog_pf_t *pf, struct dbtable *db, int stripe, unsigned long long genid);
+void bplog_pf_dispatch(bplog_pf_t *pf);
+void bplog_pf_done(bplog_pf_t *pf);
+
 int osql_set_usedb(struct ireq *iq, const char *tablename, int tableversion,
                    int step, struct block_err *err);
 
@@ -396,6 +403,20 @@ int offload_comm_send_blockreply(char *host, unsigned long long rqid, void *buf,
 int offload_net_send(const char *host, int usertype, void *data, int datalen,
                      int nodelay, void *tail, int tailen);
 
+/* Send a message to master over net, batching row ops if enabled */
+int osql_send_batched(osql_target_t *target, int usertype, void *data, int datalen, int nodelay, void *tail,
+                      int tailen);
+
+/* Send the pending batch of row ops, if any */
+int osql_flush_batch(osql_target_t *target, int nodelay);
+
+/* Discard pending row ops and free the batch buffer */
+void osql_free_batch(osql_target_t *target);
+
+/* Unpack the next op of a NET_OSQL_BATCH_RPL_UUID frame */
+uint8_t *osqlcomm_batch_op_get(uint8_t **op, int *oplen, int *type, uuid_t uuid, uint8_t *p_buf,
+                               const uint8_t *p_buf_end);
+
 /**
  * Copy and pack the host-ordered client_query_stats type into big-endian
  * format.  This routine only packs up to the path_stats component:  use
@@ -15,6 +15,8 @@
  */
 
 #include "comdb2.h"
+#include "comdb2_atomic.h"
+#include "locks.h"
 
 struct thdpool *gbl_osqlpfault_thdpool = NULL;
 
@@ -317,7 +319,7 @@ static void osqlpfault_do_work(struct thdpool *pool, void *work, void *thddata)
             exit(1);
         }
         rc = ix_find_by_rrn_and_genid_prefault(&iq, 2, req->genid, fnddta,
-                                               &fndlen, od_len);
+                                               &fndlen, od_len, 0);
         if (fnddta)
             free(fnddta);
     } break;
@@ -338,7 +340,7 @@ static void osqlpfault_do_work(struct thdpool *pool, void *work, void *thddata)
 
         iq.usedb = req->db;
         rc = ix_find_prefault(&iq, req->index, req->key, req->len, fndkey,
-                              &fndrrn, &genid, NULL, NULL, 0);
+                              &fndrrn, &genid, NULL, NULL, 0, 0);
     } break;
     case OSQLPFRQ_NEWKEY: {
         int fndrrn = 0;
@@ -358,7 +360,7 @@ static void osqlpfault_do_work(struct thdpool *pool, void *work, void *thddata)
 
         iq.usedb = req->db;
         rc = ix_find_prefault(&iq, req->index, req->key, req->len, fndkey,
-                              &fndrrn, &genid, NULL, NULL, 0);
+                              &fndrrn, &genid, NULL, NULL, 0, 0);
     } break;
     case OSQLPFRQ_OLDDATA_OLDKEYS: {
         size_t od_len;
@@ -391,7 +393,7 @@ static void osqlpfault_do_work(struct thdpool *pool, void *work, void *thddata)
         }
 
         rc = ix_find_by_rrn_and_genid_prefault(&iq, 2, req->genid, fnddta,
-                                               &fndlen, od_len);
+                                               &fndlen, od_len, 0);
 
         if ((is_bad_rc(rc)) || (od_len != fndlen)) {
             if (fnddta)
@@ -483,7 +485,7 @@ static void osqlpfault_do_work(struct thdpool *pool, void *work, void *thddata)
         }
 
         rc = ix_find_by_rrn_and_genid_prefault(&iq, 2, req->genid, fnddta,
-                                               &fndlen, od_len);
+                                               &fndlen, od_len, 0);
 
         if ((is_bad_rc(rc)) || (od_len != fndlen)) {
             free(fnddta);
@@ -640,3 +642,205 @@ int osql_page_prefault(char *rpl, int rplen, struct dbtable **last_db,
     }
     return 0;
 }
+
+/* bplog group prefault: at commit, the sorted bplog is split into groups of
+   genids per table and stripe, and each group has its old records and
+   old keys faulted in by a worker while the block processor applies the
+   ops serially, in the usual order.
+   Workers read with their own locker, so they can block on page locks of
+   the transaction being applied; the applier must never wait for them.
+   Once it is done it only cancels them, and the last one out frees pf.
+   A worker may thus outlive the transaction, so it never touches the
+   dbtable the group was built with: it read locks the table by name for
+   the whole group and looks it up again under that lock, which keeps a
+   schema change from swapping or freeing it while the worker reads, and
+   keeps every wait in the lock manager, where deadlocks are detected. */
+
+struct thdpool *gbl_bplog_pfault_thdpool = NULL;
+
+typedef struct bplog_pf_group {
+    struct bplog_pf *pf;
+    struct dbtable *db; /* only valid while the applier runs */
+    char tablename[MAXTABLELEN];
+    int stripe;
+    unsigned long long *genids;
+    int ngenids;
+    int maxgenids;
+} bplog_pf_group_t;
+
+struct bplog_pf {
+    int refs;     /* applier + dispatched groups not yet finished */
+    int cancel;   /* applier is done, stop faulting */
+    bplog_pf_group_t *groups;
+    int ngroups;
+    int maxgroups;
+};
+
+int bplog_pfthdpool_init(void)
+{
+    if (!gbl_osql_bplog_prefault_threads)
+        return 0;
+
+    gbl_bplog_pfault_thdpool = thdpool_create("bplogpfaultpool", 0);
+    if (!gbl_bplog_pfault_thdpool)
+        return 1;
+
+    if (!gbl_exit_on_pthread_create_fail)
+        thdpool_unset_exit(gbl_bplog_pfault_thdpool);
+
+    thdpool_set_minthds(gbl_bplog_pfault_thdpool, 0);
+    thdpool_set_maxthds(gbl_bplog_pfault_thdpool, gbl_osql_bplog_prefault_threads);
+    thdpool_set_maxqueue(gbl_bplog_pfault_thdpool, 1000);
+    thdpool_set_linger(gbl_bplog_pfault_thdpool, 10);
+    thdpool_set_longwaitms(gbl_bplog_pfault_thdpool, 10000);
+
+    return 0;
+}
+
+bplog_pf_t *bplog_pf_create(void)
+{
+    bplog_pf_t *pf = calloc(1, sizeof(bplog_pf_t));
+    if (!pf)
+        return NULL;
+    pf->refs = 1;
+    return pf;
+}
+
+/* add a genid to the group of (db, stripe); the bplog is sorted, so only the
+   last group needs to be checked */
+int bplog_pf_add(bplog_pf_t *pf, struct dbtable *db, int stripe, unsigned long long genid)
+{
+    bplog_pf_group_t *grp = pf->ngroups ? &pf->groups[pf->ngroups - 1] : NULL;
+
+    if (!grp || grp->db != db || grp->stripe != stripe) {
+        if (pf->ngroups == pf->maxgroups) {
+            int max = pf->maxgroups ? 2 * pf->maxgroups : 16;
+            bplog_pf_group_t *groups = realloc(pf->groups, max * sizeof(bplog_pf_group_t));
+            if (!groups)
+                return -1;
+            pf->groups = groups;
+            pf->maxgroups = max;
+        }
+        grp = &pf->groups[pf->ngroups++];
+        memset(grp, 0, sizeof(*grp));
+        grp->pf = pf;
+        grp->db = db;
+        strncpy0(grp->tablename, db->tablename, sizeof(grp->tablename));
+        grp->stripe = stripe;
+    }
+
+    if (grp->ngenids == grp->maxgenids) {
+        int max = grp->maxgenids ? 2 * grp->maxgenids : 256;
+        unsigned long long *genids = realloc(grp->genids, max * sizeof(unsigned long long));
+        if (!genids)
+            return -1;
+        grp->genids = genids;
+        grp->maxgenids = max;
+    }
+    grp->genids[grp->ngenids++] = genid;
+
+    return 0;
+}
+
+static void bplog_pf_group_fault(bplog_pf_group_t *grp)
+{
+    struct ireq iq;
+    unsigned char *fnddta = NULL;
+    uint32_t lid;
+    int od_len;
+    int i, ixnum, rc;
+
+    lid = bdb_lowpri_lock_id(thedb->bdb_env);
+    if (!lid)
+        return;
+
+    if (ATOMIC_LOAD32(grp->pf->cancel) ||
+        bdb_lock_tablename_read_fromlid(thedb->bdb_env, grp->tablename, lid) != 0)
+        goto done;
+
+    init_fake_ireq(thedb, &iq);
+    iq.usedb = get_dbtable_by_name(grp->tablename);
+    if (!iq.usedb)
+        goto done;
+
+    od_len = getdatsize(iq.usedb);
+    if (od_len <= 0)
+        goto done;
+
+    fnddta = malloc(od_len);
+    if (!fnddta)
+        goto done;
+
+    for (i = 0; i < grp->ngenids && !ATOMIC_LOAD32(grp->pf->cancel); i++) {
+        int fndlen = 0;
+
+        rc = ix_find_by_rrn_and_genid_prefault(&iq, 2, grp->genids[i], fnddta, &fndlen, od_len, lid);
+        if (is_bad_rc(rc) || fndlen != od_len)
+            continue;
+
+        for (ixnum = 0; ixnum < iq.usedb->nix && !ATOMIC_LOAD32(grp->pf->cancel); ixnum++) {
+            char key[MAXKEYLEN + 1];
+            char fndkey[MAXKEYLEN + 1];
+            unsigned long long genid = 0;
+            int fndrrn = 0;
+            int keysz = getkeysize(iq.usedb, ixnum);
+
+            if (keysz < 0 || stag_ondisk_to_ix(iq.usedb, ixnum, (char *)fnddta, key) == -1)
+                break;
+
+            ix_find_prefault(&iq, ixnum, key, keysz, fndkey, &fndrrn, &genid, NULL, NULL, 0, lid);
+        }
+    }
+
+done:
+    free(fnddta);
+    bdb_free_lock_id(thedb->bdb_env, lid);
+}
+
+static void bplog_pf_put(bplog_pf_t *pf)
+{
+    int i;
+
+    if (ATOMIC_ADD32(pf->refs, -1) > 0)
+        return;
+
+    for (i = 0; i < pf->ngroups; i++)
+        free(pf->groups[i].genids);
+    free(pf->groups);
+    free(pf);
+}
+
+static void bplog_pf_do_work_pp(struct thdpool *pool, void *work, void *thddata, int op)
+{
+    bplog_pf_group_t *grp = (bplog_pf_group_t *)work;
+
+    switch (op) {
+    case THD_RUN:
+        bdb_thread_event(thedb->bdb_env, BDBTHR_EVENT_START);
+        bplog_pf_group_fault(grp);
+        bdb_thread_event(thedb->bdb_env, BDBTHR_EVENT_DONE);
+        break;
+    }
+    bplog_pf_put(grp->pf);
+}
+
+/* hand every group to the pool; groups that do not fit are skipped */
+void bplog_pf_dispatch(bplog_pf_t *pf)
+{
+    int i;
+
+    for (i = 0; i < pf->ngroups; i++) {
+        ATOMIC_ADD32(pf->refs, 1);
+        if (thdpool_enqueue(gbl_bplog_pfault_thdpool, bplog_pf_do_work_pp, &pf->groups[i], 0, NULL, 0) != 0)
+            bplog_pf_put(pf);
+    }
+}
+
+/* the applier is done: stop the workers without waiting for them, as they
+   may be blocked on locks of the transaction that is still open.  A worker
+   finishes at most the lookup it is in */
+void bplog_pf_done(bplog_pf_t *pf)
+{
+    XCHANGE32(pf->cancel, 1);
+    bplog_pf_put(pf);
+}
@@ -504,6 +504,76 @@ failed_stream:
     return rc;
 }
 
+/**
+ * Handles a NET_OSQL_BATCH_RPL_UUID frame of "nops" row ops
+ * Batches only carry row ops of a single session, so none of them can
+ * finish the stream; the session is looked up and released once
+ * Set found if the session is found or not
+ *
+ */
+int osql_sess_rcvop_batch(uint8_t *p_buf, const uint8_t *p_buf_end, int nops, int *found)
+{
+    osql_sess_t *sess = NULL;
+    uuid_t uuid;
+    int rc = 0;
+    int i;
+
+    *found = 0;
+
+    for (i = 0; i < nops; i++) {
+        uint8_t *op;
+        int oplen, type;
+
+        p_buf = osqlcomm_batch_op_get(&op, &oplen, &type, uuid, p_buf, p_buf_end);
+        if (!p_buf) {
+            logmsg(LOGMSG_ERROR, "%s: malformed batch, op %d of %d\n", __func__, i, nops);
+            rc = -1;
+            break;
+        }
+
+        if (!sess) {
+            /* dispatched or terminated sessions are ignored */
+            sess = osql_repository_get(uuid);
+            if (!sess)
+                return 0;
+            *found = 1;
+        } else if (comdb2uuidcmp(uuid, sess->uuid)) {
+            uuidstr_t us;
+            logmsg(LOGMSG_ERROR, "%s: batch mixes sessions, op %d uuid %s\n", __func__, i,
+                   comdb2uuidstr(uuid, us));
+            rc = -1;
+            break;
+        }
+
+        if (osql_comm_is_done(sess, type, (char *)op, oplen, NULL, NULL)) {
+            logmsg(LOGMSG_ERROR, "%s: unexpected %s in batch\n", __func__, osql_reqtype_str(type));
+            rc = -1;
+            break;
+        }
+
+        rc = osql_bplog_saveop(sess, sess->tran, (char *)op, oplen, type);
+        if (rc)
+            break;
+    }
+
+    if (!sess)
+        return rc;
+
+    if (rc) {
+        /* failed to save into bplog; discard and be done */
+        osql_repository_put(sess);
+        logmsg(LOGMSG_DEBUG, "%s: cancelled transaction\n", __func__);
+        osql_sess_close(&sess, 1);
+        return rc;
+    }
+
+    if (osql_repository_put(sess) == 1) {
+        /* session was marked terminated and not finished*/
+        osql_sess_close(&sess, 1);
+    }
+    return 0;
+}
+
 extern int gbl_sockbplog_debug;
 
 /**
@@ -86,6 +86,14 @@ char *osql_sess_info(osql_sess_t *sess);
  */
 int osql_sess_rcvop(uuid_t uuid, int type, void *data, int datalen, int *found);
 
+/**
+ * Handles a NET_OSQL_BATCH_RPL_UUID frame of "nops" row ops
+ * The session is looked up once for the whole batch
+ * Set found if the session is found or not
+ *
+ */
+int osql_sess_rcvop_batch(uint8_t *p_buf, const uint8_t *p_buf_end, int nops, int *found);
+
 /**
  * Same as osql_sess_rcvop, for socket protocol
  *
@@ -54,6 +54,8 @@ int osql_begin_net(struct sqlclntstate *clnt, int type, int keep_rqid)
     osql->target.type = OSQL_OVER_NET;
     osql->target.host = thedb->master;
     osql->target.send = _send;
+    osql->target.batch_nops = 0;
+    osql->target.batch_rc = 0;
     assert(osql->target.sb == NULL);
 
     /* protect against no master */
@@ -84,12 +86,13 @@ int osql_begin_net(struct sqlclntstate *clnt, int type, int keep_rqid)
  */
 int osql_end_net(struct sqlclntstate *clnt)
 {
+    osql_free_batch(&clnt->osql.target);
     return osql_unregister_sqlthr(clnt);
 }
 
 static int _send(osql_target_t *target, int usertype, void *data, int datalen,
                  int nodelay, void *tail, int tailen)
 {
-    return offload_net_send(target->host, usertype, data, datalen, nodelay,
-                            tail, tailen);
+    return osql_send_batched(target, usertype, data, datalen, nodelay, tail,
+                             tailen);
 }
@@ -1959,6 +1959,8 @@ clipper_usage:
             extern uint32_t rcache_hits, rcache_miss, rcache_savd,
                 rcache_invalid, rcache_collide;
             logmsg(LOGMSG_ERROR, "rcache enabled:%s\n", YESNO(gbl_rcache));
+            logmsg(LOGMSG_ERROR, "cache levels: %d\n",
+                   bdb_attr_get(thedb->bdb_attr, BDB_ATTR_RCACHE_LEVELS));
             logmsg(LOGMSG_ERROR, "cache hits: %u\n", rcache_hits);
             logmsg(LOGMSG_ERROR, "cache miss: %u\n", rcache_miss);
             logmsg(LOGMSG_ERROR, "cache save: %u\n", rcache_savd);
@@ -2322,6 +2324,10 @@ clipper_usage:
         tok = segtok(line, lline, &st, &ltok);
         if (ltok == 0) {
             load_cache_default();
+        } else if (tokcmp(tok, ltok, "stop") == 0) {
+            extern int gbl_load_cache_stop;
+            gbl_load_cache_stop = 1;
+            logmsg(LOGMSG_USER, "Stopping bufferpool load\n");
         } else
             load_cache(tok);
     } else if (tokcmp(tok, ltok, "dump_cache") == 0) {
@@ -3214,6 +3220,8 @@ clipper_usage:
                         &gbl_debug_sql_opcodes);
         } else if (tokcmp(tok, ltok, "dumphints") == 0) {
             sql_dump_hints();
+        } else if (tokcmp(tok, ltok, "stmtcache") == 0) {
+            stmt_cache_dump_stats();
         }
     } else if (tokcmp(tok, ltok, "ixstat") == 0) {
         ixstats(dbenv);
@@ -3625,7 +3633,7 @@ clipper_usage:
     }
 
     else if (tokcmp(tok, ltok, "netuse") == 0) {
-        unsigned long long read, written, waits, reorders;
+        unsigned long long read, written, waits, reorders, copied, sent;
         int rc;
         const char *hosts[REPMAX];
         int num_nodes;
@@ -3634,20 +3642,26 @@ clipper_usage:
         logmsg(LOGMSG_USER,
             "Read: %llu    Written: %llu    Throttles: %llu   Reorders: %llu\n",
             read, written, waits, reorders);
+        net_get_copy_usage(thedb->handle_sibling, &copied, &sent);
+        logmsg(LOGMSG_USER, "Copied: %llu    Sent: %llu\n", copied, sent);
         num_nodes = net_get_all_nodes(thedb->handle_sibling, hosts);
         if (num_nodes > 0) {
             int i;
             const char *host;
-            logmsg(LOGMSG_USER, "%5s %15s %15s %15s %15s\n", "Node", "Read", "Written",
-                   "Throttles", "Reorders");
+            logmsg(LOGMSG_USER, "%5s %15s %15s %15s %15s %15s %15s\n", "Node", "Read",
+                   "Written", "Throttles", "Reorders", "Copied", "Sent");
             for (i = 0; i < num_nodes; i++) {
                 host = hosts[i];
                 rc = net_get_host_network_usage(thedb->handle_sibling, host,
                                                 &written, &read, &waits,
                                                 &reorders);
-                if (rc == 0)
-                    logmsg(LOGMSG_USER, "%20s %15llu %15llu %15llu %15llu\n", host, read,
-                           written, waits, reorders);
+                if (rc != 0)
+                    continue;
+                copied = sent = 0;
+                net_get_host_copy_usage(thedb->handle_sibling, host, &copied,
+                                        &sent);
+                logmsg(LOGMSG_USER, "%20s %15llu %15llu %15llu %15llu %15llu %15llu\n",
+                       host, read, written, waits, reorders, copied, sent);
             }
         }
     } else if (tokcmp(tok, ltok, "sc_del_unused_files_threshold") == 0) {
@@ -4875,6 +4889,20 @@ clipper_usage:
             bdb_blkseq_dumpall(thedb->bdb_env);
         } else if (tokcmp(tok, ltok, "logdel") == 0) {
             bdb_blkseq_dumplogs(thedb->bdb_env);
+        } else if (tokcmp(tok, ltok, "find") == 0) {
+            /* the lookup a retried request makes; keys are cnonces */
+            void *data = NULL;
+            int datalen = 0;
+            tok = segtok(line, lline, &st, &ltok);
+            if (ltok == 0) {
+                logmsg(LOGMSG_ERROR, "expected blkseq id\n");
+                return 0;
+            }
+            rc = bdb_blkseq_find(thedb->bdb_env, NULL, tok, ltok, &data,
+                                 &datalen);
+            logmsg(LOGMSG_USER, "blkseq %.*s %s\n", ltok, tok,
+                   rc == IX_FND ? "found" : "not found");
+            free(data);
         }
     } else if (tokcmp(tok, ltok, "panic") == 0) {
         bdb_panic(thedb->bdb_env);
@@ -566,6 +566,8 @@ int add_record(struct ireq *iq, void *trans, const uint8_t *p_buf_tag_name,
 
         if (reorder)
             rec_flags |= OSQL_ITEM_REORDERED;
+        else if (flags & RECFLAGS_SORTED_KEYS)
+            reorder = 1; /* schema change batch, keys added before commit */
 
         /* Form and add all the keys.
          * If there are constraints, do the add to indices deferred.
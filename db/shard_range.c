@@ -31,6 +31,7 @@ static Expr *_create_low(Parse *pParse, struct Token *col, int iColumn,
 static Expr *_create_high(Parse *pParse, struct Token *col, int iColumn,
                           ExprList *list, int shard);
 static int _colIndex(Table *pTab, const char *zCol);
+static char **_describe_limits(Parse *pParser, ExprList *list);
 
 #define GET_CLNT                                                               \
     struct sql_thread *thd = pthread_getspecific(query_info_key);              \
@@ -83,6 +84,10 @@ void shard_range_create(struct Parse *pParser, const char *tblname,
         db->sharding->high[i] =
             _create_high(pParser, col, iColumn, limits, i + 1);
     }
+
+    /* keep the split points as text; the expressions above belong to this
+     * parser's connection, the text can be used by any sql engine */
+    db->sharding->limits = _describe_limits(pParser, limits);
 }
 
 /* Destroy a range structure */
@@ -91,6 +96,49 @@ void shard_range_destroy(shard_limits_t *shards)
     /* TODO */
 }
 
+/* Sql predicate selecting the rows of shard "shard"; the first shard also
+ * picks up the NULLs, which sort before any split point */
+char *shard_range_predicate(shard_limits_t *shards, int shard)
+{
+    const char *col;
+
+    if (!shards || !shards->limits || shards->nlimits < 1 || shard < 0 ||
+        shard > shards->nlimits)
+        return NULL;
+
+    col = shards->col->z;
+    if (shard == 0)
+        return sqlite3_mprintf("(\"%w\" < %s OR \"%w\" IS NULL)", col,
+                               shards->limits[0], col);
+    if (shard == shards->nlimits)
+        return sqlite3_mprintf("\"%w\" >= %s", col,
+                               shards->limits[shard - 1]);
+    return sqlite3_mprintf("\"%w\" >= %s AND \"%w\" < %s", col,
+                           shards->limits[shard - 1], col,
+                           shards->limits[shard]);
+}
+
+/* Is there an index on pTab that a range predicate on the partition column
+ * can seek, i.e. one that starts with that column? */
+int shard_range_indexed(shard_limits_t *shards, Table *pTab)
+{
+    Index *pIdx;
+    int iColumn;
+
+    if (!shards || !shards->col || !pTab)
+        return 0;
+
+    iColumn = _colIndex(pTab, shards->col->z);
+    if (iColumn < 0)
+        return 0;
+
+    for (pIdx = pTab->pIndex; pIdx; pIdx = pIdx->pNext) {
+        if (pIdx->nKeyCol > 0 && pIdx->aiColumn[0] == iColumn)
+            return 1;
+    }
+    return 0;
+}
+
 /**
  * Check if the index with rootpage 'iTable' is configured for
  * parallelized workload, and make sure we have a shard
@@ -159,8 +207,9 @@ int comdb2_shard_table_constraints(Parse *pParser, const char *zName,
     Expr *pExprLeft, *pExprRight, *pExpr;
     struct Table *pTab;
 
-    /* is this is a parallel shard ? */
-    if (!clnt->conns /*|| (idx = clnt->conns_idx) < 1*/) {
+    /* is this is a parallel shard ? range splits generated by dohast
+     * already carry their predicate in the sql text */
+    if (!clnt->conns || idx < 1) {
         return SHARD_NOERR;
     }
 
@@ -242,6 +291,36 @@ static int _colIndex(Table *pTab, const char *zCol)
     return -1;
 }
 
+static char **_describe_limits(Parse *pParser, ExprList *list)
+{
+    Vdbe *v = sqlite3GetVdbe(pParser);
+    char **limits;
+    char *str;
+    int i;
+
+    if (!v || list->nExpr < 1)
+        return NULL;
+
+    limits = (char **)calloc(list->nExpr, sizeof(char *));
+    if (!limits)
+        return NULL;
+
+    for (i = 0; i < list->nExpr; i++) {
+        str = sqlite3ExprDescribe(v, list->a[i].pExpr);
+        if (!str || !(limits[i] = strdup(str)))
+            goto err;
+        sqlite3_free(str);
+    }
+    return limits;
+
+err:
+    sqlite3_free(str);
+    for (i = 0; i < list->nExpr; i++)
+        free(limits[i]);
+    free(limits);
+    return NULL;
+}
+
 static Expr *_create_low(Parse *pParser, struct Token *col, int iColumn,
                          ExprList *list, int shard)
 {
@@ -32,6 +32,7 @@ struct Expr;
 struct Token;
 struct ExprList;
 struct Parse;
+struct Table;
 
 /**
  * A range sharding uses row prefixes that match the index key structure.
@@ -46,6 +47,7 @@ struct shard_limits {
     struct Token *col;
     struct Expr **low;
     struct Expr **high;
+    char **limits; /* sql text of the nlimits split points, or NULL */
 };
 typedef struct shard_limits shard_limits_t;
 
@@ -56,6 +58,13 @@ void shard_range_create(struct Parse *pParser, const char *tblname,
 /* Destroy a range structure */
 void shard_range_destroy(shard_limits_t *shards);
 
+/* Sql predicate selecting the rows of shard "shard" (0 based, nlimits + 1
+ * shards); returned string is sqlite3_malloc-ed, NULL if not available */
+char *shard_range_predicate(shard_limits_t *shards, int shard);
+
+/* Does pTab have an index led by the partition column? */
+int shard_range_indexed(shard_limits_t *shards, struct Table *pTab);
+
 /* Merging concurrent rows */
 void shard_flush_conns(struct sqlclntstate *clnt, int waitfordone);
 
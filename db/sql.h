@@ -698,6 +698,8 @@ struct features {
     unsigned allow_master_exec : 1;
     unsigned allow_master_dbinfo : 1;
     unsigned queue_me : 1;
+    unsigned row_batch : 1;
+    unsigned row_batch_lz4 : 1;
 };
 
 struct clnt_fdb_cache;
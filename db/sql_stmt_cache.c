@@ -19,10 +19,23 @@
 #include "sql.h"
 #include "lrucache.h"
 #include "dohsql.h" // dohsql_wait_for_master()
+#include "comdb2_atomic.h"
 
 int gbl_max_sqlcache = 10;
 int gbl_enable_sql_stmt_caching = STMT_CACHE_ALL;
 
+/* When non-zero, the per-thread caches are no longer capped at
+ * max_sqlcache_per_thread entries each; instead all of them share this many
+ * bytes of prepared vdbes.  A thread over budget evicts its own coldest plans,
+ * and a thread still under its fair share is always allowed to cache. */
+int gbl_max_sqlcache_shared_mem = 0;
+
+static int stmt_cache_count;        /* live per-thread caches */
+static int64_t stmt_cache_shared_used; /* bytes held by all of them */
+static int64_t stmt_cache_hits;
+static int64_t stmt_cache_misses;
+static int64_t stmt_cache_evicts;
+
 extern int gbl_debug_temptables;
 static int stmt_cache_finalize_entry(stmt_cache_entry_t *entry, struct sqlclntstate *clnt);
 
@@ -35,6 +48,13 @@ static int query_data_func(struct sqlclntstate *clnt, void **data, int *sz,
         return 0;
 }
 
+static void stmt_cache_charge(stmt_cache_t *stmt_cache,
+                              stmt_cache_entry_t *entry, int sign)
+{
+    stmt_cache->memsz += sign * entry->memsz;
+    ATOMIC_ADD64(stmt_cache_shared_used, sign * entry->memsz);
+}
+
 static int stmt_cache_finalize_entry_cb(void *stmt_entry, void *args)
 {
     (void)args;
@@ -49,6 +69,10 @@ int stmt_cache_delete(stmt_cache_t *stmt_cache)
     hash_for(stmt_cache->hash, stmt_cache_finalize_entry_cb, NULL);
     hash_clear(stmt_cache->hash);
     hash_free(stmt_cache->hash);
+    /* everything still hashed was charged; in-use entries were not */
+    ATOMIC_ADD64(stmt_cache_shared_used, -stmt_cache->memsz);
+    stmt_cache->memsz = 0;
+    ATOMIC_ADD32(stmt_cache_count, -1);
     return 0;
 }
 
@@ -90,6 +114,8 @@ stmt_cache_t *stmt_cache_new(stmt_cache_t *in_stmt_cache)
                offsetof(stmt_cache_entry_t, lnk));
     listc_init(&(stmt_cache->noparam_stmt_list),
                offsetof(stmt_cache_entry_t, lnk));
+    stmt_cache->memsz = 0;
+    ATOMIC_ADD32(stmt_cache_count, 1);
     return stmt_cache;
 }
 
@@ -127,6 +153,7 @@ int stmt_cache_requeue_old_entry(stmt_cache_t *stmt_cache, stmt_cache_entry_t *e
 
     void *list = GET_STMT_LIST(stmt_cache, entry->stmt);
     listc_atl(list, entry);
+    stmt_cache_charge(stmt_cache, entry, 1);
 
     return 0;
 }
@@ -159,6 +186,8 @@ static int stmt_cache_delete_last_entry(stmt_cache_t *stmt_cache, void *list)
     if (rc) {
         logmsg(LOGMSG_ERROR, "%s:%d failed to delete entry (rc: %d)\n",
                __func__, __LINE__, rc);
+    } else {
+        stmt_cache_charge(stmt_cache, entry, -1);
     }
     stmt_cache_finalize_entry(entry, NULL);
     return rc;
@@ -176,7 +205,9 @@ static int stmt_cache_remove_entry(stmt_cache_t *stmt_cache,
 
     listc_maybe_rfl(list, entry);
     int rc = hash_del(stmt_cache->hash, entry->sql);
-    if (!noComplain && rc) {
+    if (rc == 0) {
+        stmt_cache_charge(stmt_cache, entry, -1);
+    } else if (!noComplain) {
         logmsg(LOGMSG_ERROR, "%s:%d failed to delete entry (rc: %d)\n",
                __func__, __LINE__, rc);
         return rc;
@@ -184,6 +215,30 @@ static int stmt_cache_remove_entry(stmt_cache_t *stmt_cache,
     return 0;
 }
 
+/* Evict this thread's least recently used plans until a new one of memsz
+ * bytes fits in max_sqlcache_shared_mem, or until this thread is back under its
+ * fair share of it.  Returns non-zero if the plan should not be cached. */
+static int stmt_cache_make_room(stmt_cache_t *stmt_cache, void *list, int memsz)
+{
+    int64_t budget = gbl_max_sqlcache_shared_mem;
+    int ncaches = ATOMIC_LOAD32(stmt_cache_count);
+    int64_t fair = budget / (ncaches > 0 ? ncaches : 1);
+
+    while (ATOMIC_LOAD64(stmt_cache_shared_used) + memsz > budget &&
+           stmt_cache->memsz + memsz > fair) {
+        if (listc_size(list) == 0) {
+            list = (list == (void *)&stmt_cache->param_stmt_list)
+                       ? (void *)&stmt_cache->noparam_stmt_list
+                       : (void *)&stmt_cache->param_stmt_list;
+            if (listc_size(list) == 0)
+                return -1;
+        }
+        stmt_cache_delete_last_entry(stmt_cache, list);
+        ATOMIC_ADD64(stmt_cache_evicts, 1);
+    }
+    return 0;
+}
+
 /* This will call stmt_cache_requeue_old_entry() after it has allocated memory for
  * the new entry. On error will return non zero and caller will need to
  * finalize_stmt(). */
@@ -209,14 +264,22 @@ int stmt_cache_add_new_entry(stmt_cache_t *stmt_cache, const char *sql,
 
     void *list = GET_STMT_LIST(stmt_cache, stmt);
 
+    int memsz = sizeof(stmt_cache_entry_t) +
+                sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_MEMUSED, 0);
+
     /* remove older entries to make room for new ones */
-    if (gbl_max_sqlcache <= listc_size(list)) {
+    if (gbl_max_sqlcache_shared_mem > 0) {
+        if (stmt_cache_make_room(stmt_cache, list, memsz))
+            return -1;
+    } else if (gbl_max_sqlcache <= listc_size(list)) {
         stmt_cache_delete_last_entry(stmt_cache, list);
+        ATOMIC_ADD64(stmt_cache_evicts, 1);
     }
 
     stmt_cache_entry_t *entry = sqlite3MallocZero(sizeof(stmt_cache_entry_t));
     strncpy(entry->sql, sql, MAX_HASH_SQL_LENGTH - 1);
     entry->stmt = stmt;
+    entry->memsz = memsz;
 
     /* In newsql, this function is a nop, leaving stmt_data and stmt_data_sz
      * uninitialized from malloc. We change the malloc to malloczero to ensure
@@ -482,6 +545,11 @@ int stmt_cache_get(struct sqlthdstate *thd, struct sqlclntstate *clnt,
         }
     }
 
+    if (rec->status & CACHE_FOUND_STMT)
+        ATOMIC_ADD64(stmt_cache_hits, 1);
+    else
+        ATOMIC_ADD64(stmt_cache_misses, 1);
+
     if (rec->stmt) {
         rec->sql = sqlite3_sql(rec->stmt); // save expanded query
         if ((prepFlags & PREPARE_ONLY) == 0) {
@@ -621,6 +689,25 @@ int stmt_cache_put(struct sqlthdstate *thd, struct sqlclntstate *clnt,
     return stmt_cache_put_distributed(thd, clnt, rec, outrc, 0);
 }
 
+void stmt_cache_dump_stats(void)
+{
+    logmsg(LOGMSG_USER, "statement caches    %d\n",
+           ATOMIC_LOAD32(stmt_cache_count));
+    if (gbl_max_sqlcache_shared_mem > 0)
+        logmsg(LOGMSG_USER, "shared memory       %" PRId64 " / %d bytes\n",
+               ATOMIC_LOAD64(stmt_cache_shared_used),
+               gbl_max_sqlcache_shared_mem);
+    else
+        logmsg(LOGMSG_USER, "cached memory       %" PRId64 " bytes\n",
+               ATOMIC_LOAD64(stmt_cache_shared_used));
+    logmsg(LOGMSG_USER, "hits                %" PRId64 "\n",
+           ATOMIC_LOAD64(stmt_cache_hits));
+    logmsg(LOGMSG_USER, "misses              %" PRId64 "\n",
+           ATOMIC_LOAD64(stmt_cache_misses));
+    logmsg(LOGMSG_USER, "evictions           %" PRId64 "\n",
+           ATOMIC_LOAD64(stmt_cache_evicts));
+}
+
 void stmt_cache_free_vdbe(sqlite3_stmt *stmt, struct sqlclntstate *clnt)
 {
     sqlite3_finalize(stmt); /* no-op on NULL */
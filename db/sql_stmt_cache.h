@@ -64,6 +64,8 @@ typedef struct stmt_cache_entry {
 
     plugin_query_data_func *qd_func; /* Pointer to the current client info */
 
+    int memsz; /* vdbe footprint charged to the shared budget */
+
     LINKC_T(struct stmt_cache_entry) lnk;
 } stmt_cache_entry_t;
 
@@ -73,6 +75,7 @@ typedef struct stmt_cache {
       lists is freed. */
     LISTC_T(stmt_cache_entry_t) param_stmt_list;
     LISTC_T(stmt_cache_entry_t) noparam_stmt_list;
+    int64_t memsz; /* bytes this cache holds of max_sqlcache_shared_mem */
 } stmt_cache_t;
 
 struct sql_state {
@@ -99,4 +102,5 @@ int stmt_cache_add_new_entry(stmt_cache_t *stmt_cache, const char *sql, const ch
                              struct sqlclntstate *clnt);
 int stmt_cache_requeue_old_entry(stmt_cache_t *, stmt_cache_entry_t *);
 void stmt_cache_free_vdbe(sqlite3_stmt *, struct sqlclntstate *);
+void stmt_cache_dump_stats(void);
 #endif /* !__INCLUDED_SQL_STMT_CACHE_H */
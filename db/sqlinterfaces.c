@@ -189,7 +189,7 @@ int gbl_sql_recover_time = 10;
 int gbl_debug_recover_deadlock_evbuffer = 0;
 int gbl_sql_row_delay_msecs = 0; /* testing delay per sql row, before sending the row */
 
-void rcache_init(size_t, size_t);
+void rcache_init(size_t, size_t, int);
 void rcache_destroy(void);
 void sql_reset_sqlthread(struct sql_thread *thd);
 int blockproc2sql_error(int rc, const char *func, int line);
@@ -4652,8 +4652,8 @@ static int execute_verify_indexes(struct sqlthdstate *thd, struct sqlclntstate *
         if (gbl_enable_internal_sql_stmt_caching) {
             if (cached_entry)
                 stmt_cache_requeue_old_entry(thd->stmt_cache, cached_entry);
-            else
-                stmt_cache_add_new_entry(thd->stmt_cache, clnt->sql, 0, stmt, clnt);
+            else if (stmt_cache_add_new_entry(thd->stmt_cache, clnt->sql, 0, stmt, clnt))
+                stmt_cache_free_vdbe(stmt, clnt);
         } else {
             stmt_cache_free_vdbe(stmt, clnt);
         }
@@ -4663,8 +4663,8 @@ static int execute_verify_indexes(struct sqlthdstate *thd, struct sqlclntstate *
     if (gbl_enable_internal_sql_stmt_caching) {
         if (cached_entry)
             stmt_cache_requeue_old_entry(thd->stmt_cache, cached_entry);
-        else
-            stmt_cache_add_new_entry(thd->stmt_cache, clnt->sql, 0, stmt, clnt);
+        else if (stmt_cache_add_new_entry(thd->stmt_cache, clnt->sql, 0, stmt, clnt))
+            stmt_cache_free_vdbe(stmt, clnt);
     } else {
         stmt_cache_free_vdbe(stmt, clnt);
     }
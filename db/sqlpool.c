@@ -21,7 +21,7 @@
 #include <util.h>
 #include "comdb2_query_preparer.h"
 
-extern void rcache_init(size_t, size_t);
+extern void rcache_init(size_t, size_t, int);
 extern void rcache_destroy(void);
 
 typedef struct pool_foreach_data {
@@ -54,7 +54,8 @@ void sqlengine_thd_start(struct thdpool *pool, struct sqlthdstate *thd,
 
     thd->sqlthd = pthread_getspecific(query_info_key);
     rcache_init(bdb_attr_get(thedb->bdb_attr, BDB_ATTR_RCACHE_COUNT),
-                bdb_attr_get(thedb->bdb_attr, BDB_ATTR_RCACHE_PGSZ));
+                bdb_attr_get(thedb->bdb_attr, BDB_ATTR_RCACHE_PGSZ),
+                bdb_attr_get(thedb->bdb_attr, BDB_ATTR_RCACHE_LEVELS));
 }
 
 void sqlengine_thd_end(struct thdpool *pool, struct sqlthdstate *thd)
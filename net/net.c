@@ -1031,12 +1031,26 @@ int net_send_authcheck_all(netinfo_type *netinfo_ptr)
 int net_send_flags(netinfo_type *netinfo_ptr, const char *host, int usertype,
                    void *data, int datalen, uint32_t flags)
 {
+    if (flags & NET_SEND_OWNED) {
+        return net_send_evbuffer(netinfo_ptr, host, usertype, data, datalen, 0,
+                                 NULL, NULL, flags);
+    }
     return net_send_int(netinfo_ptr, host, usertype, data, datalen,
                         (flags & NET_SEND_NODELAY), 0, NULL, 0,
                         (flags & NET_SEND_NODROP), (flags & NET_SEND_INORDER),
                         (flags & NET_SEND_TRACE));
 }
 
+void *net_msg_alloc(int usertype, int len)
+{
+    return net_msg_alloc_evbuffer(usertype, len);
+}
+
+void net_msg_free(void *buf)
+{
+    net_msg_free_evbuffer(buf);
+}
+
 int net_send(netinfo_type *netinfo_ptr, const char *host, int usertype,
              void *data, int datalen, int nodelay)
 {
@@ -3101,6 +3115,36 @@ int net_get_network_usage(netinfo_type *netinfo_ptr,
     return 0;
 }
 
+int net_get_host_copy_usage(netinfo_type *netinfo_ptr, const char *host,
+                            unsigned long long *copied,
+                            unsigned long long *sent)
+{
+    host_node_type *ptr;
+
+    Pthread_rwlock_rdlock(&(netinfo_ptr->lock));
+    for (ptr = netinfo_ptr->head; ptr != NULL; ptr = ptr->next) {
+        if (ptr->host == host)
+            break;
+    }
+    Pthread_rwlock_unlock(&(netinfo_ptr->lock));
+
+    if (ptr == NULL)
+        return -1;
+
+    *copied = ptr->stats.bytes_copied;
+    *sent = ptr->stats.bytes_sent;
+
+    return 0;
+}
+
+int net_get_copy_usage(netinfo_type *netinfo_ptr, unsigned long long *copied,
+                       unsigned long long *sent)
+{
+    *copied = netinfo_ptr->stats.bytes_copied;
+    *sent = netinfo_ptr->stats.bytes_sent;
+    return 0;
+}
+
 int get_host_port(netinfo_type *netinfo)
 {
     Pthread_rwlock_rdlock(&(netinfo->lock));
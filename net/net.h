@@ -97,7 +97,8 @@ enum {
     NET_SEND_NODROP = 0x00000002,
     NET_SEND_INORDER = 0x00000004,
     NET_SEND_TRACE = 0x00000008,
-    NET_SEND_LOGPUT = 0x00000010
+    NET_SEND_LOGPUT = 0x00000010,
+    NET_SEND_OWNED = 0x00000020 /* payload is from net_msg_alloc */
 };
 
 enum {
@@ -127,6 +128,13 @@ int net_send_message_payload_ack(netinfo_type *netinfo_ptr, const char *to_host,
                      int usertype, void *data, int datalen, uint8_t **payloadptr, 
                      int *payloadlen, int waitforack, int waitms);
 
+/* Allocate a payload buffer for a message of the given type and length.
+   Sending it with NET_SEND_OWNED queues it by reference rather than copying
+   it to every peer. The buffer must not be modified once sent; release it
+   with net_msg_free whether or not the send succeeded. */
+void *net_msg_alloc(int usertype, int len);
+void net_msg_free(void *buf);
+
 int net_send_flags(netinfo_type *netinfo,
                    const char *to_host, /* send to this node number */
                    int usertype, void *dta, int dtalen, uint32_t flags);
@@ -345,6 +353,13 @@ int net_get_network_usage(netinfo_type *netinfo_ptr,
                           unsigned long long *throttle_waits,
                           unsigned long long *reorders);
 
+int net_get_host_copy_usage(netinfo_type *netinfo_ptr, const char *host,
+                            unsigned long long *copied,
+                            unsigned long long *sent);
+
+int net_get_copy_usage(netinfo_type *netinfo_ptr, unsigned long long *copied,
+                       unsigned long long *sent);
+
 int net_get_queue_size(netinfo_type *netinfo_type, const char *host, int *limit,
                        int *usage);
 
@@ -1179,6 +1179,10 @@ static void writecb(int fd, short what, void *data)
             return;
         }
         e->sent_at = time(NULL);
+        if (e->host_node_ptr) {
+            e->host_node_ptr->stats.bytes_sent += rc;
+        }
+        e->net_info->netinfo_ptr->stats.bytes_sent += rc;
         Pthread_mutex_lock(&e->wr_lk);
         evbuffer_add_buffer(e->wr_buf, e->flush_buf);
         len = evbuffer_get_length(e->wr_buf);
@@ -3505,7 +3509,30 @@ struct shared_msg {
     uint8_t buf[0];
 };
 
-static struct shared_msg *shared_msg_new(void *buf, int len, int type)
+static void shared_msg_free(const void *unused0, size_t unused1, void *ptr)
+{
+    struct shared_msg *msg = ptr;
+    int ref = ATOMIC_ADD32(msg->ref, -1);
+    if (ref) {
+        return;
+    }
+    free(msg);
+}
+
+static void shared_msg_addref(struct shared_msg *msg)
+{
+    ATOMIC_ADD32(msg->ref, 1);
+}
+
+/* Owned buffers let a sender pack its payload straight into a shared_msg.
+ * Sending one with NET_SEND_OWNED queues a reference to it on each peer
+ * instead of a copy; the sender drops its own reference with net_msg_free. */
+static struct shared_msg *shared_msg_from_buf(void *buf)
+{
+    return (struct shared_msg *)((uint8_t *)buf - offsetof(struct shared_msg, buf));
+}
+
+void *net_msg_alloc_evbuffer(int type, int len)
 {
     struct shared_msg *msg = malloc(sizeof(struct shared_msg) + len);
     if (msg == NULL) {
@@ -3519,23 +3546,37 @@ static struct shared_msg *shared_msg_new(void *buf, int len, int type)
     };
     net_send_message_header *hdr = &msg->hdr;
     net_send_message_header_put(&tmp, (uint8_t *)hdr, (uint8_t *)(hdr + 1));
-    memcpy(&msg->buf, buf, len);
-    return msg;
+    return msg->buf;
 }
 
-static void shared_msg_free(const void *unused0, size_t unused1, void *ptr)
+static struct shared_msg *shared_msg_new(netinfo_type *netinfo_ptr, void *buf, int len, int type)
 {
-    struct shared_msg *msg = ptr;
-    int ref = ATOMIC_ADD32(msg->ref, -1);
-    if (ref) {
-        return;
+    void *payload = net_msg_alloc_evbuffer(type, len);
+    if (payload == NULL) {
+        return NULL;
     }
-    free(msg);
+    memcpy(payload, buf, len);
+    netinfo_ptr->stats.bytes_copied += len;
+    return shared_msg_from_buf(payload);
 }
 
-static void shared_msg_addref(struct shared_msg *msg)
+void net_msg_free_evbuffer(void *buf)
 {
-    ATOMIC_ADD32(msg->ref, 1);
+    if (buf) {
+        shared_msg_free(0, 0, shared_msg_from_buf(buf));
+    }
+}
+
+static struct shared_msg *shared_msg_owned(void *buf, int len, int type)
+{
+    struct shared_msg *msg = shared_msg_from_buf(buf);
+    net_send_message_header hdr;
+    net_send_message_header_get(&hdr, (uint8_t *)&msg->hdr, (uint8_t *)(&msg->hdr + 1));
+    if (hdr.usertype != type || hdr.datalen != len) {
+        return NULL;
+    }
+    shared_msg_addref(msg);
+    return msg;
 }
 
 static int addref_evbuffer(struct evbuffer *buf, struct event_info *e, int n, struct shared_msg **msg)
@@ -3574,6 +3615,10 @@ static int memcpy_evbuffer(struct evbuffer *flush_buf, struct event_info *e, int
         b += len[i];
     }
     evbuffer_commit_space(flush_buf, v, 1);
+    if (e->host_node_ptr) {
+        e->host_node_ptr->stats.bytes_copied += sz;
+    }
+    e->net_info->netinfo_ptr->stats.bytes_copied += sz;
     return 0;
 }
 
@@ -3882,7 +3927,9 @@ int write_list_evbuffer(host_node_type *host_node_ptr, int type, const struct io
     }
     if (rc==0) {
         e->net_info->netinfo_ptr->stats.bytes_written += total;
+        e->net_info->netinfo_ptr->stats.bytes_copied += total;
         host_node_ptr->stats.bytes_written += total;
+        host_node_ptr->stats.bytes_copied += total;
         update_host_net_queue_stats(host_node_ptr, 1, total);
     }
     Pthread_mutex_unlock(&e->wr_lk);
@@ -3897,25 +3944,33 @@ int net_send_all_evbuffer(netinfo_type *netinfo_ptr, int n, void **buf, int *len
     int nodrop = 0;
     int nodelay = 0;
     int logput = 0;
+    int owned = 0;
     int sz = (n * NET_SEND_MESSAGE_HEADER_LEN);
     for (int i = 0; i < n; ++i) {
         sz += len[i];
         nodrop |= flags[i] & NET_SEND_NODROP;
         nodelay |= flags[i] & NET_SEND_NODELAY;
         logput |= flags[i] & NET_SEND_LOGPUT;
+        owned |= flags[i] & NET_SEND_OWNED;
     }
     struct shared_msg **msg = NULL;
-    if (sz > KB(1)) {
+    if (owned || sz > KB(1)) {
         msg = alloca(sizeof(struct shared_msg *) * n);
         int i;
         for (i = 0; i < n; ++i) {
-            if ((msg[i] = shared_msg_new(buf[i], len[i], type[i])) == NULL) break;
+            if (flags[i] & NET_SEND_OWNED) {
+                msg[i] = shared_msg_owned(buf[i], len[i], type[i]);
+            } else {
+                msg[i] = shared_msg_new(netinfo_ptr, buf[i], len[i], type[i]);
+            }
+            if (msg[i] == NULL) break;
         }
         if (i < n) {
+            int rc = (flags[i] & NET_SEND_OWNED) ? NET_SEND_FAIL_INTERNAL : NET_SEND_FAIL_MALLOC_FAIL;
             for (int j = 0; j < i; ++j) {
                 shared_msg_free(0, 0, msg[j]);
             }
-            return NET_SEND_FAIL_MALLOC_FAIL;
+            return rc;
         }
     }
     struct net_info *ni = netinfo_ptr->net_info;
@@ -3962,25 +4017,9 @@ int net_flush_evbuffer(host_node_type *host_node_ptr)
     return 0;
 }
 
-int net_send_evbuffer(netinfo_type *netinfo_ptr, const char *host,
-                         int usertype, void *data, int datalen, int numtails,
-                         void **tails, int *taillens, int flags)
+static int write_iov_evbuffer(host_node_type *host_node_ptr, int usertype, void *data, int datalen,
+                              int numtails, void **tails, int *taillens, int write_flags)
 {
-    if (net_stop) {
-        return 0;
-    }
-    char key[EVENT_HASH_KEY_SZ];
-    make_event_hash_key(key, netinfo_ptr->service, host);
-    Pthread_mutex_lock(&event_hash_lk);
-    struct event_hash_entry *obj = hash_find(event_hash, key);
-    Pthread_mutex_unlock(&event_hash_lk);
-    if (!obj) {
-        return NET_SEND_FAIL_INVALIDNODE;
-    }
-    struct event_info *e = obj->e;
-    if (strcmp(e->host, gbl_myhostname) == 0) {
-        return NET_SEND_FAIL_SENDTOME;
-    }
     int n = numtails + 1;
     if (data && datalen) {
         ++n;
@@ -4006,9 +4045,70 @@ int net_send_evbuffer(netinfo_type *netinfo_ptr, const char *host,
     net_send_message_header_put(&tmp, (uint8_t *)&hdr, (uint8_t *)(&hdr + 1));
     iov[0].iov_base = &hdr;
     iov[0].iov_len = sizeof(hdr);
+    return write_list_evbuffer(host_node_ptr, WIRE_HEADER_USER_MSG, iov, n, write_flags);
+}
+
+static int write_shared_evbuffer(host_node_type *host_node_ptr, struct shared_msg *msg, int flags)
+{
+    if (net_stop) {
+        return 0;
+    }
+    int rc;
+    int nodrop = flags & WRITE_MSG_NOLIMIT;
+    int nodelay = flags & WRITE_MSG_NODELAY;
+    struct event_info *e = host_node_ptr->event_info;
+    int total = e->wirehdr_len + msg->sz;
+    Pthread_mutex_lock(&e->wr_lk);
+    if (!e->flush_buf) {
+       rc = -3;
+    } else if ((rc = skip_send(e, nodrop, 0)) == 0) {
+        if ((rc = addref_evbuffer(e->flush_buf, e, 1, &msg)) == 0) {
+            flush_evbuffer(e, nodelay);
+        } else {
+            rc = -1;
+        }
+    }
+    if (rc==0) {
+        e->net_info->netinfo_ptr->stats.bytes_written += total;
+        host_node_ptr->stats.bytes_written += total;
+        update_host_net_queue_stats(host_node_ptr, 1, total);
+    }
+    Pthread_mutex_unlock(&e->wr_lk);
+    return rc;
+}
+
+int net_send_evbuffer(netinfo_type *netinfo_ptr, const char *host,
+                         int usertype, void *data, int datalen, int numtails,
+                         void **tails, int *taillens, int flags)
+{
+    if (net_stop) {
+        return 0;
+    }
+    char key[EVENT_HASH_KEY_SZ];
+    make_event_hash_key(key, netinfo_ptr->service, host);
+    Pthread_mutex_lock(&event_hash_lk);
+    struct event_hash_entry *obj = hash_find(event_hash, key);
+    Pthread_mutex_unlock(&event_hash_lk);
+    if (!obj) {
+        return NET_SEND_FAIL_INVALIDNODE;
+    }
+    struct event_info *e = obj->e;
+    if (strcmp(e->host, gbl_myhostname) == 0) {
+        return NET_SEND_FAIL_SENDTOME;
+    }
     int write_flags = flags & NET_SEND_NODROP ? WRITE_MSG_NOLIMIT : 0;
     write_flags |= flags & NET_SEND_NODELAY ? WRITE_MSG_NODELAY : 0;
-    int rc = write_list_evbuffer(e->host_node_ptr, WIRE_HEADER_USER_MSG, iov, n, write_flags);
+    int rc;
+    if (flags & NET_SEND_OWNED) {
+        struct shared_msg *msg;
+        if (numtails || (msg = shared_msg_owned(data, datalen, usertype)) == NULL) {
+            return NET_SEND_FAIL_INTERNAL;
+        }
+        rc = write_shared_evbuffer(e->host_node_ptr, msg, write_flags);
+        shared_msg_free(0, 0, msg);
+    } else {
+        rc = write_iov_evbuffer(e->host_node_ptr, usertype, data, datalen, numtails, tails, taillens, write_flags);
+    }
     switch (rc) {
     case  0: return 0;
     case -1: return NET_SEND_FAIL_MALLOC_FAIL;
@@ -135,6 +135,8 @@ typedef struct {
     unsigned long long bytes_read;
     unsigned long long throttle_waits;
     unsigned long long reorders;
+    unsigned long long bytes_copied; /* payload memcpy'd into send buffers */
+    unsigned long long bytes_sent;   /* written to the socket */
 } stats_type;
 
 typedef struct net_send_message_header {
@@ -353,6 +355,8 @@ int write_hello(netinfo_type *, host_node_type *);
 int write_hello_reply(netinfo_type *, host_node_type *);
 int write_list_evbuffer(host_node_type *, int, const struct iovec *, int, int);
 int net_send_evbuffer(netinfo_type *, const char *, int, void *, int, int, void **, int *, int);
+void *net_msg_alloc_evbuffer(int, int);
+void net_msg_free_evbuffer(void *);
 
 enum net_metric_type {
     NET_DROPS = 1,
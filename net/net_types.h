@@ -176,6 +176,7 @@ enum {
     NET_OSQL_MASTER_CHECKED_UUID = 168,
     NET_OSQL_SOCK_REQ_COST_UUID = 169,
     NET_AUTHENTICATION_CHECK = 170,
+    NET_OSQL_BATCH_RPL_UUID = 171, /* several bplog ops of one session */
     NET_OSQL_UUID_REQUEST_MAX,
     USER_TYPE_MAX = NET_OSQL_UUID_REQUEST_MAX
 };
@@ -30,6 +30,11 @@
 #include "sqlquery.pb-c.h"
 #include "newsql.h"
 #include "cheapstack.h"
+#include <lz4.h>
+
+#if LZ4_VERSION_NUMBER < 10701
+#define LZ4_compress_default LZ4_compress_limitedOutput
+#endif
 
 #ifdef COMDB2_TEST
 #include "debug_switches.h"
@@ -386,9 +391,14 @@ static inline int newsql_to_client_type(int newsql_type)
         return -1;
     }
 }
+static int newsql_flush_row_batch(struct sqlclntstate *);
+
 static int newsql_response_int(struct sqlclntstate *clnt, const CDB2SQLRESPONSE *r, int h, int flush)
 {
     struct newsql_appdata *appdata = clnt->appdata;
+    if (appdata->row_batch.nrows && newsql_flush_row_batch(clnt) != 0) {
+        return -1;
+    }
     clnt->lastresptype = r->response_type;
     return appdata->write(clnt, h, 0, r, flush); /* newsql_write_evbuffer */
 }
@@ -702,6 +712,121 @@ int endianness_mismatch(struct sqlclntstate *clnt) {
     return 0;
 }
 
+/* Once a result set has sent gbl_sql_row_batch_min_rows rows one response at
+ * a time, clients which advertise ROW_BATCH get the rest packed many rows to a
+ * response. This skips the per-row protobuf pack and framing, and lets the
+ * batch be lz4 compressed as a whole. */
+int gbl_sql_row_batch_min_rows = 1000;
+int gbl_sql_row_batch_bytes = 65536;
+int gbl_sql_row_batch_lz4 = 1;
+
+static int newsql_can_batch_row(struct sqlclntstate *clnt, struct response_data *arg, int postpone)
+{
+    return gbl_sql_row_batch_min_rows > 0 && clnt->features.row_batch && clnt->rowbuffer && !postpone &&
+           !arg->pingpong && !clnt->sqlite_row_format && arg->row_id > gbl_sql_row_batch_min_rows;
+}
+
+static uint8_t *newsql_put_varint(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = v | 0x80;
+        v >>= 7;
+    }
+    *p++ = v;
+    return p;
+}
+
+static int newsql_flush_row_batch(struct sqlclntstate *clnt)
+{
+    struct newsql_appdata *appdata = clnt->appdata;
+    struct newsql_row_batch *b = &appdata->row_batch;
+    if (b->nrows == 0) {
+        return 0;
+    }
+    CDB2SQLRESPONSE r = CDB2__SQLRESPONSE__INIT;
+    r.response_type = RESPONSE_TYPE__ROW_BATCH;
+    r.has_row_batch = 1;
+    r.row_batch.data = b->buf;
+    r.row_batch.len = b->len;
+    r.has_row_batch_count = 1;
+    r.row_batch_count = b->nrows;
+    if (clnt->num_retry) {
+        r.has_row_id = 1;
+        r.row_id = b->row_id;
+    }
+    if (clnt->features.row_batch_lz4 && gbl_sql_row_batch_lz4) {
+        int bound = LZ4_compressBound(b->len);
+        if (bound > b->zcapacity) {
+            char *zbuf = realloc(b->zbuf, bound);
+            if (zbuf) {
+                b->zbuf = zbuf;
+                b->zcapacity = bound;
+            }
+        }
+        int zlen = 0;
+        if (bound <= b->zcapacity) {
+            zlen = LZ4_compress_default((const char *)b->buf, b->zbuf, b->len, b->zcapacity);
+        }
+        if (zlen > 0 && zlen < b->len) {
+            r.row_batch.data = (uint8_t *)b->zbuf;
+            r.row_batch.len = zlen;
+            r.has_row_batch_len = 1;
+            r.row_batch_len = b->len;
+        }
+    }
+    b->len = 0;
+    b->nrows = 0;
+    return newsql_response(clnt, &r, !clnt->rowbuffer);
+}
+
+static int newsql_batch_row(struct sqlclntstate *clnt, uint64_t row_id, CDB2SQLRESPONSE__Column *cols, int ncols)
+{
+    struct newsql_appdata *appdata = clnt->appdata;
+    struct newsql_row_batch *b = &appdata->row_batch;
+    size_t need = 0;
+    for (int i = 0; i < ncols; ++i) {
+        need += 10 + cols[i].value.len;
+    }
+    if (b->len + need > b->capacity) {
+        size_t capacity = b->capacity ? b->capacity : gbl_sql_row_batch_bytes;
+        while (capacity < b->len + need) {
+            capacity *= 2;
+        }
+        uint8_t *buf = realloc(b->buf, capacity);
+        if (buf == NULL) {
+            return -1;
+        }
+        b->buf = buf;
+        b->capacity = capacity;
+    }
+    if (b->nrows == 0) {
+        b->row_id = row_id;
+    }
+    uint8_t *p = b->buf + b->len;
+    for (int i = 0; i < ncols; ++i) {
+        if (cols[i].has_isnull && cols[i].isnull) {
+            *p++ = 0;
+            continue;
+        }
+        p = newsql_put_varint(p, cols[i].value.len + 1);
+        memcpy(p, cols[i].value.data, cols[i].value.len);
+        p += cols[i].value.len;
+    }
+    b->len = p - b->buf;
+    ++b->nrows;
+    if (b->len >= gbl_sql_row_batch_bytes) {
+        return newsql_flush_row_batch(clnt);
+    }
+    return 0;
+}
+
+static void newsql_discard_row_batch(struct sqlclntstate *clnt)
+{
+    struct newsql_appdata *appdata = clnt->appdata;
+    appdata->row_batch.len = 0;
+    appdata->row_batch.nrows = 0;
+}
+
 static int newsql_row(struct sqlclntstate *clnt, struct response_data *arg,
                       int postpone)
 {
@@ -808,6 +933,9 @@ static int newsql_row(struct sqlclntstate *clnt, struct response_data *arg,
         if (clnt->flat_col_vals)
             bd[i] = cols[i].value;
     }
+    if (newsql_can_batch_row(clnt, arg, postpone)) {
+        return newsql_batch_row(clnt, arg->row_id, cols, ncols);
+    }
     CDB2SQLRESPONSE r = CDB2__SQLRESPONSE__INIT;
     r.response_type = RESPONSE_TYPE__COLUMN_VALUES;
     if (clnt->flat_col_vals) {
@@ -2528,6 +2656,7 @@ void newsql_reset(struct sqlclntstate *clnt)
                   from the sockpool. */
         handle_sql_intrans_unrecoverable_error(clnt);
     }
+    newsql_discard_row_batch(clnt);
     reset_clnt(clnt, 0);
     clnt->tzname[0] = 0;
     clnt->osql.count_changes = 1;
@@ -2544,6 +2673,9 @@ void free_newsql_appdata(struct sqlclntstate *clnt)
         free(appdata->postponed);
         appdata->postponed = NULL;
     }
+    free(appdata->row_batch.buf);
+    free(appdata->row_batch.zbuf);
+    memset(&appdata->row_batch, 0, sizeof(appdata->row_batch));
     free(appdata->col_info.type);
 }
 
@@ -2966,6 +3098,12 @@ void dump_response(const CDB2SQLRESPONSE *r) {
         dump(depth, "sqlite_row: ");
         dump_value(0, &r->sqlite_row);
     }
+    if (r->has_row_batch_count) {
+        dump(depth, "row_batch_count=%d\n", r->row_batch_count);
+    }
+    if (r->has_row_batch_len) {
+        dump(depth, "row_batch_len=%d\n", r->row_batch_len);
+    }
     depth--;
     dump(depth, "}\n");
 }
@@ -49,6 +49,17 @@ struct newsql_postponed_data {
     uint8_t *row;
 };
 
+/* rows waiting to go out as a single ROW_BATCH response */
+struct newsql_row_batch {
+    uint8_t *buf;
+    size_t len;
+    size_t capacity;
+    int nrows;
+    uint64_t row_id; /* of the first row in buf */
+    char *zbuf;
+    int zcapacity;
+};
+
 typedef enum {
     NEWSQL_PROTOCOL_ORIGINAL,
     NEWSQL_PROTOCOL_COMPAT
@@ -66,6 +77,7 @@ typedef enum {
     int8_t send_intrans_response;                                              \
     int8_t protocol_version;                                              \
     struct newsql_postponed_data *postponed;                                   \
+    struct newsql_row_batch row_batch;                                         \
     struct sql_col_info col_info;
 
 void newsql_setup_clnt(struct sqlclntstate *);
@@ -717,6 +717,8 @@ static void process_features(struct newsql_appdata_evbuffer *appdata) {
         case CDB2_CLIENT_FEATURES__ALLOW_MASTER_EXEC: clnt->features.allow_master_exec = 1; break;
         case CDB2_CLIENT_FEATURES__ALLOW_MASTER_DBINFO: clnt->features.allow_master_dbinfo = 1; break;
         case CDB2_CLIENT_FEATURES__ALLOW_QUEUING: clnt->features.queue_me = 1; break;
+        case CDB2_CLIENT_FEATURES__ROW_BATCH: clnt->features.row_batch = 1; break;
+        case CDB2_CLIENT_FEATURES__ROW_BATCH_LZ4: clnt->features.row_batch_lz4 = 1; break;
         }
     }
 }
@@ -37,8 +37,10 @@
 #include "debug_switches.h"
 #include "localrep.h"
 #include "views.h"
+#include "block_internal.h"
 
 int gbl_logical_live_sc = 0;
+int gbl_sc_sorted_index_build = 0;
 
 extern __thread snap_uid_t *osql_snap_info; /* contains cnonce */
 extern int gbl_partial_indexes;
@@ -352,9 +354,14 @@ void convert_record_data_cleanup(struct convert_record_data *data)
 {
 
     if (data->trans) {
+        /* rewind an unfinished batch before its locks are released */
+        if (data->nbatch)
+            data->sc_genids[data->stripe] = data->batch_genid;
         trans_abort(&data->iq, data->trans);
         data->trans = NULL;
     }
+    if (data->sorted_keys)
+        delete_defered_index_tbl();
     if (data->dmp) {
         bdb_dtadump_done(data->from->handle, data->dmp);
         data->dmp = NULL;
@@ -410,7 +417,7 @@ static void delay_sc_if_needed(struct convert_record_data *data,
     int rc;
 
     /* wait for replication on what we just committed */
-    if ((data->nrecs % data->num_records_per_trans) == 0) {
+    if (data->nbatch || (data->nrecs % data->num_records_per_trans) == 0) {
         if ((rc = trans_wait_for_seqnum(&data->iq, gbl_myhostname, ss)) != 0) {
             sc_errf(data->s, "delay_sc_if_needed: error waiting for replication rcode %d\n", rc);
         } else if (gbl_sc_inco_chk) { /* committed successfully */
@@ -654,6 +661,61 @@ static void increment_sc_logbytes(int64_t bytes)
     Pthread_mutex_unlock(&sc_bps_lk);
 }
 
+/* abort the convert transaction; an open sorted batch is dropped with it,
+ * so the stripe pointer goes back to where the batch started (before the
+ * abort releases the locks writers are waiting on) */
+static void abort_sc_trans(struct convert_record_data *data, int64_t estimate)
+{
+    int64_t logbytes = bdb_tran_logbytes(data->trans);
+
+    if (data->nbatch) {
+        data->sc_genids[data->stripe] = data->batch_genid;
+        data->nrecs -= data->nbatch;
+        data->nbatch = 0;
+    }
+    if (data->batch_sorted)
+        truncate_defered_index_tbl();
+    increment_sc_logbytes(logbytes - estimate - data->batch_estimate);
+    data->batch_estimate = 0;
+    trans_abort(&data->iq, data->trans);
+    data->trans = NULL;
+}
+
+/* add the index keys of the open batch, in key order */
+static int flush_sorted_keys(struct convert_record_data *data)
+{
+    struct dbtable *usedb = data->iq.usedb;
+    int blkpos = 0, ixfailnum = -1, opfailcode = 0, rc;
+
+    rc = process_defered_table(&data->iq, data->trans, &blkpos, &ixfailnum,
+                               &opfailcode);
+    data->iq.usedb = usedb;
+    if (rc && rc != RC_INTERNAL_RETRY)
+        sc_errf(data->s, "[%s] adding sorted keys failed stripe %d index %d rc %d\n", data->from->tablename,
+                data->stripe, ixfailnum, rc);
+    return rc;
+}
+
+static int sorted_keys_failed(struct convert_record_data *data, int rc,
+                              int64_t estimate)
+{
+    abort_sc_trans(data, estimate);
+    if (rc == RC_INTERNAL_RETRY) {
+        data->num_retry_errors++;
+        data->totnretries++;
+        poll(0, 0, (rand() % 500 + 10));
+        return 1;
+    } else if (rc == IX_DUP) {
+        /* redo the batch a record at a time; that path knows which record
+         * is the duplicate and whether it can be skipped */
+        data->nsingle = data->num_records_per_trans;
+        return 1;
+    }
+    sc_client_error(data->s, "Error adding sorted keys rcode %d stripe %d", rc,
+                    data->stripe);
+    return -2;
+}
+
 /* converts a single record and prepares for the next one
  * should be called from a while loop
  * param data: pointer to all the state information
@@ -665,7 +727,6 @@ static int convert_record(struct convert_record_data *data)
 {
     int dtalen = 0, rc, rrn, opfailcode = 0, ixfailnum = 0;
     unsigned long long genid, ngenid, check_genid;
-    int64_t logbytes = 0;
     void *dta = NULL;
     int no_wait_rowlock = 0;
     int64_t estimate = 0;
@@ -678,12 +739,16 @@ static int convert_record(struct convert_record_data *data)
             sc_errf(data->s,
                     "Stoping work on stripe %d because the thread for stripe %d failed\n",
                     data->stripe, data->s->sc_thd_failed - 1);
+        if (data->batch_sorted && data->trans)
+            abort_sc_trans(data, 0);
         return -1;
     }
 
     if (gbl_sc_abort || data->from->sc_abort ||
         (data->s->iq && data->s->iq->sc_should_abort)) {
         sc_client_error(data->s, "Schema change aborted");
+        if (data->batch_sorted && data->trans)
+            abort_sc_trans(data, 0);
         return -1;
     }
     if (tbl_had_writes(data)) {
@@ -703,6 +768,8 @@ static int convert_record(struct convert_record_data *data)
             sc_errf(data->s, "Error %d starting transaction\n", rc);
             return -2;
         }
+        data->batch_sorted = data->sorted_keys && data->nsingle == 0;
+        data->batch_genid = data->sc_genids[data->stripe];
     }
 
     data->iq.debug = debug_this_request(gbl_debug_until);
@@ -788,6 +855,13 @@ static int convert_record(struct convert_record_data *data)
              * the the left of SC pointer. This works because we now hold
              * a lock to the last page of the stripe.
              */
+            if (data->nbatch) {
+                /* the caller commits what is left of the batch */
+                if ((rc = flush_sorted_keys(data)) != 0)
+                    return sorted_keys_failed(data, rc, 0);
+                ATOMIC_ADD64(data->from->sc_nrecs, data->nbatch);
+                data->nbatch = 0;
+            }
 
             if (data->s->logical_livesc) {
                 data->s->sc_convert_done[data->stripe] = 1;
@@ -827,8 +901,7 @@ static int convert_record(struct convert_record_data *data)
             }
             return rc;
         } else if (rc == RC_INTERNAL_RETRY) {
-            trans_abort(&data->iq, data->trans);
-            data->trans = NULL;
+            abort_sc_trans(data, 0);
 
             data->totnretries++;
             if (data->cmembers->is_decrease_thrds)
@@ -936,8 +1009,7 @@ static int convert_record(struct convert_record_data *data)
             data->blobix, data->blb.bloblens, data->blb.bloboffs,
             (void **)data->blb.blobptrs, &args, &bdberr);
         if (blobrc != 0 && bdberr == BDBERR_DEADLOCK) {
-            trans_abort(&data->iq, data->trans);
-            data->trans = NULL;
+            abort_sc_trans(data, 0);
             data->totnretries++;
             if (data->cmembers->is_decrease_thrds)
                 decrease_max_threads(&data->cmembers->maxthreads);
@@ -1020,6 +1092,9 @@ static int convert_record(struct convert_record_data *data)
     int addflags = RECFLAGS_NO_TRIGGERS | RECFLAGS_NO_CONSTRAINTS |
                    RECFLAGS_NEW_SCHEMA | RECFLAGS_KEEP_GENID;
 
+    if (data->batch_sorted)
+        addflags |= RECFLAGS_SORTED_KEYS;
+
     if (data->to->plan && gbl_use_plan) addflags |= RECFLAGS_NO_BLOBS;
 
     char *tagname = ".NEW..ONDISK";
@@ -1120,10 +1195,7 @@ err:
                    "waiting for logical redo to catch up at [%u:%u]\n",
                    __func__, ngenid, data->stripe, data->cv_wait_lsn.file,
                    data->cv_wait_lsn.offset);
-            logbytes = bdb_tran_logbytes(data->trans);
-            increment_sc_logbytes(logbytes - estimate);
-            trans_abort(&data->iq, data->trans);
-            data->trans = NULL;
+            abort_sc_trans(data, estimate);
             poll(0, 0, 200);
             return 1;
         }
@@ -1131,19 +1203,13 @@ err:
 
     if (gbl_sc_abort || data->from->sc_abort ||
         (data->s->iq && data->s->iq->sc_should_abort)) {
-        logbytes = bdb_tran_logbytes(data->trans);
-        increment_sc_logbytes(logbytes - estimate);
-        trans_abort(&data->iq, data->trans);
-        data->trans = NULL;
+        abort_sc_trans(data, estimate);
         return -1;
     }
 
     /* if we should retry the operation */
     if (rc == RC_INTERNAL_RETRY) {
-        logbytes = bdb_tran_logbytes(data->trans);
-        increment_sc_logbytes(logbytes - estimate);
-        trans_abort(&data->iq, data->trans);
-        data->trans = NULL;
+        abort_sc_trans(data, estimate);
         data->num_retry_errors++;
         data->totnretries++;
         if (!no_wait_rowlock && data->cmembers->is_decrease_thrds)
@@ -1162,10 +1228,7 @@ err:
             sc_errf(data->s, "Skipping duplicate entry in index %d rrn %d genid 0x%llx\n",
                     ixfailnum, rrn, genid);
             data->sc_genids[data->stripe] = genid;
-            logbytes = bdb_tran_logbytes(data->trans);
-            increment_sc_logbytes(logbytes - estimate);
-            trans_abort(&data->iq, data->trans);
-            data->trans = NULL;
+            abort_sc_trans(data, estimate);
             return 1;
         }
 
@@ -1191,6 +1254,18 @@ err:
         data->sc_genids[data->stripe] = genid;
     }
 
+    if (data->batch_sorted) {
+        /* keep the transaction open until the batch is full */
+        if (++data->nbatch < data->num_records_per_trans) {
+            data->batch_estimate += estimate;
+            return 1;
+        }
+        if ((rc = flush_sorted_keys(data)) != 0)
+            return sorted_keys_failed(data, rc, estimate);
+    } else if (data->nsingle > 0) {
+        data->nsingle--;
+    }
+
     // now do the commit
     db_seqnum_type ss;
     if (data->live) {
@@ -1198,7 +1273,8 @@ err:
     } else {
         rc = trans_commit(&data->iq, data->trans, gbl_myhostname);
     }
-    increment_sc_logbytes(data->iq.txnsize - estimate);
+    increment_sc_logbytes(data->iq.txnsize - estimate - data->batch_estimate);
+    data->batch_estimate = 0;
 
     data->trans = NULL;
 
@@ -1211,7 +1287,8 @@ err:
     if (data->live)
         delay_sc_if_needed(data, &ss);
 
-    ATOMIC_ADD64(data->from->sc_nrecs, 1);
+    ATOMIC_ADD64(data->from->sc_nrecs, data->batch_sorted ? data->nbatch : 1);
+    data->nbatch = 0;
 
     if (data->s->iq->sorese != NULL) {
         /* ddl schema change, update its effects */
@@ -1281,6 +1358,12 @@ static void *convert_records_thd(struct convert_record_data *data)
     data->num_records_per_trans = gbl_num_record_converts;
     data->num_retry_errors = 0;
 
+    /* a failed batch is rescanned from the genid it started at, which needs
+     * a genid ordered scan; logical live sc redo relies on records being
+     * converted one at a time */
+    data->sorted_keys = gbl_sc_sorted_index_build && data->num_records_per_trans > 1 &&
+                        data->scanmode == SCAN_PARALLEL && !data->s->logical_livesc;
+
     if (gbl_pg_compact_thresh > 0) {
         /* Disable page compaction only if page compaction is enabled. */
         Pthread_setspecific(no_pgcompact, (void *)1);
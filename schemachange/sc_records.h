@@ -85,6 +85,14 @@ struct convert_record_data {
                                     constraint violation on */
     LISTC_T(struct redo_genid_lsns) redo_lsns;
     hash_t *redo_genids;
+    /* sorted keys mode: a transaction converts a batch of records and
+     * inserts their index keys in key order right before it commits */
+    int sorted_keys;                /* allowed for this scan */
+    int batch_sorted;               /* the open transaction is a batch */
+    int nbatch;                     /* records in the open batch */
+    int nsingle;                    /* convert these one by one (after dup) */
+    unsigned long long batch_genid; /* stripe pointer before the batch */
+    int64_t batch_estimate;         /* log bytes throttled for the batch */
 };
 
 int convert_all_records(struct dbtable *from, struct dbtable *to,
@@ -36,6 +36,7 @@
 
 #include <errno.h>
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -44,9 +45,9 @@
 #include <strings.h>
 #include <unistd.h>
 
+#include <comdb2_atomic.h>
 #include <plhash_glue.h>
 #include <list.h>
-#include <pool.h>
 #include <passfd.h>
 #include <syslog.h>
 #include <sys_wrap.h>
@@ -59,6 +60,8 @@
 #define DBG(x)
 #endif
 
+/* Guards sockpool_fd, our connection to the machine wide sockpool.  The
+ * local pool itself is protected by the per shard locks below. */
 pthread_mutex_t sockpool_lk = PTHREAD_MUTEX_INITIALIZER;
 
 /* This bit gets set by sockpool.tsk when it starts up to indicate that it is
@@ -98,11 +101,12 @@ struct item {
     int donation_time; /* epoch time of donation */
     fd_destructor_fn destructor;
     void *destructor_arg;
+    enum socket_pool_event dead_event; /* set once retired to dead_list */
 
     /* Link in list of items for the item type. */
     LINKC_T(struct item) typestr_items_linkv;
 
-    /* Link in lru list of all items. */
+    /* Link in lru list of all items in the shard, or in its dead list. */
     LINKC_T(struct item) lru_linkv;
 
     /* Chain back to parent. */
@@ -118,16 +122,44 @@ struct itemtype {
     char typestr[1]; /* must be last thing in struct; this is hash table key */
 };
 
-static hash_t *hash = NULL;
-static pool_t *pool = NULL;
-static struct stats stats;
-static const struct stats empty_stats = {0};
+/* The pool is split into shards keyed on a hash of the type string, so that
+ * threads pooling sockets for different databases don't all queue up on the
+ * same mutex.  max_active_fds applies to the pool as a whole: a shard may
+ * hold more than an equal share while the others leave theirs unused, and
+ * gives the excess back once the pool fills up (see socket_pool_reclaim()).
+ *
+ * Items which get discarded while a shard is locked are moved to its dead
+ * list, and their destructors are only run once the shard lock has been
+ * released (see shard_unlock()).  Destructors close sockets or pass them on
+ * to sockpool, neither of which we want to do while blocking lookups.
+ * n_reaping counts threads still running destructors for a shard's items;
+ * socket_pool_free_all() waits for it to drain before freeing item types. */
+struct shard {
+    pthread_mutex_t lk;
+    hash_t *hash;
+    /* List of active file descriptors; bottom of list is most recently
+     * added */
+    LISTC_T(struct item) lru_list;
+    /* Items waiting for their destructor to be called */
+    LISTC_T(struct item) dead_list;
+    unsigned n_reaping;
+    struct stats stats;
+};
+
+#define SOCKET_POOL_MAX_SHARDS 64
 
-/* List of active file descriptors; bottom of list is most recently added */
-static LISTC_T(struct item) lru_list;
+static struct shard shards[SOCKET_POOL_MAX_SHARDS];
+static pthread_once_t shards_once = PTHREAD_ONCE_INIT;
+static unsigned nshards = 1;
+static int shards_used = 0;
+
+static const struct stats empty_stats = {0};
 
 static unsigned max_active_fds = 16;
 
+/* Items on the lru lists of all shards */
+static unsigned n_active_fds = 0;
+
 static unsigned max_fds_per_typestr = 10;
 
 /* Default on by now.  Whether or not comdb2 uses this will be controlled
@@ -140,7 +172,7 @@ static unsigned sockpool_enabled = 1;
 
 /* The global socket pool file descriptor.  For now we will use a single
  * per task connection.  If this doesn't scale we can be cleverer (use socket
- * pooling maybe!).  This is protected by our bb_mutex of course. */
+ * pooling maybe!).  This is protected by sockpool_lk. */
 static int sockpool_fd = -1;
 
 /* to be called ONLY from pekludgl_fork() */
@@ -154,6 +186,50 @@ void socket_pool_reset_connection_(void)
 
 void socket_pool_set_max_fds(unsigned new_max) { max_active_fds = new_max; }
 
+int socket_pool_set_shards(unsigned new_nshards)
+{
+    if (new_nshards < 1)
+        new_nshards = 1;
+    if (new_nshards > SOCKET_POOL_MAX_SHARDS)
+        new_nshards = SOCKET_POOL_MAX_SHARDS;
+    if (shards_used && new_nshards != nshards) {
+        syslog(LOG_WARNING, "%s: pool already in use, keeping %u shards\n",
+               __func__, nshards);
+        return -1;
+    }
+    nshards = new_nshards;
+    return 0;
+}
+
+static void init_shards(void)
+{
+    for (int i = 0; i < SOCKET_POOL_MAX_SHARDS; i++) {
+        Pthread_mutex_init(&shards[i].lk, NULL);
+        listc_init(&shards[i].lru_list, offsetof(struct item, lru_linkv));
+        listc_init(&shards[i].dead_list, offsetof(struct item, lru_linkv));
+    }
+}
+
+static struct shard *shard_for(const char *typestr)
+{
+    unsigned h = 2166136261U;
+    Pthread_once(&shards_once, init_shards);
+    if (nshards == 1)
+        return &shards[0];
+    /* FNV-1a */
+    for (const unsigned char *p = (const unsigned char *)typestr; *p; p++)
+        h = (h ^ *p) * 16777619U;
+    return &shards[h % nshards];
+}
+
+/* A shard's equal share of max_active_fds */
+static unsigned shard_max_fds(void)
+{
+    if (max_active_fds == 0)
+        return 0;
+    return (max_active_fds + nshards - 1) / nshards;
+}
+
 void socket_pool_set_max_fds_per_typestr(unsigned new_max)
 {
     max_fds_per_typestr = new_max;
@@ -295,8 +371,10 @@ static void default_destructor(enum socket_pool_event event,
              event == SOCKET_POOL_EVENT_DUP ||
              event == SOCKET_POOL_EVENT_ENDEVENT) &&
             sockpool_enabled && SOCKPOOL_ENABLED()) {
-            /* Donate this socket to the global socket pool.  We know that the
-             * mutex is held. */
+            /* Donate this socket to the global socket pool.  Destructors are
+             * called without any shard lock held, so take the lock which
+             * guards our connection to sockpool. */
+            Pthread_mutex_lock(&sockpool_lk);
             hold_sigpipe_ll(1);
             if (sockpool_fd == -1) {
                 sockpool_fd = open_sockpool_ll();
@@ -325,6 +403,7 @@ static void default_destructor(enum socket_pool_event event,
                      __func__, fd, typestr, ttl, dbnum, rc));
             }
             hold_sigpipe_ll(0);
+            Pthread_mutex_unlock(&sockpool_lk);
         }
 
         /* Close the local file descriptor regardless of whether or not it
@@ -349,38 +428,124 @@ static void destroy_item_ll(enum socket_pool_event event, struct item *item)
                      item->flags, ttl, item->destructor_arg);
 }
 
-static void socket_pool_trim_ll(unsigned max, enum socket_pool_event event)
+/* Take an item off the shard's lru list and queue it for destruction.  The
+ * caller must already have removed it from its type's item list. */
+static void retire_item_ll(struct shard *sh, struct item *item,
+                           enum socket_pool_event event)
+{
+    listc_rfl(&sh->lru_list, item);
+    ATOMIC_ADD32(n_active_fds, -1);
+    item->dead_event = event;
+    listc_abl(&sh->dead_list, item);
+}
+
+/* Run destructors for retired items with the shard lock held.  Only used when
+ * tearing down the pool, since the item types are about to be freed. */
+static void reap_dead_ll(struct shard *sh)
+{
+    struct item *item;
+    while ((item = listc_rtl(&sh->dead_list)) != NULL) {
+        destroy_item_ll(item->dead_event, item);
+        free(item);
+    }
+}
+
+/* Release a shard lock and then run destructors for anything retired while
+ * it was held. */
+static void shard_unlock(struct shard *sh)
+{
+    LISTC_T(struct item) dead;
+    struct item *item;
+
+    if (sh->dead_list.count == 0) {
+        Pthread_mutex_unlock(&sh->lk);
+        return;
+    }
+
+    listc_init(&dead, offsetof(struct item, lru_linkv));
+    while ((item = listc_rtl(&sh->dead_list)) != NULL)
+        listc_abl(&dead, item);
+    /* Destructors use item->type, so keep socket_pool_free_all() from
+     * freeing it until we're done. */
+    ATOMIC_ADD32(sh->n_reaping, 1);
+    Pthread_mutex_unlock(&sh->lk);
+
+    while ((item = listc_rtl(&dead)) != NULL) {
+        destroy_item_ll(item->dead_event, item);
+        free(item);
+    }
+    ATOMIC_ADD32(sh->n_reaping, -1);
+}
+
+static int pool_over_max_fds(void)
+{
+    return max_active_fds > 0 && ATOMIC_LOAD32(n_active_fds) > max_active_fds;
+}
+
+/* Retire the oldest items of a shard until it holds no more than max of
+ * them.  If to_pool_max is set, stop as soon as the whole pool is back
+ * within max_active_fds. */
+static void socket_pool_trim_ll(struct shard *sh, unsigned max, int to_pool_max,
+                                enum socket_pool_event event)
 {
-    if (hash && lru_list.count > max) {
+    if (sh->hash && sh->lru_list.count > max) {
         struct item *tmpp, *item;
         /* The lru list has the most recent donations at its end, so this
          * way we free the oldest sockets first. */
-        LISTC_FOR_EACH_SAFE(&lru_list, item, tmpp, lru_linkv)
+        LISTC_FOR_EACH_SAFE(&sh->lru_list, item, tmpp, lru_linkv)
         {
+            if (to_pool_max && !pool_over_max_fds()) {
+                break;
+            }
             DBG(("%s: closing fd %d for %s\n", __func__, item->fd,
                  item->type->typestr));
-            destroy_item_ll(event, item);
             item->type->stats.n_trimmed++;
-            stats.n_trimmed++;
-            listc_rfl(&lru_list, item);
+            sh->stats.n_trimmed++;
             listc_rfl(&item->type->item_list, item);
-            pool_relablk(pool, item);
-            if (lru_list.count <= max) {
+            retire_item_ll(sh, item, event);
+            if (sh->lru_list.count <= max) {
                 break;
             }
         }
     }
 }
 
-/* Close all sockets in the pool. */
-void socket_pool_close_all(void)
+static void socket_pool_trim_all(enum socket_pool_event event)
 {
+    Pthread_once(&shards_once, init_shards);
+    for (unsigned i = 0; i < nshards; i++) {
+        struct shard *sh = &shards[i];
+        Pthread_mutex_lock(&sh->lk);
+        socket_pool_trim_ll(sh, 0, 0, event);
+        shard_unlock(sh);
+    }
+}
 
-    Pthread_mutex_lock(&sockpool_lk);
-    if (hash) {
-        socket_pool_trim_ll(0, SOCKET_POOL_EVENT_CLOSE);
+/* The pool is over max_active_fds after a donation to home, which has
+ * already given back anything beyond its own share.  Take the rest from the
+ * shards which have borrowed beyond their shares, and failing that from
+ * whoever holds the oldest sockets, leaving home until last.  Shards are
+ * locked one at a time. */
+static void socket_pool_reclaim(struct shard *home)
+{
+    unsigned first = (home - shards) + 1;
+    for (int pass = 0; pass < 2; pass++) {
+        unsigned keep = pass == 0 ? shard_max_fds() : 0;
+        for (unsigned i = 0; i < nshards; i++) {
+            struct shard *sh = &shards[(first + i) % nshards];
+            if (!pool_over_max_fds())
+                return;
+            Pthread_mutex_lock(&sh->lk);
+            socket_pool_trim_ll(sh, keep, 1, SOCKET_POOL_EVENT_TRIM);
+            shard_unlock(sh);
+        }
     }
-    Pthread_mutex_unlock(&sockpool_lk);
+}
+
+/* Close all sockets in the pool. */
+void socket_pool_close_all(void)
+{
+    socket_pool_trim_all(SOCKET_POOL_EVENT_CLOSE);
 }
 
 void socket_pool_close_all_(void) { socket_pool_close_all(); }
@@ -395,26 +560,33 @@ void socket_pool_end_event_(void) { socket_pool_end_event(); }
 
 void socket_pool_end_event(void)
 {
-    Pthread_mutex_lock(&sockpool_lk);
-    if (hash) {
-        socket_pool_trim_ll(0, SOCKET_POOL_EVENT_ENDEVENT);
-    }
-    Pthread_mutex_unlock(&sockpool_lk);
+    socket_pool_trim_all(SOCKET_POOL_EVENT_ENDEVENT);
 }
 
 /* Close all pooled sockets and free all memory used by the pool. */
 void socket_pool_free_all(void)
 {
-    Pthread_mutex_lock(&sockpool_lk);
-    if (hash) {
-        socket_pool_trim_ll(0, SOCKET_POOL_EVENT_CLOSE);
-        hash_for(hash, socket_pool_free_callback, NULL);
-        hash_free(hash);
-        pool_free(pool);
-        hash = NULL;
-        pool = NULL;
+    Pthread_once(&shards_once, init_shards);
+    for (unsigned i = 0; i < nshards; i++) {
+        struct shard *sh = &shards[i];
+        Pthread_mutex_lock(&sh->lk);
+        /* Threads which dropped the lock before running destructors for
+         * this shard's items still use their item types.  No new ones can
+         * start while we hold the lock. */
+        while (ATOMIC_LOAD32(sh->n_reaping) > 0) {
+            Pthread_mutex_unlock(&sh->lk);
+            sched_yield();
+            Pthread_mutex_lock(&sh->lk);
+        }
+        if (sh->hash) {
+            socket_pool_trim_ll(sh, 0, 0, SOCKET_POOL_EVENT_CLOSE);
+            reap_dead_ll(sh);
+            hash_for(sh->hash, socket_pool_free_callback, NULL);
+            hash_free(sh->hash);
+            sh->hash = NULL;
+        }
+        Pthread_mutex_unlock(&sh->lk);
     }
-    Pthread_mutex_unlock(&sockpool_lk);
 }
 
 void socket_pool_free_all_(void) { socket_pool_free_all(); }
@@ -422,27 +594,29 @@ void socket_pool_free_all_(void) { socket_pool_free_all(); }
 /* Check for sockets that have timed out and close them */
 void socket_pool_timeout(void)
 {
-    Pthread_mutex_lock(&sockpool_lk);
-    if (hash) {
-        int now;
-        struct item *tmpp, *item;
-        now = comdb2_time_epoch_sp();
-        LISTC_FOR_EACH_SAFE(&lru_list, item, tmpp, lru_linkv)
-        {
-            if (item->timeout_secs > 0 &&
-                now >= item->donation_time + item->timeout_secs) {
-                DBG(("%s: closing fd %d for %s\n", __func__, item->fd,
-                     item->type->typestr));
-                destroy_item_ll(SOCKET_POOL_EVENT_TIMEOUT, item);
-                item->type->stats.n_timeouts++;
-                stats.n_timeouts++;
-                listc_rfl(&lru_list, item);
-                listc_rfl(&item->type->item_list, item);
-                pool_relablk(pool, item);
+    Pthread_once(&shards_once, init_shards);
+    for (unsigned i = 0; i < nshards; i++) {
+        struct shard *sh = &shards[i];
+        Pthread_mutex_lock(&sh->lk);
+        if (sh->hash) {
+            int now;
+            struct item *tmpp, *item;
+            now = comdb2_time_epoch_sp();
+            LISTC_FOR_EACH_SAFE(&sh->lru_list, item, tmpp, lru_linkv)
+            {
+                if (item->timeout_secs > 0 &&
+                    now >= item->donation_time + item->timeout_secs) {
+                    DBG(("%s: closing fd %d for %s\n", __func__, item->fd,
+                         item->type->typestr));
+                    item->type->stats.n_timeouts++;
+                    sh->stats.n_timeouts++;
+                    listc_rfl(&item->type->item_list, item);
+                    retire_item_ll(sh, item, SOCKET_POOL_EVENT_TIMEOUT);
+                }
             }
         }
+        shard_unlock(sh);
     }
-    Pthread_mutex_unlock(&sockpool_lk);
 }
 
 void socket_pool_timeout_(void) { socket_pool_timeout(); }
@@ -481,6 +655,40 @@ static int socket_pool_stats_callback(void *obj, void *voidarg)
     return 0;
 }
 
+/* Run the per type stats callback over every shard, summing the shard
+ * counters into total.  Returns the number of shards which have been used. */
+static int socket_pool_stats_all(struct stats_args *args, struct stats *total,
+                                 int *n_held, int incl_hash_stats)
+{
+    int nused = 0;
+    Pthread_once(&shards_once, init_shards);
+    for (unsigned i = 0; i < nshards; i++) {
+        struct shard *sh = &shards[i];
+        Pthread_mutex_lock(&sh->lk);
+        if (sh->hash) {
+            nused++;
+            hash_for(sh->hash, socket_pool_stats_callback, args);
+            *n_held += listc_size(&sh->lru_list);
+            total->n_donated += sh->stats.n_donated;
+            total->n_reused += sh->stats.n_reused;
+            total->n_duped += sh->stats.n_duped;
+            total->n_trimmed += sh->stats.n_trimmed;
+            total->n_timeouts += sh->stats.n_timeouts;
+            if (sh->stats.peak_n_held > total->peak_n_held)
+                total->peak_n_held = sh->stats.peak_n_held;
+            if (incl_hash_stats && args->fh) {
+                /* hash_dump uses printf... */
+                fprintf(args->fh, "socket pool hash table statistics (shard "
+                                  "%u):\n",
+                        i);
+                hash_dump_stats(sh->hash, args->fh, NULL);
+            }
+        }
+        Pthread_mutex_unlock(&sh->lk);
+    }
+    return nused;
+}
+
 /* Write stats to dbglog and reset all stats */
 void socket_pool_dump_stats(FILE *fh, int reset, int all)
 {
@@ -489,49 +697,43 @@ void socket_pool_dump_stats(FILE *fh, int reset, int all)
 
 void socket_pool_dump_stats_syslog(int reset, int all)
 {
+    struct stats_args args = {all, reset, 1, NULL};
+    struct stats total = {0};
+    int n_held = 0;
     syslog(LOG_INFO, "Socket pool stats, enabled=%d, sockpool enabled=%d\n", enabled,
             sockpool_enabled);
-    Pthread_mutex_lock(&sockpool_lk);
-    if (hash) {
-        struct stats_args args = {all, reset, 1, NULL};
-        hash_for(hash, socket_pool_stats_callback, &args);
+    if (socket_pool_stats_all(&args, &total, &n_held, 0)) {
         syslog(LOG_INFO, "%-32s [%2d/%2u] %5u, %5u (%u, %u, %u)\n", "Global stats:",
-                listc_size(&lru_list), stats.peak_n_held, stats.n_donated,
-                stats.n_reused, stats.n_duped, stats.n_trimmed,
-                stats.n_timeouts);
+                n_held, total.peak_n_held, total.n_donated,
+                total.n_reused, total.n_duped, total.n_trimmed,
+                total.n_timeouts);
         syslog(LOG_INFO, "Counters are: [fds held/peak held] num donated, num "
                     "reused (num duped, trimmed, timed out)\n");
-
+        syslog(LOG_INFO, "Pool shards: %u\n", nshards);
     } else {
         syslog(LOG_INFO, "Socket pool unused\n");
     }
-    Pthread_mutex_unlock(&sockpool_lk);
 }
 
 void socket_pool_dump_stats_ex(FILE *fh, int reset, int all,
                                int incl_hash_stats)
 {
+    struct stats_args args = {all, reset, 0, fh};
+    struct stats total = {0};
+    int n_held = 0;
     fprintf(fh, "Socket pool stats, enabled=%d, sockpool enabled=%d\n", enabled,
             sockpool_enabled);
-    Pthread_mutex_lock(&sockpool_lk);
-    if (hash) {
-        struct stats_args args = {all, reset, 0, fh};
-        hash_for(hash, socket_pool_stats_callback, &args);
+    if (socket_pool_stats_all(&args, &total, &n_held, incl_hash_stats)) {
         fprintf(fh, "%-32s [%2d/%2u] %5u, %5u (%u, %u, %u)\n", "Global stats:",
-                listc_size(&lru_list), stats.peak_n_held, stats.n_donated,
-                stats.n_reused, stats.n_duped, stats.n_trimmed,
-                stats.n_timeouts);
+                n_held, total.peak_n_held, total.n_donated,
+                total.n_reused, total.n_duped, total.n_trimmed,
+                total.n_timeouts);
         fprintf(fh, "Counters are: [fds held/peak held] num donated, num "
                     "reused (num duped, trimmed, timed out)\n");
-        /* hash_dump uses printf... */
-        if (incl_hash_stats) {
-            fprintf(fh, "socket pool hash table statistics:\n");
-            hash_dump_stats(hash, fh, NULL);
-        }
+        fprintf(fh, "Pool shards: %u\n", nshards);
     } else {
         fprintf(fh, "Socket pool unused\n");
     }
-    Pthread_mutex_unlock(&sockpool_lk);
 }
 
 void socket_pool_dump_stats_(const int *reset, const int *all)
@@ -554,11 +756,12 @@ socket_pool_get_ext_ll(const char *typestr, int dbnum, int flags,
 {
     int fd = -1;
     if (enabled) {
-        Pthread_mutex_lock(&sockpool_lk);
-        if (hash) {
+        struct shard *sh = shard_for(typestr);
+        Pthread_mutex_lock(&sh->lk);
+        if (sh->hash) {
             struct item *fnd_item;
             struct itemtype *fnd_type;
-            fnd_type = hash_find(hash, typestr);
+            fnd_type = hash_find(sh->hash, typestr);
             /* Try least recently donated items first. */
             while (fnd_type && fd == -1 &&
                    (fnd_item = listc_rbl(&fnd_type->item_list)) != NULL) {
@@ -572,22 +775,20 @@ socket_pool_get_ext_ll(const char *typestr, int dbnum, int flags,
                          "now=%d\n",
                          fnd_item->timeout_secs, fnd_item->donation_time,
                          comdb2_time_epoch_sp()));
-                    destroy_item_ll(SOCKET_POOL_EVENT_TIMEOUT, fnd_item);
                     fnd_type->stats.n_timeouts++;
-                    stats.n_timeouts++;
+                    sh->stats.n_timeouts++;
+                    retire_item_ll(sh, fnd_item, SOCKET_POOL_EVENT_TIMEOUT);
                 } else {
                     fd = fnd_item->fd;
-                    destroy_item_ll(SOCKET_POOL_EVENT_DONATE, fnd_item);
                     fnd_type->stats.n_reused++;
-                    stats.n_reused++;
+                    sh->stats.n_reused++;
                     DBG(("%s: fd %d for %s\n", __func__, fd,
                          fnd_type->typestr));
+                    retire_item_ll(sh, fnd_item, SOCKET_POOL_EVENT_DONATE);
                 }
-                listc_rfl(&lru_list, fnd_item);
-                pool_relablk(pool, fnd_item);
             }
         }
-        Pthread_mutex_unlock(&sockpool_lk);
+        shard_unlock(sh);
     }
     /* If we couldn't get this socket locally it may be available from the
      * global socket pool. */
@@ -689,27 +890,21 @@ void socket_pool_donate_ext(const char *typestr, int fd, int timeout_secs,
     if (!destructor)
         destructor = default_destructor;
     if (enabled && !(flags & SOCKET_POOL_DONATE_NOLOCAL)) {
-        Pthread_mutex_lock(&sockpool_lk);
-        if (!hash) {
-            hash = hash_init_str(offsetof(struct itemtype, typestr));
-            if (!hash) {
+        struct shard *sh = shard_for(typestr);
+        Pthread_mutex_lock(&sh->lk);
+        if (!sh->hash) {
+            sh->hash = hash_init_str(offsetof(struct itemtype, typestr));
+            if (!sh->hash) {
                 fprintf(stderr, "%s: cannot init hash table\n", __func__);
-            } else {
-                pool = pool_init(sizeof(struct item), 0);
-                if (!pool) {
-                    fprintf(stderr, "%s: cannot init pool\n", __func__);
-                    hash_free(hash);
-                    hash = NULL;
-                }
-                listc_init(&lru_list, offsetof(struct item, lru_linkv));
             }
+            shards_used = 1;
         }
-        if (hash) {
+        if (sh->hash) {
             struct item *item;
             struct itemtype *type;
 
             /* First find or allocate an item type head */
-            type = hash_find(hash, typestr);
+            type = hash_find(sh->hash, typestr);
             if (!type) {
                 int len;
                 len = strlen(typestr);
@@ -723,7 +918,7 @@ void socket_pool_donate_ext(const char *typestr, int fd, int timeout_secs,
                     bzero(&type->stats, sizeof(type->stats));
                     bzero(&type->dbgstats, sizeof(type->dbgstats));
                     memcpy(type->typestr, typestr, len + 1);
-                    if (hash_add(hash, type) != 0) {
+                    if (hash_add(sh->hash, type) != 0) {
                         free(type);
                         type = NULL;
                         fprintf(stderr, "%s(%s):hash_add failed\n", __func__,
@@ -740,25 +935,24 @@ void socket_pool_donate_ext(const char *typestr, int fd, int timeout_secs,
                        (item = listc_rtl(&type->item_list))) {
                     DBG(("%s: closing fd %d for %s\n", __func__, item->fd,
                          item->type->typestr));
-                    destroy_item_ll(SOCKET_POOL_EVENT_DUP, item);
                     type->stats.n_duped++;
-                    stats.n_duped++;
-                    listc_rfl(&lru_list, item);
-                    pool_relablk(pool, item);
+                    sh->stats.n_duped++;
+                    retire_item_ll(sh, item, SOCKET_POOL_EVENT_DUP);
                 }
 
-                item = pool_getablk(pool);
+                item = malloc(sizeof(struct item));
                 if (!item) {
-                    fprintf(stderr, "%s(%s): pool_getablk failed\n", __func__,
+                    fprintf(stderr, "%s(%s): malloc failed\n", __func__,
                             typestr);
                 } else {
                     unsigned num_fds;
                     DBG(("%s: pooled fd %d for %s dbnum %d timeout %d\n",
                          __func__, fd, typestr, dbnum, timeout_secs));
                     listc_abl(&type->item_list, item);
-                    listc_abl(&lru_list, item);
+                    listc_abl(&sh->lru_list, item);
+                    ATOMIC_ADD32(n_active_fds, 1);
                     type->stats.n_donated++;
-                    stats.n_donated++;
+                    sh->stats.n_donated++;
                     item->timeout_secs = timeout_secs;
                     item->donation_time = comdb2_time_epoch_sp();
                     item->flags = flags;
@@ -771,8 +965,8 @@ void socket_pool_donate_ext(const char *typestr, int fd, int timeout_secs,
                     if (num_fds > type->stats.peak_n_held) {
                         type->stats.peak_n_held = num_fds;
                     }
-                    if (num_fds > stats.peak_n_held) {
-                        stats.peak_n_held = num_fds;
+                    if (num_fds > sh->stats.peak_n_held) {
+                        sh->stats.peak_n_held = num_fds;
                     }
                     DBG(("item->timeout_secs=%d item->donation_time=%d\n",
                          item->timeout_secs, item->donation_time));
@@ -783,19 +977,22 @@ void socket_pool_donate_ext(const char *typestr, int fd, int timeout_secs,
             /* If we've got too many active file descriptors then go
              * and close out the old ones.  Do this after the donation since
              * we may have been on the edge but the donation may not tip us
-             * over if we close an old file descriptor for this typestr. */
+             * over if we close an old file descriptor for this typestr.
+             * Start with whatever this shard holds beyond its share. */
             if (max_active_fds > 0) {
-                socket_pool_trim_ll(max_active_fds, SOCKET_POOL_EVENT_TRIM);
+                socket_pool_trim_ll(sh, shard_max_fds(), 1,
+                                    SOCKET_POOL_EVENT_TRIM);
             }
         }
-        Pthread_mutex_unlock(&sockpool_lk);
+        shard_unlock(sh);
+        if (pool_over_max_fds()) {
+            socket_pool_reclaim(sh);
+        }
     }
 
     /* if it wasn't pooled then it must be closed. */
     if (!pooled) {
-        Pthread_mutex_lock(&sockpool_lk);
         destructor(SOCKET_POOL_EVENT_CLOSE, typestr, fd, dbnum, flags,
                    timeout_secs, destructor_arg);
-        Pthread_mutex_unlock(&sockpool_lk);
     }
 }
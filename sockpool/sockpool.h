@@ -62,8 +62,9 @@ enum socket_pool_flags {
 
 /* Destructor function.  This is called by the socket pool code when it
  * discards of a file descriptor for whatever reason (including donation).
- * Note that the socket pool bb mutex may or may not be held when this is
- * called so this should not call back in to socket pool apis. */
+ * It is called without any socket pool lock held, possibly concurrently
+ * from several threads, and it should not call back in to socket pool
+ * apis. */
 typedef void (*fd_destructor_fn)(enum socket_pool_event event,
                                  const char *typestr, int fd, int dbnum,
                                  int flags, int ttl, void *voidarg);
@@ -87,6 +88,12 @@ void socket_pool_set_max_fds(unsigned new_max);
 /* Set the limit on fds per type string - 0 means no limit, default is 1. */
 void socket_pool_set_max_fds_per_typestr(unsigned new_max);
 
+/* Split the pool into this many independently locked shards (default 1, max
+ * 64).  Type strings are spread across shards by hash; the max fds limit
+ * still applies to the pool as a whole.  This can only be changed before the
+ * first donation; returns -1 if the pool is already in use. */
+int socket_pool_set_shards(unsigned nshards);
+
 /* Donate a file descriptor to the pool.  If the pool is disabled or too full
  * then the file descriptor may get close()'d; in any event, this call
  * effectively transfers ownership to the pool.
@@ -108,6 +108,7 @@ int systblApiHistoryInit(sqlite3 *db);
 int systblDbInfoInit(sqlite3 *db);
 int systblUnusedFilesInit(sqlite3 *db);
 int systblPhysrepAltmetadbInit(sqlite3 *db);
+int systblPageVersionCacheInit(sqlite3 *db);
 
 /* Simple yes/no answer for booleans */
 #define YESNO(x) ((x) ? "Y" : "N")
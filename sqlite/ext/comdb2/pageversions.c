@@ -0,0 +1,76 @@
+/*
+   Copyright 2026 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <bdb/bdb_int.h>
+
+#include "comdb2.h"
+#include "sql.h"
+#include "build/db.h"
+#include "comdb2systblInt.h"
+#include "ezsystables.h"
+
+/*
+  comdb2_page_version_cache: Statistics of the cache of page versions
+  rebuilt for snapshot readers.
+*/
+
+sqlite3_module systblPageVersionCacheModule = {
+    .access_flag = CDB2_ALLOW_USER,
+};
+
+static int get_page_version_cache(void **data, int *npoints)
+{
+    bdb_state_type *bdb_state = thedb->bdb_env;
+    DB_MEMPV_STAT *stat;
+
+    *data = NULL;
+    *npoints = 0;
+    if (bdb_state == NULL)
+        return 0;
+    if ((stat = calloc(1, sizeof(DB_MEMPV_STAT))) == NULL)
+        return SQLITE_NOMEM;
+    bdb_state->dbenv->mempv_stat(bdb_state->dbenv, stat);
+    *data = stat;
+    *npoints = 1;
+    return 0;
+}
+
+static void free_page_version_cache(void *data, int npoints)
+{
+    free(data);
+}
+
+int systblPageVersionCacheInit(sqlite3 *db)
+{
+    return create_system_table(
+        db, "comdb2_page_version_cache", &systblPageVersionCacheModule,
+        get_page_version_cache, free_page_version_cache,
+        sizeof(DB_MEMPV_STAT),
+        CDB2_INTEGER, "entries", -1, offsetof(DB_MEMPV_STAT, st_entries),
+        CDB2_INTEGER, "bytes", -1, offsetof(DB_MEMPV_STAT, st_bytes),
+        CDB2_INTEGER, "max_bytes", -1, offsetof(DB_MEMPV_STAT, st_max_bytes),
+        CDB2_INTEGER, "hits", -1, offsetof(DB_MEMPV_STAT, st_hits),
+        CDB2_INTEGER, "misses", -1, offsetof(DB_MEMPV_STAT, st_misses),
+        CDB2_INTEGER, "evictions", -1, offsetof(DB_MEMPV_STAT, st_evictions),
+        CDB2_INTEGER, "rebuilds", -1, offsetof(DB_MEMPV_STAT, st_rebuilds),
+        CDB2_INTEGER, "undo_records", -1,
+        offsetof(DB_MEMPV_STAT, st_undo_records),
+        CDB2_INTEGER, "max_undo_chain", -1,
+        offsetof(DB_MEMPV_STAT, st_max_undo_chain),
+        SYSTABLE_END_OF_FIELDS);
+}
@@ -229,6 +229,8 @@ int comdb2SystblInit(
     rc = systblMemstatsInit(db);
   if (rc == SQLITE_OK)
     rc = systblTransactionStateInit(db);
+  if (rc == SQLITE_OK)
+    rc = systblPageVersionCacheInit(db);
   if (rc == SQLITE_OK)
     rc = systblTriggersInit(db);
   if (rc == SQLITE_OK)  
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cdb2api.h>
+
+static cdb2_hndl_tp *hndl;
+
+#define CHECK(expr, want)                                                      \
+    do {                                                                       \
+        int rc_ = (expr);                                                      \
+        if (rc_ != (want)) {                                                   \
+            fprintf(stderr, "%s:%d %s: got %d want %d: %s\n", __FILE__,       \
+                    __LINE__, #expr, rc_, (want), cdb2_errstr(hndl));          \
+            exit(1);                                                           \
+        }                                                                      \
+    } while (0)
+
+static long long next_int(void)
+{
+    CHECK(cdb2_next_record(hndl), CDB2_OK);
+    return *(long long *)cdb2_column_value(hndl, 0);
+}
+
+static void add(const char *sql)
+{
+    CHECK(cdb2_pipeline_add(hndl, sql), 0);
+}
+
+int main(int argc, char **argv)
+{
+    char *conf = getenv("CDB2_CONFIG");
+    const char *tier = "default";
+
+    if (argc < 2)
+        return 1;
+    if (argc > 2)
+        tier = argv[2];
+    if (conf != NULL)
+        cdb2_set_comdb2db_config(conf);
+
+    CHECK(cdb2_open(&hndl, argv[1], tier, 0), 0);
+    CHECK(cdb2_run_statement(hndl, "DROP TABLE IF EXISTS pipeline_test"), 0);
+    CHECK(cdb2_run_statement(hndl, "CREATE TABLE pipeline_test (i INTEGER)"), 0);
+
+    /* autocommit statements, read back in order */
+    add("INSERT INTO pipeline_test VALUES (1)");
+    long long two = 2;
+    CHECK(cdb2_bind_param(hndl, "v", CDB2_INTEGER, &two, sizeof(two)), 0);
+    add("INSERT INTO pipeline_test VALUES (@v)");
+    CHECK(cdb2_clearbindings(hndl), 0);
+    add("SELECT COUNT(*) FROM pipeline_test");
+    add("SELECT i FROM pipeline_test ORDER BY i");
+    CHECK(cdb2_pipeline_pending(hndl), 4);
+
+    /* can't mix with cdb2_run_statement until the results are read */
+    CHECK(cdb2_run_statement(hndl, "SELECT 1"), CDB2ERR_BADSTATE);
+
+    CHECK(cdb2_pipeline_next(hndl), 0);
+    CHECK(cdb2_next_record(hndl), CDB2_OK_DONE);
+    CHECK(cdb2_pipeline_next(hndl), 0);
+    CHECK(cdb2_pipeline_next(hndl), 0);
+    CHECK(next_int(), 2);
+    CHECK(cdb2_next_record(hndl), CDB2_OK_DONE);
+    CHECK(cdb2_pipeline_next(hndl), 0);
+    CHECK(next_int(), 1);
+    /* the second row is left unread; the next cdb2_pipeline_add skips it */
+    CHECK(cdb2_pipeline_pending(hndl), 0);
+    CHECK(cdb2_pipeline_next(hndl), CDB2ERR_BADSTATE);
+
+    /* a failing statement doesn't affect the ones after it */
+    add("SELECT nosuchcolumn FROM pipeline_test");
+    add("SELECT 42");
+    CHECK(cdb2_pipeline_next(hndl), CDB2ERR_PREPARE_ERROR);
+    CHECK(cdb2_pipeline_next(hndl), 0);
+    CHECK(next_int(), 42);
+
+    /* inside a transaction */
+    CHECK(cdb2_run_statement(hndl, "BEGIN"), 0);
+    add("INSERT INTO pipeline_test VALUES (3)");
+    add("INSERT INTO pipeline_test VALUES (4)");
+    add("SELECT COUNT(*) FROM pipeline_test");
+    CHECK(cdb2_pipeline_add(hndl, "COMMIT"), CDB2ERR_NOTSUPPORTED);
+    CHECK(cdb2_pipeline_add(hndl, "/* c */ commit"), CDB2ERR_NOTSUPPORTED);
+    CHECK(cdb2_pipeline_add(hndl, "-- c\n ROLLBACK"), CDB2ERR_NOTSUPPORTED);
+    CHECK(cdb2_pipeline_next(hndl), 0);
+    CHECK(cdb2_pipeline_next(hndl), 0);
+    CHECK(cdb2_pipeline_next(hndl), 0);
+    CHECK(next_int(), 4);
+    CHECK(cdb2_run_statement(hndl, "COMMIT"), 0);
+
+    CHECK(cdb2_run_statement(hndl, "SELECT COUNT(*) FROM pipeline_test"), 0);
+    CHECK(next_int(), 4);
+
+    /* only whole keywords are rejected */
+    add("settings");
+    CHECK(cdb2_pipeline_next(hndl), CDB2ERR_PREPARE_ERROR);
+
+    CHECK(cdb2_close(hndl), 0);
+    printf("passed\n");
+    return 0;
+}
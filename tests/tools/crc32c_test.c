@@ -112,6 +112,37 @@ void test_misaligned_access_bug()
     printf("...check\n");
 }
 
+void test_multi()
+{
+    printf("Test that crc32c_multi matches crc32c on each buffer");
+
+    enum { NBUF = 8, MAXSZ = 5000 };
+    uint8_t *bufs[NBUF];
+    uint32_t szs[NBUF], crcs[NBUF];
+
+    for (int i = 0; i < NBUF; i++) {
+        bufs[i] = malloc(MAXSZ + 8);
+        for (int j = 0; j < MAXSZ + 8; j++)
+            bufs[i][j] = rand();
+    }
+
+    for (int iter = 0; iter < 1000; iter++) {
+        int n = 1 + rand() % NBUF;
+        const uint8_t *p[NBUF];
+        for (int i = 0; i < n; i++) {
+            p[i] = bufs[i] + rand() % 8; /* misaligned too */
+            szs[i] = (iter % 2) ? 4096 : rand() % MAXSZ;
+        }
+        crc32c_multi(p, szs, crcs, n);
+        for (int i = 0; i < n; i++)
+            assert(crcs[i] == crc32c_comdb2(p[i], szs[i]));
+    }
+
+    for (int i = 0; i < NBUF; i++)
+        free(bufs[i]);
+    printf("...check\n");
+}
+
 int main()
 {
     crc32c_init(1);
@@ -121,6 +152,7 @@ int main()
     test_non_empty_string();
     test_software_vs_hardware();
     test_misaligned_access_bug();
+    test_multi();
 
     return 0;
 }
@@ -471,7 +471,25 @@ static void test_encode_middle_field_2()
     fprintf(stderr, "passed %s\n", __func__);
 }
 
-int main(int argc, char *argv[])
+/* The vectorized scanners must agree with the scalar ones everywhere */
+static void test_scan_dispatch()
+{
+    uint8_t buf[N + 16];
+    for (int i = 0; i < 10000; ++i) {
+        uint32_t shift = 1 + rand() % 9;
+        size_t len = rand() % (N - shift);
+        memset(buf, rand() % 2, sizeof(buf));
+        for (int j = rand() % 4; j > 0; --j)
+            buf[rand() % sizeof(buf)] = rand();
+        assert(crle_diff(buf, len, shift) ==
+               crle_diff_scalar(buf, len, shift));
+        assert(crle_rdiff(buf, len, buf[len]) ==
+               crle_rdiff_scalar(buf, len, buf[len]));
+    }
+    fprintf(stderr, "passed %s\n", __func__);
+}
+
+static void run_tests(void)
 {
     test_varint();
     test_repeat();
@@ -483,6 +501,14 @@ int main(int argc, char *argv[])
     test_decode();
     test_encode_middle_field();
     test_encode_middle_field_2();
+}
+
+int main(int argc, char *argv[])
+{
+    run_tests(); /* scalar scanners */
+    comdb2rle_init(1);
+    test_scan_dispatch();
+    run_tests();
 
     fprintf(stderr, "PASSED ALL TESTS\n");
     return EXIT_SUCCESS;
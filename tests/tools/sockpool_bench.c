@@ -0,0 +1,232 @@
+/*
+   Copyright 2026 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/* Checkout latency benchmark for a running cdb2sockpool.  Each thread opens
+ * its own connection to the daemon and churns requests and donations of
+ * loopback tcp sockets spread over a number of fake databases, timing every
+ * request round trip.  Reports p50 / p99 / max checkout latency.
+ *
+ * usage: sockpool_bench [-p socket path] [-t threads] [-n iterations]
+ *                       [-d databases] */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <passfd.h>
+#include <sockpool_p.h>
+
+static const char *path = SOCKPOOL_SOCKET_NAME;
+static int nthreads = 8;
+static int niters = 10000;
+static int ndbs = 16;
+static struct sockaddr_in listen_addr;
+
+struct thd {
+    pthread_t tid;
+    int id;
+    uint64_t *lat; /* nanoseconds per request */
+    int nlat;
+    int hits;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int open_pool(void)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    struct sockpool_hello hello = {.protocol_version = 0, .pid = getpid()};
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    memcpy(hello.magic, "SQLP", 4);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        write(fd, &hello, sizeof(hello)) != sizeof(hello)) {
+        fprintf(stderr, "can't connect to %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int new_socket(void)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+    if (connect(fd, (struct sockaddr *)&listen_addr, sizeof(listen_addr))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Accept and drop connections; the client ends just need to be connected
+ * sockets for the pool to hold on to. */
+static void *accept_thd(void *arg)
+{
+    int lfd = *(int *)arg;
+    for (;;) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd != -1)
+            close(fd);
+    }
+    return NULL;
+}
+
+static void *bench_thd(void *arg)
+{
+    struct thd *t = arg;
+    struct sockpool_msg_vers0 msg;
+    unsigned seed = t->id;
+    int fd = open_pool();
+    if (fd == -1)
+        return NULL;
+
+    for (int i = 0; i < niters; i++) {
+        int sock = -1, rc;
+        uint64_t start;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.request = SOCKPOOL_REQUEST;
+        snprintf(msg.typestr, sizeof(msg.typestr), "bench/db%d/sql",
+                 rand_r(&seed) % ndbs);
+
+        start = now_ns();
+        rc = send_fd(fd, &msg, sizeof(msg), -1);
+        if (rc == PASSFD_SUCCESS)
+            rc = recv_fd(fd, &msg, sizeof(msg), &sock);
+        if (rc != PASSFD_SUCCESS) {
+            fprintf(stderr, "thread %d: request failed rc %d\n", t->id, rc);
+            break;
+        }
+        t->lat[t->nlat++] = now_ns() - start;
+
+        if (sock != -1)
+            t->hits++;
+        else if ((sock = new_socket()) == -1)
+            continue;
+
+        /* Hand it straight back, as an application would after a query */
+        msg.request = SOCKPOOL_DONATE;
+        msg.timeout = 60;
+        rc = send_fd(fd, &msg, sizeof(msg), sock);
+        close(sock);
+        if (rc != PASSFD_SUCCESS) {
+            fprintf(stderr, "thread %d: donate failed rc %d\n", t->id, rc);
+            break;
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [-p socket path] [-t threads] [-n iterations] "
+            "[-d databases]\n",
+            argv0);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    socklen_t len = sizeof(listen_addr);
+    pthread_t atid;
+    struct thd *thds;
+    uint64_t *all, start, elapsed;
+    int c, lfd, total = 0, hits = 0;
+
+    while ((c = getopt(argc, argv, "p:t:n:d:")) != -1) {
+        switch (c) {
+        case 'p': path = optarg; break;
+        case 't': nthreads = atoi(optarg); break;
+        case 'n': niters = atoi(optarg); break;
+        case 'd': ndbs = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (nthreads <= 0 || niters <= 0 || ndbs <= 0)
+        usage(argv[0]);
+
+    lfd = socket(AF_INET, SOCK_STREAM, 0);
+    listen_addr.sin_family = AF_INET;
+    listen_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (lfd == -1 ||
+        bind(lfd, (struct sockaddr *)&listen_addr, sizeof(listen_addr)) ||
+        listen(lfd, 1024) ||
+        getsockname(lfd, (struct sockaddr *)&listen_addr, &len)) {
+        perror("listen");
+        return 1;
+    }
+    pthread_create(&atid, NULL, accept_thd, &lfd);
+
+    thds = calloc(nthreads, sizeof(struct thd));
+    for (int i = 0; i < nthreads; i++) {
+        thds[i].id = i;
+        thds[i].lat = malloc(niters * sizeof(uint64_t));
+    }
+
+    start = now_ns();
+    for (int i = 0; i < nthreads; i++)
+        pthread_create(&thds[i].tid, NULL, bench_thd, &thds[i]);
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(thds[i].tid, NULL);
+    elapsed = now_ns() - start;
+
+    all = malloc((size_t)nthreads * niters * sizeof(uint64_t));
+    for (int i = 0; i < nthreads; i++) {
+        memcpy(all + total, thds[i].lat, thds[i].nlat * sizeof(uint64_t));
+        total += thds[i].nlat;
+        hits += thds[i].hits;
+    }
+    if (total == 0) {
+        fprintf(stderr, "no requests completed\n");
+        return 1;
+    }
+    qsort(all, total, sizeof(uint64_t), cmp_u64);
+
+    printf("threads %d dbs %d requests %d hit rate %.1f%% rate %.0f/s\n",
+           nthreads, ndbs, total, 100.0 * hits / total,
+           total / (elapsed / 1e9));
+    printf("checkout latency us: p50 %.1f p99 %.1f max %.1f\n",
+           all[total / 2] / 1e3, all[(size_t)total * 99 / 100] / 1e3,
+           all[total - 1] / 1e3);
+    return 0;
+}
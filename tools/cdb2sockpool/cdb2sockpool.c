@@ -99,7 +99,10 @@ static struct stat save_st;
 
 static LISTC_T(struct db_number_info) active_list;
 
-/* Keep an overall count of pooled sockets */
+/* Keep an overall count of pooled sockets.  This, dbs_info_hash and
+ * active_list are protected by pool_count_lock.  The pool's destructors run
+ * outside of the pool's own (per shard) locks so we can't rely on those. */
+static pthread_mutex_t pool_count_lock = PTHREAD_MUTEX_INITIALIZER;
 static int pooled_socket_count;
 
 /* List of active clients. */
@@ -117,8 +120,6 @@ static long max_fd_limit;
 static pthread_mutex_t gbl_exiting_lock = PTHREAD_MUTEX_INITIALIZER;
 static int gbl_exiting = 0;
 
-extern pthread_mutex_t sockpool_lk;
-
 /* socket port hints, to reduce communication with portmux */
 
 struct port_hint {
@@ -126,7 +127,9 @@ struct port_hint {
     char typestr[1];
 };
 
-static pthread_mutex_t gbl_port_hints_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Every donation consults the hints, and they rarely change, so readers
+ * don't exclude each other. */
+static pthread_rwlock_t gbl_port_hints_lock = PTHREAD_RWLOCK_INITIALIZER;
 static hash_t *port_hints = NULL;
 static int num_port_hints = 0;
 
@@ -167,11 +170,8 @@ static int get_num_clients()
 static int get_pooled_socket_count()
 {
     int pooled_sockets;
-    Pthread_mutex_lock(&sockpool_lk);
-    {
-        pooled_sockets = pooled_socket_count;
-    }
-    Pthread_mutex_unlock(&sockpool_lk);
+    LOCK(&pool_count_lock) { pooled_sockets = pooled_socket_count; }
+    UNLOCK(&pool_count_lock);
     return pooled_sockets;
 }
 
@@ -189,17 +189,21 @@ static void fd_destructor(enum socket_pool_event event, const char *typestr,
         }
     }
 
-    pooled_socket_count--;
-    if (dbnum > 0) {
-        struct db_number_info *dbs_info;
-        dbs_info = hash_find(dbs_info_hash, &dbnum);
-        if (dbs_info) {
-            dbs_info->pool_count--;
-            if (dbs_info->pool_count == 0) {
-                listc_rfl(&active_list, dbs_info);
+    LOCK(&pool_count_lock)
+    {
+        pooled_socket_count--;
+        if (dbnum > 0) {
+            struct db_number_info *dbs_info;
+            dbs_info = hash_find(dbs_info_hash, &dbnum);
+            if (dbs_info) {
+                dbs_info->pool_count--;
+                if (dbs_info->pool_count == 0) {
+                    listc_rfl(&active_list, dbs_info);
+                }
             }
         }
     }
+    UNLOCK(&pool_count_lock);
 }
 
 int recvall(int fd, void *bufp, int len)
@@ -281,7 +285,16 @@ static int cache_port(char *typestr, int fd, char *prefix)
 
     portnum = ntohs(in.sin_port);
 
-    LOCK(&gbl_port_hints_lock)
+    /* Usually the database is still on the port we already know about. */
+    Pthread_rwlock_rdlock(&gbl_port_hints_lock);
+    hint = gbl_exiting ? NULL : hash_find_readonly(port_hints, typestr);
+    if (hint && hint->portnum == portnum) {
+        Pthread_rwlock_unlock(&gbl_port_hints_lock);
+        return 0;
+    }
+    Pthread_rwlock_unlock(&gbl_port_hints_lock);
+
+    Pthread_rwlock_wrlock(&gbl_port_hints_lock);
     {
         if (!gbl_exiting) {
             if (VERBOSE)
@@ -326,7 +339,7 @@ static int cache_port(char *typestr, int fd, char *prefix)
             }
         }
     }
-    UNLOCK(&gbl_port_hints_lock);
+    Pthread_rwlock_unlock(&gbl_port_hints_lock);
 
     return 0;
 }
@@ -532,7 +545,7 @@ void *client_thd(void *voidarg)
              * pool it our destructor (fd_destructor) will be called and will
              * decrement the count.  Also of course light the shared memory
              * bit to indicate that we have fds available for this dbnum. */
-            Pthread_mutex_lock(&sockpool_lk);
+            LOCK(&pool_count_lock)
             {
                 pooled_socket_count++;
                 if (dbnum > 0) {
@@ -549,7 +562,7 @@ void *client_thd(void *voidarg)
                     dbs_info->pool_count++;
                 }
             }
-            Pthread_mutex_unlock(&sockpool_lk);
+            UNLOCK(&pool_count_lock);
 
             clnt.stats.fds_donated++;
             gbl_stats.fds_donated++;
@@ -589,10 +602,11 @@ void *client_thd(void *voidarg)
 
             /* if no socket, try to find the port hint */
             if (newfd == -1 && 1) {
-                LOCK(&gbl_port_hints_lock)
+                Pthread_rwlock_rdlock(&gbl_port_hints_lock);
                 {
                     if (!gbl_exiting) {
-                        struct port_hint *hint = hash_find(port_hints, typestr);
+                        struct port_hint *hint =
+                            hash_find_readonly(port_hints, typestr);
                         if (hint) {
                             short portn = htons(hint->portnum);
                             memcpy(&msg0.padding[1], &portn, sizeof(portn));
@@ -612,7 +626,7 @@ void *client_thd(void *voidarg)
                         }
                     }
                 }
-                UNLOCK(&gbl_port_hints_lock);
+                Pthread_rwlock_unlock(&gbl_port_hints_lock);
             } else {
                 if (VERBOSE) {
                     syslog(LOG_DEBUG,
@@ -653,7 +667,7 @@ void *client_thd(void *voidarg)
             }
 
         } else if (request == SOCKPOOL_FORGET_PORT) {
-            LOCK(&gbl_port_hints_lock)
+            Pthread_rwlock_wrlock(&gbl_port_hints_lock);
             {
                 struct port_hint *h;
                 h = hash_find(port_hints, typestr);
@@ -674,7 +688,7 @@ void *client_thd(void *voidarg)
                     }
                 }
             }
-            UNLOCK(&gbl_port_hints_lock);
+            Pthread_rwlock_unlock(&gbl_port_hints_lock);
         } else {
             syslog(LOG_NOTICE, "%s: bad request %d\n", prefix, (int)request);
             if (newfd != -1)
@@ -736,13 +750,11 @@ static void *accept_thd(void *voidarg)
 
 static void purge_hints(void)
 {
-    LOCK(&gbl_port_hints_lock)
-    {
-        if (!gbl_exiting) {
-            hash_clear(port_hints);
-        }
+    Pthread_rwlock_wrlock(&gbl_port_hints_lock);
+    if (!gbl_exiting) {
+        hash_clear(port_hints);
     }
-    UNLOCK(&gbl_port_hints_lock);
+    Pthread_rwlock_unlock(&gbl_port_hints_lock);
 }
 
 static void cleanexit(void)
@@ -751,12 +763,10 @@ static void cleanexit(void)
     LOCK(&gbl_exiting_lock) { gbl_exiting = 1; }
     UNLOCK(&gbl_exiting_lock);
 
-    LOCK(&gbl_port_hints_lock)
-    {
-        hash_free(port_hints);
-        num_port_hints = 0;
-    }
-    UNLOCK(&gbl_port_hints_lock);
+    Pthread_rwlock_wrlock(&gbl_port_hints_lock);
+    hash_free(port_hints);
+    num_port_hints = 0;
+    Pthread_rwlock_unlock(&gbl_port_hints_lock);
 
     socket_pool_close_all();
     exit(0);
@@ -788,7 +798,7 @@ static void do_stat(void)
     syslog(LOG_INFO, "---\n");
     print_all_settings();
     syslog(LOG_INFO, "---\n");
-    Pthread_mutex_lock(&sockpool_lk);
+    Pthread_mutex_lock(&pool_count_lock);
     syslog(LOG_INFO, "Currently holding sockets for %d discrete dbnums:\n",
            listc_size(&active_list));
     strbuf *stb = strbuf_new();
@@ -809,7 +819,7 @@ static void do_stat(void)
     if (count > 0)
         syslog(LOG_INFO, "%s", strbuf_buf(stb));
     strbuf_free(stb);
-    Pthread_mutex_unlock(&sockpool_lk);
+    Pthread_mutex_unlock(&pool_count_lock);
     syslog(LOG_INFO, "---\n");
     LOCK(&client_lock)
     {
@@ -872,15 +882,13 @@ int port_hint_dump(void *obj, void *voidarg)
 
 static void do_stat_port(void)
 {
-    LOCK(&gbl_port_hints_lock)
-    {
-        if (!gbl_exiting) {
-            syslog(LOG_INFO, "=== Cached %d ports ===\n", num_port_hints);
-            hash_for(port_hints, port_hint_dump, NULL);
-            syslog(LOG_INFO, "=== Done ===\n");
-        }
+    Pthread_rwlock_rdlock(&gbl_port_hints_lock);
+    if (!gbl_exiting) {
+        syslog(LOG_INFO, "=== Cached %d ports ===\n", num_port_hints);
+        hash_for(port_hints, port_hint_dump, NULL);
+        syslog(LOG_INFO, "=== Done ===\n");
     }
-    UNLOCK(&gbl_port_hints_lock);
+    Pthread_rwlock_unlock(&gbl_port_hints_lock);
 }
 
 static void do_stat_pool(void) { socket_pool_dump_stats_syslog(0, 1); }
@@ -966,7 +974,7 @@ static void message_trap(int ntoks, char *toks[])
             return;
         }
 
-        LOCK(&gbl_port_hints_lock)
+        Pthread_rwlock_wrlock(&gbl_port_hints_lock);
         {
             char msg[48];
             struct port_hint *hint;
@@ -990,11 +998,12 @@ static void message_trap(int ntoks, char *toks[])
                 }
             }
         }
-        UNLOCK(&gbl_port_hints_lock);
+        Pthread_rwlock_unlock(&gbl_port_hints_lock);
 
     } else if (strcasecmp(toks[0], "dumphints") == 0) {
-        LOCK(&gbl_port_hints_lock) { hash_for(port_hints, dumphint, NULL); }
-        UNLOCK(&gbl_port_hints_lock);
+        Pthread_rwlock_rdlock(&gbl_port_hints_lock);
+        hash_for(port_hints, dumphint, NULL);
+        Pthread_rwlock_unlock(&gbl_port_hints_lock);
     } else {
         syslog(LOG_INFO, "unknown message trap '%s'\n", toks[0]);
     }
@@ -1006,6 +1015,10 @@ void setting_changed(unsigned *setting)
         socket_pool_set_max_fds(POOL_MAX_FDS);
     } else if (setting == &POOL_MAX_FDS_PER_DB) {
         socket_pool_set_max_fds_per_typestr(POOL_MAX_FDS_PER_DB);
+    } else if (setting == &POOL_SHARDS) {
+        if (socket_pool_set_shards(POOL_SHARDS) != 0) {
+            syslog(LOG_INFO, "POOL_SHARDS can only be set at startup\n");
+        }
 #if 0      
    } else if(setting == &CHECK_PIPE_FREQ) {
       comdb2_cantim(CHECK_PIPE_TIMER_NO);
@@ -1153,6 +1166,7 @@ int main(int argc, char *argv[])
      * the global socket pool... */
     sockpool_disable();
 
+    socket_pool_set_shards(POOL_SHARDS);
     socket_pool_set_max_fds(POOL_MAX_FDS);
     socket_pool_set_max_fds_per_typestr(POOL_MAX_FDS_PER_DB);
 
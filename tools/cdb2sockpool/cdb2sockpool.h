@@ -45,8 +45,6 @@ struct buflink {
     int ignore;
 };
 
-extern pthread_mutex_t sockpool_lk;
-
 void print_setting(const struct setting *setting);
 void print_all_settings(void);
 int set_setting(const char *name, unsigned new_value);
@@ -37,6 +37,9 @@ VALUE_SETTING(POOL_MAX_FDS, 256, "max fds to pool at once (0 = no limit)")
 VALUE_SETTING(POOL_MAX_FDS_PER_DB, 4,
               "max fds to pool per database at once (0 = no limit)")
 
+VALUE_SETTING(POOL_SHARDS, 16,
+              "number of independently locked pool shards (startup only)")
+
 SECS_SETTING(CHECK_PIPE_FREQ, 60,
              "seconds between stat'ing domain socket, 0 for off")
 
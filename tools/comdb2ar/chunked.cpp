@@ -0,0 +1,557 @@
+/*
+   Copyright 2026 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "chunked.h"
+
+#include "ar_wrap.h"
+#include "error.h"
+#include "riia.h"
+#include "serialiseerror.h"
+#include "tar_header.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <lz4.h>
+
+#if defined (__linux__)
+#define DO_DIRECT O_DIRECT
+#else
+#define DO_DIRECT 0
+#endif
+
+static const char chunk_suffix[] = ".lz4.";
+
+std::string chunk_name(const std::string& filename, unsigned long long chunkno)
+{
+    std::ostringstream ss;
+    ss << filename << chunk_suffix << chunkno;
+    return ss.str();
+}
+
+bool is_chunk_name(const std::string& name, std::string& filename,
+        unsigned long long& chunkno)
+{
+    size_t pos = name.rfind(chunk_suffix);
+    if(pos == std::string::npos || pos == 0) {
+        return false;
+    }
+    size_t digits = pos + sizeof(chunk_suffix) - 1;
+    if(digits == name.length() ||
+            name.find_first_not_of("0123456789", digits) != std::string::npos) {
+        return false;
+    }
+    filename = name.substr(0, pos);
+    chunkno = std::strtoull(name.c_str() + digits, NULL, 10);
+    return true;
+}
+
+static unsigned long long num_chunks(unsigned long long filesize)
+{
+    // Always at least one chunk, so that restore creates the file
+    unsigned long long nchunks = (filesize + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    return nchunks ? nchunks : 1;
+}
+
+static ssize_t preadall(int fd, uint8_t *buf, size_t nbytes, off_t offset)
+// Read nbytes at offset.  Returns the number of bytes read, which is short
+// only at end of file, or -1 on error.
+{
+    size_t done = 0;
+    while(done < nbytes) {
+        ssize_t n = pread(fd, buf + done, nbytes - done, offset + done);
+        if(n == -1 && errno == EINTR) {
+            continue;
+        }
+        if(n == -1) {
+            return -1;
+        }
+        if(n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+static ssize_t pwriteall(int fd, const char *buf, size_t nbytes, off_t offset)
+{
+    size_t done = 0;
+    while(done < nbytes) {
+        ssize_t n = pwrite(fd, buf + done, nbytes - done, offset + done);
+        if(n == -1 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return -1;
+        }
+        done += n;
+    }
+    return done;
+}
+
+
+namespace {
+
+struct ChunkedFile {
+// State shared by the threads serialising one file
+
+    FileInfo& file;
+    volatile iomap *iom;
+    int fd;
+    struct stat st;
+    size_t pagesize;
+    unsigned long long nchunks;
+
+    std::atomic<unsigned long long> next_read;
+    std::atomic<bool> skip_iomap;
+    std::atomic<int> num_waits;
+
+    std::mutex lk;
+    std::condition_variable cv;
+    unsigned long long next_write;
+    unsigned long long compressed;
+    std::string error;
+
+    ChunkedFile(FileInfo& f, volatile iomap *i, int d) :
+        file(f), iom(i), fd(d), pagesize(0), nchunks(0), next_read(0),
+        skip_iomap(false), num_waits(0), next_write(0), compressed(0) {}
+
+    void fail(const std::string& err)
+    {
+        std::lock_guard<std::mutex> guard(lk);
+        if(error.empty()) {
+            error = err;
+        }
+        cv.notify_all();
+    }
+
+    bool failed()
+    {
+        std::lock_guard<std::mutex> guard(lk);
+        return !error.empty();
+    }
+};
+
+}
+
+static void wait_for_iomap(ChunkedFile *cf)
+// Hold off while the database is flushing its cache, as serialise_file does
+{
+    while(!cf->skip_iomap && cf->iom != NULL && cf->iom->memptrickle_time) {
+        int now = time(NULL);
+        if((now - cf->iom->memptrickle_time) > 5*60) {
+            cf->skip_iomap = true;
+            break;
+        }
+        cf->num_waits++;
+        poll(0, 0, 100);
+    }
+}
+
+static bool read_chunk(ChunkedFile *cf, uint8_t *buf, off_t offset, size_t len,
+        std::string& err)
+// Read a chunk and verify the checksum of each of its pages, re-reading
+// pages that were caught half written.
+{
+    std::ostringstream ss;
+    ssize_t n = preadall(cf->fd, buf, len, offset);
+    if(n == -1) {
+        ss << "read error at offset " << offset << ": " << std::strerror(errno);
+        err = ss.str();
+        return false;
+    }
+    if((size_t)n < len) {
+        // The header for this chunk has not been written yet, but the
+        // file is not what we stat'ed any more.
+        err = "file shrank while being archived!";
+        return false;
+    }
+    if(!cf->file.get_checksums()) {
+        return true;
+    }
+
+    for(size_t pg = 0; pg + cf->pagesize <= len; pg += cf->pagesize) {
+        uint32_t verify_cksum;
+        int retry = 5;
+
+        while(verify_checksum(buf + pg, cf->pagesize, cf->file.get_crypto(),
+                    cf->file.get_swapped(), &verify_cksum) != 1) {
+            if(--retry == 0) {
+                ss << "page at offset " << offset + pg
+                    << " failed checksum verification";
+                err = ss.str();
+                return false;
+            }
+            // wait 500ms before reading page again
+            poll(0, 0, 500);
+            if(preadall(cf->fd, buf + pg, cf->pagesize, offset + pg) !=
+                    (ssize_t)cf->pagesize) {
+                ss << "re-read error at offset " << offset + pg << ": "
+                    << std::strerror(errno);
+                err = ss.str();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool write_chunk(ChunkedFile *cf, unsigned long long chunkno,
+        const char *data, size_t len)
+// Write a compressed chunk as a tar entry once every chunk before it is out
+{
+    static const char zeroes[512] = {0};
+
+    std::unique_lock<std::mutex> lk(cf->lk);
+    cf->cv.wait(lk, [&] {
+        return cf->next_write == chunkno || !cf->error.empty();
+    });
+    if(!cf->error.empty()) {
+        return false;
+    }
+
+    struct stat st = cf->st;
+    st.st_size = len;
+
+    TarHeader head;
+    head.set_filename(chunk_name(cf->file.get_filename(), chunkno));
+    head.set_attrs(st);
+    head.set_checksum();
+
+    size_t padding = (512 - (len & 511)) & 511;
+    if(writeall(1, head.get().c, sizeof(tar_block_header))
+            != sizeof(tar_block_header) ||
+            writeall(1, data, len) != (ssize_t)len ||
+            (padding && writeall(1, zeroes, padding) != (ssize_t)padding)) {
+        std::ostringstream ss;
+        ss << "error writing chunk " << chunkno << ": " << std::strerror(errno);
+        cf->error = ss.str();
+        cf->cv.notify_all();
+        return false;
+    }
+
+    cf->compressed += len;
+    cf->next_write++;
+    cf->cv.notify_all();
+    return true;
+}
+
+static void serialise_chunks(ChunkedFile *cf)
+{
+    uint8_t *buf = NULL;
+    char *out = NULL;
+    int bound = LZ4_compressBound(CHUNK_SIZE);
+
+    if(posix_memalign((void**) &buf, 512, CHUNK_SIZE)) {
+        buf = NULL;
+    }
+    RIIA_malloc buf_guard(buf);
+    out = (char *)malloc(bound);
+    RIIA_malloc out_guard(out);
+    if(buf == NULL || out == NULL) {
+        cf->fail("failed to allocate chunk buffers");
+        return;
+    }
+
+    try {
+        while(!cf->failed()) {
+            unsigned long long chunkno = cf->next_read++;
+            if(chunkno >= cf->nchunks) {
+                break;
+            }
+
+            off_t offset = chunkno * CHUNK_SIZE;
+            size_t len = CHUNK_SIZE;
+            if(cf->st.st_size - offset < (off_t)len) {
+                len = cf->st.st_size - offset;
+            }
+
+            std::string err;
+            wait_for_iomap(cf);
+            if(!read_chunk(cf, buf, offset, len, err)) {
+                cf->fail(err);
+                break;
+            }
+
+            int clen = LZ4_compress_default((const char *)buf, out, len, bound);
+            if(clen <= 0) {
+                std::ostringstream ss;
+                ss << "lz4 failed to compress chunk " << chunkno;
+                cf->fail(ss.str());
+                break;
+            }
+
+            if(!write_chunk(cf, chunkno, out, clen)) {
+                break;
+            }
+        }
+    } catch(std::exception& e) {
+        cf->fail(e.what());
+    }
+}
+
+void serialise_file_chunked(FileInfo& file, volatile iomap *iomap,
+        unsigned nthreads)
+{
+    const std::string& filename = file.get_filename();
+    std::ostringstream ss;
+
+    // Ensure large file support
+    assert(sizeof(off_t) == 8);
+
+    int flags = O_RDONLY;
+    if(file.get_direct_io()) {
+        flags |= DO_DIRECT;
+    }
+    int fd = open(file.get_filepath().c_str(), flags);
+    if(fd == -1 && EINVAL == errno && flags != O_RDONLY) {
+        std::clog << "Turning off directio because of open() err: "
+            << std::strerror(errno) << std::endl;
+        fd = open(file.get_filepath().c_str(), O_RDONLY);
+    }
+    if(fd == -1) {
+        if(ENOENT == errno) {
+            // Like serialise_file(), let data files go missing intraday
+            std::clog << "Error opening file " << file.get_filepath()
+                      << ", err: " << std::strerror(errno) << std::endl;
+            return;
+        }
+        ss << "cannot open file: " << std::strerror(errno);
+        throw SerialiseError(filename, ss.str());
+    }
+    RIIA_fd fd_guard(fd);
+
+    ChunkedFile cf(file, iomap, fd);
+    if(fstat(fd, &cf.st) == -1) {
+        ss << "cannot stat file: " << std::strerror(errno);
+        throw SerialiseError(filename, ss.str());
+    }
+    if(!S_ISREG(cf.st.st_mode)) {
+        throw SerialiseError(filename, "not a regular file");
+    }
+    // Send what the manifest promised; pages added since then are replayed
+    // from the log like any other change made during the backup
+    if(cf.st.st_size < file.get_filesize()) {
+        throw SerialiseError(filename, "file shrank while being archived!");
+    }
+    cf.st.st_size = file.get_filesize();
+
+    cf.pagesize = file.get_pagesize();
+    if(cf.pagesize == 0) {
+        cf.pagesize = 4096;
+    }
+    cf.nchunks = num_chunks(cf.st.st_size);
+    if(nthreads > cf.nchunks) {
+        nthreads = cf.nchunks;
+    }
+    if(nthreads == 0) {
+        nthreads = 1;
+    }
+
+    std::vector<std::thread> threads;
+    for(unsigned ii = 0; ii < nthreads; ii++) {
+        threads.emplace_back(serialise_chunks, &cf);
+    }
+    for(size_t ii = 0; ii < threads.size(); ii++) {
+        threads[ii].join();
+    }
+
+    if(!cf.error.empty()) {
+        throw SerialiseError(filename, cf.error);
+    }
+
+    file.set_filesize(cf.st.st_size);
+
+    if(cf.skip_iomap) {
+        std::clog << "long memptrickle, continued without waiting" << std::endl;
+    }
+    if(cf.num_waits) {
+        std::clog << "paused " << cf.num_waits
+            << " times because db is busy writing." << std::endl;
+    }
+    std::clog << "a " << filename << " size=" << cf.st.st_size
+              << " pagesize=" << cf.pagesize << " chunks=" << cf.nchunks
+              << " lz4=" << cf.compressed << std::endl;
+}
+
+
+ChunkWriter::ChunkWriter(unsigned nthreads) :
+    m_nthreads(nthreads ? nthreads : 1),
+    m_busy(0),
+    m_stop(false),
+    m_fd(-1),
+    m_filesize(0),
+    m_written(0) {}
+
+ChunkWriter::~ChunkWriter()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_lk);
+        m_stop = true;
+        m_queue.clear();
+    }
+    m_cv.notify_all();
+    for(size_t ii = 0; ii < m_threads.size(); ii++) {
+        m_threads[ii].join();
+    }
+    if(m_fd != -1) {
+        close(m_fd);
+    }
+}
+
+void ChunkWriter::open(const std::string& path, unsigned long long filesize)
+{
+    finish();
+
+    // output_file() makes the directories and replaces any old file; keep
+    // our own descriptor as its stream closes on destruction
+    std::unique_ptr<fdostream> of_ptr = output_file(path, false, false);
+    m_fd = dup(of_ptr->getfd());
+    if(m_fd == -1) {
+        std::ostringstream ss;
+        ss << "Error opening '" << path << "' for writing: "
+            << std::strerror(errno);
+        throw Error(ss);
+    }
+    m_path = path;
+    m_filesize = filesize;
+    m_seen.assign(num_chunks(filesize), false);
+    m_written = 0;
+
+    while(m_threads.size() < m_nthreads) {
+        m_threads.emplace_back(&ChunkWriter::run, this);
+    }
+}
+
+void ChunkWriter::add(unsigned long long chunkno, std::vector<char>& data)
+{
+    if(chunkno >= m_seen.size() || m_seen[chunkno]) {
+        std::ostringstream ss;
+        ss << m_path << ": unexpected chunk " << chunkno << " of "
+            << m_seen.size();
+        throw Error(ss);
+    }
+    m_seen[chunkno] = true;
+
+    std::unique_lock<std::mutex> lk(m_lk);
+    m_cv.wait(lk, [this] { return m_queue.size() < 2 * m_nthreads; });
+    m_queue.emplace_back(chunkno, std::vector<char>());
+    m_queue.back().second.swap(data);
+    m_cv.notify_all();
+}
+
+void ChunkWriter::finish()
+{
+    std::unique_lock<std::mutex> lk(m_lk);
+    m_cv.wait(lk, [this] { return m_queue.empty() && m_busy == 0; });
+    if(m_fd == -1) {
+        return;
+    }
+
+    int rc = close(m_fd);
+    m_fd = -1;
+    std::string path, error;
+    path.swap(m_path);
+    error.swap(m_error);
+    if(!error.empty()) {
+        throw Error(path + ": " + error);
+    }
+    if(rc == -1) {
+        std::ostringstream ss;
+        ss << "Error closing " << path << ": " << std::strerror(errno);
+        throw Error(ss);
+    }
+    for(size_t ii = 0; ii < m_seen.size(); ii++) {
+        if(!m_seen[ii]) {
+            std::ostringstream ss;
+            ss << path << ": chunk " << ii << " of " << m_seen.size()
+                << " is missing";
+            throw Error(ss);
+        }
+    }
+    if(m_written != m_filesize) {
+        std::ostringstream ss;
+        ss << path << ": restored " << m_written << " bytes, manifest size is "
+            << m_filesize;
+        throw Error(ss);
+    }
+}
+
+void ChunkWriter::run()
+{
+    char *buf = NULL;
+    if(posix_memalign((void**) &buf, 512, CHUNK_SIZE)) {
+        buf = NULL;
+    }
+    RIIA_malloc buf_guard(buf);
+
+    std::unique_lock<std::mutex> lk(m_lk);
+    while(true) {
+        m_cv.wait(lk, [this] { return m_stop || !m_queue.empty(); });
+        if(m_stop) {
+            break;
+        }
+        std::pair<unsigned long long, std::vector<char> > chunk;
+        chunk.swap(m_queue.front());
+        m_queue.pop_front();
+        m_busy++;
+        int fd = m_fd;
+        bool skip = !m_error.empty();
+        m_cv.notify_all();
+        lk.unlock();
+
+        // Once a chunk of this file failed just drain the rest
+        std::ostringstream ss;
+        int n = 0;
+        if(skip) {
+        } else if(buf == NULL) {
+            ss << "failed to allocate chunk buffer";
+        } else {
+            n = LZ4_decompress_safe(chunk.second.data(), buf,
+                    chunk.second.size(), CHUNK_SIZE);
+            if(n < 0) {
+                ss << "corrupt lz4 chunk " << chunk.first;
+            } else if(pwriteall(fd, buf, n, chunk.first * CHUNK_SIZE) != n) {
+                ss << "error writing chunk " << chunk.first << ": "
+                    << std::strerror(errno);
+                n = 0;
+            }
+        }
+
+        lk.lock();
+        if(!ss.str().empty() && m_error.empty()) {
+            m_error = ss.str();
+        }
+        if(n > 0) {
+            m_written += n;
+        }
+        m_busy--;
+        m_cv.notify_all();
+    }
+}
@@ -0,0 +1,94 @@
+/*
+   Copyright 2026 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef INCLUDED_CHUNKED
+#define INCLUDED_CHUNKED
+
+// Chunked archives: a data file is serialised as a run of tar entries named
+// <file>.lz4.<n>, each holding chunk n of the file (CHUNK_SIZE bytes at
+// offset n * CHUNK_SIZE) as a single lz4 block.  Chunks are independent, so
+// they can be read, checksummed and compressed on several threads, and
+// decompressed and written back on several threads.  The stream stays a
+// valid tar archive.
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "comdb2ar.h"
+#include "file_info.h"
+
+const size_t CHUNK_SIZE = MAX_BUF_SIZE;
+const unsigned MAX_CHUNK_THREADS = 64;
+
+std::string chunk_name(const std::string& filename, unsigned long long chunkno);
+// Name of the tar entry that holds chunk chunkno of filename
+
+bool is_chunk_name(const std::string& name, std::string& filename,
+        unsigned long long& chunkno);
+// If name is a chunk entry then set filename and chunkno and return true
+
+void serialise_file_chunked(FileInfo& file, volatile iomap *iomap,
+        unsigned nthreads);
+// Serialise a Berkeley file onto stdout in chunks, using nthreads threads to
+// read, verify and compress them.  Chunks are written in order.
+
+class ChunkWriter {
+// Restores a chunked file: chunks handed to add() are decompressed and
+// written at their offset by a pool of threads.
+
+    unsigned m_nthreads;
+    std::vector<std::thread> m_threads;
+    std::mutex m_lk;
+    std::condition_variable m_cv;
+    std::deque<std::pair<unsigned long long, std::vector<char> > > m_queue;
+    unsigned m_busy;
+    bool m_stop;
+    int m_fd;
+    std::string m_path;
+    std::string m_error;
+    unsigned long long m_filesize;
+    std::vector<bool> m_seen;          // chunks of the current file queued
+    unsigned long long m_written;      // bytes written by the pool
+
+    void run();
+
+public:
+    explicit ChunkWriter(unsigned nthreads);
+    ~ChunkWriter();
+
+    const std::string& path() const { return m_path; }
+
+    void open(const std::string& path, unsigned long long filesize);
+    // Finish the current file and start writing path, which the manifest
+    // says is filesize bytes long
+
+    void add(unsigned long long chunkno, std::vector<char>& data);
+    // Queue a compressed chunk of the current file; takes the contents of
+    // data.  Blocks while the pool is behind.  Throws if the chunk is not
+    // part of the file or was already added.
+
+    void finish();
+    // Wait for every queued chunk to be written and close the file.  Throws
+    // if any of them failed, if a chunk is missing, or if the bytes written
+    // do not add up to the file size.
+};
+
+#endif // INCLUDED_CHUNKED
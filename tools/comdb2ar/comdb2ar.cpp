@@ -5,11 +5,13 @@
 // comdb2backup and comdb2restore.
 
 #include "comdb2ar.h"
+#include "chunked.h"
 #include "util.h"
 
 #include <exception>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <sstream>
 
 #include <cstdlib>
@@ -37,6 +39,8 @@ const char *help_text[] = {
 "  Database mydb is serialised into tape archive format on to stdout.",
 "  -s   serialise support files only (lrl, csc2 etc, no data or log files)",
 "  -L   do not disable log file deletion (dangerous)",
+"  -z n send data files as lz4 compressed chunks, using n (1-64) threads per file",
+"       (archives made with -z need a comdb2ar that supports it to restore)",
 "",
 "To deserialise a db: comdb2ar.tsk [opts] x [/bb/bin /bb/data/mydb] < input",
 "To deserialise a db incrementally:",
@@ -62,6 +66,7 @@ const char *help_text[] = {
 "  -D           turn off directio",
 "  -E dbname    create replicant with dbname",
 "  -T type      override physrep type",
+"  -z n         threads (1-64) used to write compressed chunks (default: #cpus, max 8)",
 NULL
 };
 
@@ -113,6 +118,7 @@ int main(int argc, char *argv[])
     bool incr_path_specified = false;
     bool dryrun = false;
     bool copy_physical = false;
+    unsigned compress_threads = 0;
 
     std::string new_db_name = "";
     std::string new_type = "default";
@@ -129,7 +135,7 @@ int main(int argc, char *argv[])
     ss << root << "/bin/comdb2";
     std::string comdb2_task(ss.str());
 
-    while((c = getopt(argc, argv, "hsSLC:I:b:x:u:rRSkKfODE:T:A")) != EOF) {
+    while((c = getopt(argc, argv, "hsSLC:I:b:x:u:rRSkKfODE:T:Az:")) != EOF) {
         switch(c) {
             case 'O':
                 legacy_mode = true;
@@ -237,6 +243,20 @@ int main(int argc, char *argv[])
                 new_type = std::string(optarg);
                 break;
 
+            case 'z': {
+                char *endp;
+                long n = std::strtol(optarg, &endp, 10);
+                if(endp == optarg || *endp != '\0' || n < 1 ||
+                        n > MAX_CHUNK_THREADS) {
+                    std::cerr << "Bad parameter to -z: " << optarg
+                        << ", expected 1 to " << MAX_CHUNK_THREADS
+                        << " threads" << std::endl;
+                    std::exit(2);
+                }
+                compress_threads = n;
+                break;
+            }
+
             case '?':
                 std::cerr << "Unrecognised option: -" << (char)c << std::endl;
                 usage();
@@ -258,6 +278,12 @@ int main(int argc, char *argv[])
         std::exit(2);
     }
 
+    if((incr_gen || incr_create) && compress_threads) {
+        std::cerr << "Compressed chunks (-z) are not supported in incremental mode"
+            << std::endl;
+        std::exit(2);
+    }
+
     for(const char *cp = argv[0]; *cp; ++cp) {
         switch(*cp) {
             case 'c':
@@ -315,7 +341,8 @@ int main(int argc, char *argv[])
                 incr_gen,
                 copy_physical,
                 add_latency,
-                incr_path
+                incr_path,
+                compress_threads
             );
         } catch(std::exception& e) {
             std::cerr << e.what() << std::endl;
@@ -342,6 +369,12 @@ int main(int argc, char *argv[])
             std::exit(2);
         }
         bool is_disk_full = false;
+        if(compress_threads == 0) {
+            compress_threads = std::thread::hardware_concurrency();
+            if(compress_threads == 0 || compress_threads > 8) {
+                compress_threads = 8;
+            }
+        }
         try {
            deserialise_database(
              p_lrldest,
@@ -357,7 +390,8 @@ int main(int argc, char *argv[])
              is_disk_full,
              run_with_done_file,
              incr_ex,
-             dryrun
+             dryrun,
+             compress_threads
            );
         } catch(std::exception& e) {
             std::cerr << e.what() << std::endl;
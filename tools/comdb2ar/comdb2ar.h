@@ -111,13 +111,16 @@ void serialise_database(
   bool incr_gen,
   bool copy_physical,
   bool add_latency,
-  const std::string& incr_path
+  const std::string& incr_path,
+  unsigned compress_threads
 );
 // Serialise a database into tape archive format and write it to stdout.
 // If support_only is true then only support files (lrl and schema) will
 // be serialised.  If disable_log_deletion and the database is running then
 // it will be advised to hold log file deletion until the backup is complete
 // (highly recommended!)
+// If compress_threads is not 0 then a full backup sends data files as lz4
+// compressed chunks, using that many threads per file.
 // If legacy_mode is enabled, old file format are not removed after restore
 
 
@@ -135,7 +138,8 @@ void deserialise_database(
   bool& is_disk_full,
   bool run_with_done_file,
   bool incr_mode,
-  bool dryrun
+  bool dryrun,
+  unsigned nthreads
 );
 // Deserialise a database from serialised form received on stdin.
 // If lrldestdir and datadestdir are not NULL then the lrl and data files
@@ -146,7 +150,8 @@ void deserialise_database(
 // true then full recovery is run on the resulting database using the binary
 // given by comdb2_task.  If the destination disk reaches or exceeds the
 // specified percent_full during the deserialisation then the operation is
-// halted.
+// halted.  Chunked data files are decompressed and written by nthreads
+// threads.
 
 bool isDirectory(const std::string& file);
 
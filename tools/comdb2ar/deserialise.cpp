@@ -10,6 +10,7 @@
 #include "increment.h"
 #include "util.h"
 #include "ar_wrap.h"
+#include "chunked.h"
 #include "cdb2_constants.h"
 
 #include <cstdlib>
@@ -379,7 +380,8 @@ void deserialise_database(
         bool& is_disk_full,
         bool run_with_done_file,
         bool incr_mode,
-        bool dryrun
+        bool dryrun,
+        unsigned nthreads
 )
 // Deserialise a database from serialised from received on stdin.
 // If lrldestdir and datadestdir are not NULL then the lrl and data files
@@ -445,6 +447,9 @@ void deserialise_database(
     // The manifest map
     std::map<std::string, FileInfo> manifest_map;
 
+    // Decompresses and writes the chunks of the current chunked data file
+    ChunkWriter chunks(nthreads);
+
     if (run_with_done_file)
     {
        /* remove the DONE file before we start copying */
@@ -521,6 +526,7 @@ void deserialise_database(
         // Alternativelyh, if we're running in incremental mode, then
         // we know we are moving on the the incremental backups
         if(std::memcmp(head.c, zero_head, 512) == 0) {
+            chunks.finish();
             if(incr_mode){
                 std::clog << "Done with base backup, moving on to increments"
                           << std::endl << std::endl;
@@ -559,6 +565,25 @@ void deserialise_database(
         }
         unsigned long long nblocks = (filesize + 511ULL) >> 9;
 
+        // Chunks of a data file are named after it
+        std::string chunkfile;
+        unsigned long long chunkno = 0;
+        unsigned long long chunk_filesize = 0;
+        bool is_chunk = is_chunk_name(filename, chunkfile, chunkno);
+        if(is_chunk) {
+            std::map<std::string, FileInfo>::const_iterator chunk_it =
+                manifest_map.find(chunkfile);
+            if(chunk_it == manifest_map.end() ||
+                    !chunk_it->second.get_lz4_chunks()) {
+                std::ostringstream ss;
+                ss << "Chunk " << filename
+                    << " belongs to a file that is not chunked in the manifest";
+                throw Error(ss);
+            }
+            chunk_filesize = chunk_it->second.get_filesize();
+        } else {
+            chunks.finish();
+        }
 
         // If this is an .lrl file then we have to read it into memory and
         // then rewrite it to disk.  In getting the extension it is important
@@ -596,22 +621,83 @@ void deserialise_database(
         // comdb2backup script doesn't serialise the file_vers_map, so I can't
         // do that yet. This way the onus is on the serialising side to get
         // the list of files right.
-        if(!is_text && filename.find_first_of('/') == std::string::npos) {
+        const std::string& datafile = is_chunk ? chunkfile : filename;
+        if(!is_text && datafile.find_first_of('/') == std::string::npos) {
             uint8_t is_data_file = 0;
             uint8_t is_queue_file = 0;
             uint8_t is_queuedb_file = 0;
             char *table_name = (char *)alloca(MAXTABLELEN);
 
-            if(recognize_data_file(filename.c_str(), &is_data_file,
+            if(recognize_data_file(datafile.c_str(), &is_data_file,
                                    &is_queue_file, &is_queuedb_file,
                                    &table_name)) {
                 if(table_set.insert(table_name).second) {
                     std::clog << "Discovered table " << table_name
-                        << " from data file " << filename << std::endl;
+                        << " from data file " << datafile << std::endl;
                 }
             }
         }
 
+        if(is_chunk) {
+            if(datadestdir.empty()) {
+                throw Error("Stream contains files for data directory before data dir is known");
+            }
+
+            std::string outfilename(datadestdir + "/" + chunkfile);
+            if(chunkno == 0) {
+                chunks.open(outfilename, chunk_filesize);
+                extracted_files.insert(outfilename);
+
+                /* Restore the permissions. */
+                uid_t uid = (uid_t)strtol(head.h.uid, NULL, 8);
+                gid_t gid = (gid_t)strtol(head.h.gid, NULL, 8);
+                mode_t modes = (mode_t)strtol(head.h.mode, NULL, 8);
+                if (chown(outfilename.c_str(), uid, gid)==-1)
+                    perror(outfilename.c_str());
+                if (chmod(outfilename.c_str(), modes)==-1)
+                    perror(outfilename.c_str());
+
+                std::clog << "x " << chunkfile << " lz4 chunks" << std::endl;
+            } else if(chunks.path() != outfilename) {
+                std::ostringstream ss;
+                ss << "Chunk " << filename << " is out of order";
+                throw Error(ss);
+            }
+
+            // Each chunk is at most CHUNK_SIZE once decompressed
+            struct statvfs stfs;
+            if(statvfs(datadestdir.c_str(), &stfs) == -1) {
+                std::ostringstream ss;
+                ss << "Error running statvfs on " << datadestdir
+                    << ": " << strerror(errno);
+                throw Error(ss);
+            }
+            fsblkcnt_t fsblocks = CHUNK_SIZE / stfs.f_bsize;
+            double percent_free = 100.00 * ((double)(stfs.f_bavail - fsblocks) / (double)stfs.f_blocks);
+            if(100.00 - percent_free >= percent_full) {
+                is_disk_full = true;
+                std::ostringstream ss;
+                ss << "Not enough space to deserialise " << filename
+                    << " - would leave only " << percent_free
+                    << "% free space";
+                throw Error(ss);
+            }
+
+            std::vector<char> data(filesize);
+            unsigned long long padding_bytes = (nblocks << 9) - filesize;
+            char padding[512];
+            if(readall(0, data.data(), filesize) != (ssize_t)filesize ||
+                    (padding_bytes &&
+                     readall(0, padding, padding_bytes) != (ssize_t)padding_bytes)) {
+                std::ostringstream ss;
+                ss << "Error reading " << filename << ": "
+                    << errno << " " << strerror(errno);
+                throw Error(ss);
+            }
+            chunks.add(chunkno, data);
+            continue;
+        }
+
         std::unique_ptr<fdostream> of_ptr;
 
         if(is_text) {
@@ -46,6 +46,11 @@ int fdostream::skip(unsigned long long size)
   return -1;
 }
 
+int fdostream::getfd()
+{
+    return buf.getfd();
+}
+
 
 fdostream::fdostream(int fd) : std::ostream(0), buf(fd)
 {
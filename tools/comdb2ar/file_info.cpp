@@ -13,7 +13,8 @@ FileInfo::FileInfo() :
     m_sparse(false),
     m_do_direct_io(true),
     m_swapped(false),
-    m_filesize(0) {}
+    m_filesize(0),
+    m_lz4_chunks(false) {}
 
 FileInfo::FileInfo(const FileInfo& copy) :
     m_type(copy.m_type),
@@ -24,7 +25,8 @@ FileInfo::FileInfo(const FileInfo& copy) :
     m_sparse(copy.m_sparse),
     m_do_direct_io(copy.m_do_direct_io),
     m_swapped(copy.m_swapped),
-    m_filesize(copy.m_filesize) {}
+    m_filesize(copy.m_filesize),
+    m_lz4_chunks(copy.m_lz4_chunks) {}
 
 FileInfo::FileInfo(
         FileTypeEnum type,
@@ -44,7 +46,8 @@ FileInfo::FileInfo(
     m_sparse(sparse),
     m_do_direct_io(do_direct_io),
     m_swapped(swapped),
-    m_filesize(0)
+    m_filesize(0),
+    m_lz4_chunks(false)
 {
     // If file name is within the dbdir then just strip dbdir
     if(type != SUPPORT_FILE
@@ -81,6 +84,7 @@ FileInfo& FileInfo::operator=(const FileInfo& rhs)
         m_sparse = rhs.m_sparse;
         m_do_direct_io = rhs.m_do_direct_io;
         m_filesize = rhs.m_filesize;
+        m_lz4_chunks = rhs.m_lz4_chunks;
     }
     return *this;
 }
@@ -95,6 +99,7 @@ void FileInfo::reset()
     m_sparse = false;
     m_pagesize = 0;
     m_swapped = false;
+    m_lz4_chunks = false;
 }
 
 const char *FileInfo::get_type_string() const
@@ -152,6 +157,11 @@ void write_manifest_entry(std::ostream& os, const FileInfo& file)
         std::clog << " Sparse";
     }
 
+    if(file.get_lz4_chunks()) {
+        os << " Lz4Chunks FileSize " << file.get_filesize();
+        std::clog << " Lz4Chunks FileSize " << file.get_filesize();
+    }
+
     os << std::endl;
     std::cerr << std::endl;
     //return os;
@@ -189,6 +199,9 @@ bool read_FileInfo(const std::string& line, FileInfo& file)
                 fprintf(stderr, "tok=Sparse, calling set_sparse\n");
                 f.set_sparse();
 
+            } else if(tok == "Lz4Chunks") {
+                f.set_lz4_chunks();
+
             } else if(tok == "New") {
                 continue;
 
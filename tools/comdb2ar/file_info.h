@@ -67,6 +67,9 @@ private:
 
     int64_t m_filesize;
     // file size as recorded in manifest
+
+    bool m_lz4_chunks;
+    // true if the file is serialised as lz4 compressed chunks
 public:
 
     FileInfo();
@@ -108,6 +111,7 @@ public:
     // type will be set to unknown.
 
     void set_filesize(int64_t filesize) { m_filesize = filesize; }
+    void set_lz4_chunks(bool lz4_chunks = true) { m_lz4_chunks = lz4_chunks; }
 
     void set_sparse(bool sparse = true)
     {
@@ -129,6 +133,7 @@ public:
     bool get_sparse()const { return m_sparse; }
     bool get_swapped() const { return m_swapped; }
     int64_t get_filesize() const { return m_filesize; }
+    bool get_lz4_chunks() const { return m_lz4_chunks; }
 
 
     const char *get_type_string() const;
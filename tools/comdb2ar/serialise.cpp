@@ -1,6 +1,7 @@
 #include "comdb2ar.h"
 
 #include "ar_wrap.h"
+#include "chunked.h"
 #include "error.h"
 #include "file_info.h"
 #include "logholder.h"
@@ -761,7 +762,8 @@ void serialise_database(
   bool incr_gen,
   bool copy_physical,
   bool add_latency,
-  const std::string& incr_path
+  const std::string& incr_path,
+  unsigned compress_threads
 )
 // Serialise a database into tape archive format and write it to stdout.
 // If support_only is true then only support files (lrl and schema) will
@@ -1170,6 +1172,23 @@ void serialise_database(
     }
 
 
+    // Full backups may send data files as lz4 chunks, compressed in parallel.
+    // The manifest records how much of each file is sent, so that restore
+    // can tell whether every chunk arrived.
+    if(compress_threads > 0 && !incr_create && !incr_gen) {
+        for(std::list<FileInfo>::iterator
+                it = data_files.begin();
+                it != data_files.end();
+                ++it) {
+            struct stat st;
+            if(it->get_type() == FileInfo::BERKDB_FILE && !it->get_sparse() &&
+                    stat(it->get_filepath().c_str(), &st) == 0) {
+                it->set_lz4_chunks();
+                it->set_filesize(st.st_size);
+            }
+        }
+    }
+
     // Construct a manifest which will give the page sizes of all the files
     std::ostringstream manifest;
 
@@ -1372,7 +1391,11 @@ void serialise_database(
                     log_holder->release_log(log_number - 1);
                 }
 
-                serialise_file(*it, iom, "", incr_path, incr_create);
+                if(it->get_lz4_chunks()) {
+                    serialise_file_chunked(*it, iom, compress_threads);
+                } else {
+                    serialise_file(*it, iom, "", incr_path, incr_create);
+                }
                 if (add_latency) {
                     sleep(1);
                 }